@@ -97,6 +97,9 @@ void BackgroundDrawer_draw(int width, int height, uint8_t *data)
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, s_textureId);
 	glUniform1i(s_textureUniformId, 0);
+	/* shared shader: draw stretched, the texture is already RGB (the driver swizzles GL_BGR) */
+	glUniform2f(glGetUniformLocation(s_shaderId, "uvScale"), 1.0f, 1.0f);
+	glUniform1i(glGetUniformLocation(s_shaderId, "pixelFormat"), 1);
 
 	/* Set attribute buffer */
 	glEnableVertexAttribArray(0);
@@ -0,0 +1,20 @@
+#ifndef APP_SETTINGS_H
+#define APP_SETTINGS_H
+
+/* Settings of the overlay app, shared by the interactive executable (main.cpp) and batch_renderer (BatchMain.cpp) */
+//#define HAAR_FILENAME "resource/haarcascade_frontalface_alt.xml"
+#define HAAR_FILENAME "resource/rpalm.xml"
+#define SECOND_HAAR_FILENAME "resource/haarcascade_frontalface_alt.xml"	// run together with HAAR_FILENAME by --detector multi
+#define RESOURCE_PACK_FILENAME "resource.pack"
+#define DETECT_BATCH_SIZE 2	// queued frames taken into one inference call
+#define DETECT_IN_FLIGHT 3	// frames of a stream being detected at once
+#define USE_TRACKING 1		// detect-then-track: cascade every N frames, template tracking in between (one stateful worker)
+#define USE_MOTION_GATE 1	// skip detection on static frames, detect only where the image changed otherwise
+
+/* Overlay models (--model replaces them), switched after 2 sec without detection */
+static const char *MODEL_FILENAMES[] = {
+	"resource/miku_Ver17.02.pmx",
+	"resource/nendomiku_ver3_00.pmx",
+};
+
+#endif
@@ -0,0 +1,261 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+/* for GLFW */
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "shader.h"
+#include "texture.h"
+#include "ResourcePack.h"
+#include "ImageDecoder.h"
+#include "TextureLoader.h"
+#include "AssetManager.h"
+
+/*** Macro ***/
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+/*** Functions ***/
+static const char *ASSET_TYPE_NAME[ASSET_TYPE_NUM] = { "texture", "program" };
+
+/* Packed resources are identified by their entry name, loose files by their absolute path */
+static std::string canonicalPath(const char *path)
+{
+	if (Resource_isInPack(path)) return "pack:" + ResourcePack_normalizeName(path);
+#ifdef _WIN32
+	char buffer[_MAX_PATH];
+	if (_fullpath(buffer, path, _MAX_PATH)) return buffer;
+#else
+	char *resolved = realpath(path, NULL);
+	if (resolved) {
+		std::string ret(resolved);
+		free(resolved);
+		return ret;
+	}
+#endif
+	return path;
+}
+
+/* FNV-1a */
+static uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static std::string makeKey(AssetType type, const std::string &path)
+{
+	return std::string(ASSET_TYPE_NAME[type]) + ":" + path;
+}
+
+/* Sum of all levels / faces / layers actually allocated by the driver */
+static size_t getTextureBytes(GLuint id, GLenum target)
+{
+	glBindTexture(target, id);
+	int faceNum = (target == GL_TEXTURE_CUBE_MAP) ? 6 : 1;
+	size_t bytes = 0;
+	for (int face = 0; face < faceNum; face++) {
+		GLenum levelTarget = (target == GL_TEXTURE_CUBE_MAP) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+		for (int level = 0; ; level++) {
+			GLint width = 0, height = 0, depth = 0, compressed = GL_FALSE;
+			glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_WIDTH, &width);
+			if (width == 0) break;
+			glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_HEIGHT, &height);
+			glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_DEPTH, &depth);
+			glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+			if (compressed) {
+				GLint size = 0;
+				glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+				bytes += size;
+			} else {
+				/* texel size of the internal format the driver chose, from its component sizes */
+				static const GLenum COMPONENT_SIZES[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE };
+				GLint bitNum = 0;
+				for (size_t i = 0; i < sizeof(COMPONENT_SIZES) / sizeof(COMPONENT_SIZES[0]); i++) {
+					GLint componentBitNum = 0;
+					glGetTexLevelParameteriv(levelTarget, level, COMPONENT_SIZES[i], &componentBitNum);
+					bitNum += componentBitNum;
+				}
+				bytes += ((size_t)width * height * (depth > 0 ? depth : 1) * bitNum + 7) / 8;
+			}
+		}
+	}
+	glBindTexture(target, 0);
+	return bytes;
+}
+
+AssetManager::AssetManager()
+{
+}
+
+AssetManager::~AssetManager()
+{
+	for (std::map<std::string, Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+		if (!it->second.asset.expired()) printf("AssetManager: %s is still referenced at destruction\n", it->first.c_str());
+	}
+}
+
+template <typename T>
+std::shared_ptr<const T> AssetManager::FindByPath(AssetType type, const std::string &key)
+{
+	std::map<std::string, Entry>::iterator it = m_entries.find(key);
+	/* keys are prefixed by type, so a mismatch means a corrupted registry: never cast it */
+	if (it == m_entries.end() || it->second.type != type) return std::shared_ptr<const T>();
+	return std::static_pointer_cast<const T>(it->second.asset.lock());
+}
+
+template <typename T>
+std::shared_ptr<const T> AssetManager::FindByHash(AssetType type, uint64_t hash, const std::string &key)
+{
+	std::map<std::pair<int, uint64_t>, std::string>::iterator it = m_hashIndex.find(std::make_pair((int)type, hash));
+	if (it == m_hashIndex.end()) return std::shared_ptr<const T>();
+	std::map<std::string, Entry>::iterator entry = m_entries.find(it->second);
+	if (entry == m_entries.end()) return std::shared_ptr<const T>();
+	std::shared_ptr<const void> asset = entry->second.asset.lock();
+	if (!asset) return std::shared_ptr<const T>();
+
+	/* Same content under another path: remember the path as an alias */
+	Entry alias = entry->second;
+	m_entries[key] = alias;
+	return std::static_pointer_cast<const T>(asset);
+}
+
+void AssetManager::Register(AssetType type, const std::string &key, uint64_t hash, size_t bytes, const std::shared_ptr<const void> &asset)
+{
+	Entry entry;
+	entry.type = type;
+	entry.hash = hash;
+	entry.bytes = bytes;
+	entry.asset = asset;
+	m_entries[key] = entry;
+	m_hashIndex[std::make_pair((int)type, hash)] = key;
+}
+
+/* Called from the deleter of a handle: the released asset is the expired one (with all of its aliases) */
+void AssetManager::Evict(AssetType type)
+{
+	for (std::map<std::string, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ) {
+		if (it->second.type == type && it->second.asset.expired()) {
+			std::map<std::pair<int, uint64_t>, std::string>::iterator hashIt = m_hashIndex.find(std::make_pair((int)type, it->second.hash));
+			if (hashIt != m_hashIndex.end() && hashIt->second == it->first) m_hashIndex.erase(hashIt);
+			m_entries.erase(it++);
+		} else {
+			++it;
+		}
+	}
+}
+
+TextureHandle AssetManager::LoadTexture(const char *path)
+{
+	std::string key = makeKey(ASSET_TEXTURE, canonicalPath(path));
+	TextureHandle handle = FindByPath<TextureAsset>(ASSET_TEXTURE, key);
+	if (handle) return handle;
+
+	ResourceView file;
+	if (!Resource_read(path, &file)) return TextureHandle();
+	uint64_t hash = hashBytes(file.data, file.size);
+	handle = FindByHash<TextureAsset>(ASSET_TEXTURE, hash, key);
+	if (handle) return handle;
+
+	/* Decode from the view we already have */
+	printf("Reading image %s\n", path);
+	TextureAsset *asset = new TextureAsset();
+	asset->target = GL_TEXTURE_2D;
+	if (file.size >= 4 && memcmp(file.data, "DDS ", 4) == 0) {
+		asset->id = loadDDSFromMemory(file.data, file.size, &asset->target);
+	} else if (file.size >= 4 && memcmp(file.data, "\xABKTX", 4) == 0) {
+		asset->id = loadKTX2FromMemory(file.data, file.size, &asset->target);
+	} else {
+		Image image;
+		asset->id = ImageDecoder_decode(file.data, file.size, &image) ? TextureLoader_createTexture(image) : 0;
+	}
+	if (asset->id == 0) {
+		printf("%s could not be loaded\n", path);
+		delete asset;
+		return TextureHandle();
+	}
+	asset->bytes = getTextureBytes(asset->id, asset->target);
+
+	handle = TextureHandle(asset, [this](const TextureAsset *p) {
+		glDeleteTextures(1, &p->id);
+		delete p;
+		Evict(ASSET_TEXTURE);
+	});
+	Register(ASSET_TEXTURE, key, hash, asset->bytes, handle);
+	return handle;
+}
+
+ProgramHandle AssetManager::LoadProgram(const char *vertexShaderPath, const char *fragmentShaderPath)
+{
+	std::string key = makeKey(ASSET_PROGRAM, canonicalPath(vertexShaderPath) + "|" + canonicalPath(fragmentShaderPath));
+	ProgramHandle handle = FindByPath<ProgramAsset>(ASSET_PROGRAM, key);
+	if (handle) return handle;
+
+	ResourceView vertexFile, fragmentFile;
+	if (!Resource_read(vertexShaderPath, &vertexFile) || !Resource_read(fragmentShaderPath, &fragmentFile)) return ProgramHandle();
+	uint64_t hash = hashBytes(vertexFile.data, vertexFile.size);
+	hash = hashBytes(fragmentFile.data, fragmentFile.size, hash ^ FNV_PRIME);
+	handle = FindByHash<ProgramAsset>(ASSET_PROGRAM, hash, key);
+	if (handle) return handle;
+
+	GLuint id = LoadShadersFromMemory(
+		vertexShaderPath, (const char *)vertexFile.data, vertexFile.size,
+		fragmentShaderPath, (const char *)fragmentFile.data, fragmentFile.size);
+	if (id == 0) return ProgramHandle();
+	ProgramAsset *asset = new ProgramAsset();
+	asset->id = id;
+	asset->bytes = 0;
+	if (GLEW_ARB_get_program_binary) {
+		GLint length = 0;
+		glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+		asset->bytes = length;
+	}
+
+	handle = ProgramHandle(asset, [this](const ProgramAsset *p) {
+		glDeleteProgram(p->id);
+		delete p;
+		Evict(ASSET_PROGRAM);
+	});
+	Register(ASSET_PROGRAM, key, hash, asset->bytes, handle);
+	return handle;
+}
+
+int AssetManager::GetResidentNum(AssetType type) const
+{
+	/* aliases share one asset, so count unique hashes */
+	int num = 0;
+	for (std::map<std::pair<int, uint64_t>, std::string>::const_iterator it = m_hashIndex.begin(); it != m_hashIndex.end(); ++it) {
+		if (it->first.first == type) num++;
+	}
+	return num;
+}
+
+size_t AssetManager::GetResidentBytes(AssetType type) const
+{
+	size_t bytes = 0;
+	for (std::map<std::pair<int, uint64_t>, std::string>::const_iterator it = m_hashIndex.begin(); it != m_hashIndex.end(); ++it) {
+		if (it->first.first != type) continue;
+		std::map<std::string, Entry>::const_iterator entry = m_entries.find(it->second);
+		if (entry != m_entries.end()) bytes += entry->second.bytes;
+	}
+	return bytes;
+}
+
+void AssetManager::PrintReport() const
+{
+	for (int type = 0; type < ASSET_TYPE_NUM; type++) {
+		printf("AssetManager: %-8s %3d resident, %8.2f MB\n", ASSET_TYPE_NAME[type], GetResidentNum((AssetType)type), GetResidentBytes((AssetType)type) / (1024.0 * 1024.0));
+	}
+}
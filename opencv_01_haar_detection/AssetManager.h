@@ -0,0 +1,68 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <map>
+#include <memory>
+
+#include <GL/glew.h>
+
+typedef enum {
+	ASSET_TEXTURE,
+	ASSET_PROGRAM,
+	ASSET_TYPE_NUM,
+} AssetType;
+
+typedef struct {
+	GLuint id;
+	GLenum target;
+	size_t bytes;
+} TextureAsset;
+
+typedef struct {
+	GLuint id;
+	size_t bytes;
+} ProgramAsset;
+
+/* Ref-counted handles. The GL objects are deleted when the last handle is released */
+typedef std::shared_ptr<const TextureAsset> TextureHandle;
+typedef std::shared_ptr<const ProgramAsset> ProgramHandle;
+
+/* Registry of loaded assets, deduplicated by canonical path and by content hash.
+ * Must be used from the GL thread only, and must outlive every handle it returned */
+class AssetManager
+{
+public:
+	AssetManager();
+	~AssetManager();
+	TextureHandle LoadTexture(const char *path);
+	ProgramHandle LoadProgram(const char *vertexShaderPath, const char *fragmentShaderPath);
+
+	int GetResidentNum(AssetType type) const;
+	size_t GetResidentBytes(AssetType type) const;
+	void PrintReport() const;
+
+private:
+	AssetManager(const AssetManager&);
+	AssetManager& operator=(const AssetManager&);
+
+	typedef struct {
+		AssetType type;
+		uint64_t hash;
+		size_t bytes;
+		std::weak_ptr<const void> asset;
+	} Entry;
+
+	template <typename T> std::shared_ptr<const T> FindByPath(AssetType type, const std::string &key);
+	template <typename T> std::shared_ptr<const T> FindByHash(AssetType type, uint64_t hash, const std::string &key);
+	void Register(AssetType type, const std::string &key, uint64_t hash, size_t bytes, const std::shared_ptr<const void> &asset);
+	void Evict(AssetType type);
+
+private:
+	std::map<std::string, Entry> m_entries;                      /* type + canonical path -> asset (aliases share the asset) */
+	std::map<std::pair<int, uint64_t>, std::string> m_hashIndex; /* type + content hash -> key of the first path */
+};
+
+#endif
@@ -2,6 +2,7 @@
 /* for general */
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <fstream> 
 #include <vector>
 #include <string>
@@ -18,23 +19,91 @@
 
 /*** Macro ***/
 /* Settings */
+#define FENCE_TIMEOUT_NS 100000000   /* 100 msec */
+#define MAX_PLANE_NUM BackgroundDrawer::MAX_PLANE_NUM
 
 /*** Global variables ***/
-static GLuint s_shaderId;
-static GLuint s_textureUniformId;
-static GLuint s_textureId;
-static GLuint s_vertexBuffer;
-static GLuint s_uvBuffer;
+/* Shared by every BackgroundDrawer of a render thread (created by the first, deleted with the last).
+ * Per thread: render threads of contexts sharing objects (batch_renderer) would otherwise race on the uniforms of one program */
+static thread_local int s_instanceNum;
+static thread_local GLuint s_shaderId;
+static thread_local GLuint s_textureUniformId[MAX_PLANE_NUM];
+static thread_local GLuint s_uvScaleUniformId;
+static thread_local GLuint s_pixelFormatUniformId;
+static thread_local GLuint s_yuvToRgbUniformId;
+static thread_local GLuint s_yuvOffsetUniformId;
+static thread_local GLuint s_vertexBuffer;
+static thread_local GLuint s_uvBuffer;
 
 /*** Functions ***/
-void BackgroundDrawer_init(int width, int height)
+/* One texture per plane, without driver-side swizzle: BGR is stored as is and reordered in the shader */
+typedef struct {
+	int width;             /* in texels */
+	int height;
+	int bytesPerTexel;
+	GLenum internalFormat;
+	GLenum pixelFormat;
+} Plane;
+
+static void setPlane(Plane *plane, int width, int height, int bytesPerTexel)
+{
+	static const GLenum INTERNAL_FORMATS[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+	static const GLenum PIXEL_FORMATS[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	plane->width = width;
+	plane->height = height;
+	plane->bytesPerTexel = bytesPerTexel;
+	plane->internalFormat = INTERNAL_FORMATS[bytesPerTexel - 1];
+	plane->pixelFormat = PIXEL_FORMATS[bytesPerTexel - 1];
+}
+
+static int getPlanes(BackgroundFormat format, int width, int height, Plane planes[MAX_PLANE_NUM])
+{
+	switch (format) {
+	case BACKGROUND_FORMAT_GRAY:
+		setPlane(&planes[0], width, height, 1);
+		return 1;
+	case BACKGROUND_FORMAT_RGBA:
+		setPlane(&planes[0], width, height, 4);
+		return 1;
+	case BACKGROUND_FORMAT_YUYV:
+		/* Y in R of every texel (filtered as usual), U / V alternating in G (fetched in pairs in the shader) */
+		setPlane(&planes[0], width, height, 2);
+		return 1;
+	/* 4:2:0 sizes are even (checked by UploadFrame) */
+	case BACKGROUND_FORMAT_NV12:
+		setPlane(&planes[0], width, height, 1);
+		setPlane(&planes[1], width / 2, height / 2, 2);
+		return 2;
+	case BACKGROUND_FORMAT_I420:
+		setPlane(&planes[0], width, height, 1);
+		setPlane(&planes[1], width / 2, height / 2, 1);
+		setPlane(&planes[2], width / 2, height / 2, 1);
+		return 3;
+	default:
+		setPlane(&planes[0], width, height, 3);
+		return 1;
+	}
+}
+
+static size_t getFrameSize(int planeNum, const Plane *planes)
+{
+	size_t size = 0;
+	for (int i = 0; i < planeNum; i++) size += (size_t)planes[i].width * planes[i].height * planes[i].bytesPerTexel;
+	return size;
+}
+
+static bool createSharedResources()
 {
 	/* Load shader and get handle */
 	s_shaderId = LoadShaders("resource/BackgroundVertexShader.vertexshader", "resource/BackgroundVertexShader.fragmentshader");
-	s_textureUniformId = glGetUniformLocation(s_shaderId, "myTextureSampler");
-
-	/* Create Texture object (blank) */
-	glGenTextures(1, &s_textureId);
+	if (s_shaderId == 0) return false;
+	s_textureUniformId[0] = glGetUniformLocation(s_shaderId, "myTextureSampler");
+	s_textureUniformId[1] = glGetUniformLocation(s_shaderId, "planeSampler1");
+	s_textureUniformId[2] = glGetUniformLocation(s_shaderId, "planeSampler2");
+	s_yuvToRgbUniformId = glGetUniformLocation(s_shaderId, "yuvToRgb");
+	s_yuvOffsetUniformId = glGetUniformLocation(s_shaderId, "yuvOffset");
+	s_uvScaleUniformId = glGetUniformLocation(s_shaderId, "uvScale");
+	s_pixelFormatUniformId = glGetUniformLocation(s_shaderId, "pixelFormat");
 
 	/* Create Vertex Buffer Object and copy data (values are fixed) */
 	static const GLfloat vertexBufferFullScreen[] = {
@@ -66,37 +135,244 @@ void BackgroundDrawer_init(int width, int height)
 	glGenBuffers(1, &s_uvBuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, s_uvBuffer);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(uvBufferFullScreen), &uvBufferFullScreen[0], GL_STATIC_DRAW);
+	return true;
 }
 
-void BackgroundDrawer_finalize()
+static void deleteSharedResources()
 {
 	glDeleteBuffers(1, &s_vertexBuffer);
 	glDeleteBuffers(1, &s_uvBuffer);
-	glDeleteTextures(1, &s_textureUniformId);
-	glDeleteTextures(1, &s_textureId);
 	glDeleteProgram(s_shaderId);
+	s_vertexBuffer = 0;
+	s_uvBuffer = 0;
+	s_shaderId = 0;
+}
+
+/* Y'CbCr -> R'G'B' for the shader: rgb = yuvToRgb * (yuv - yuvOffset), the range expansion folded into the matrix */
+static void getYuvToRgb(BackgroundColorSpace colorSpace, bool isFullRange, float yuvToRgb[9], float yuvOffset[3])
+{
+	float kr = (colorSpace == BACKGROUND_COLOR_SPACE_BT709) ? 0.2126f : 0.299f;
+	float kb = (colorSpace == BACKGROUND_COLOR_SPACE_BT709) ? 0.0722f : 0.114f;
+	float kg = 1.0f - kr - kb;
+	float yScale = isFullRange ? 1.0f : 255.0f / 219.0f;
+	float cScale = isFullRange ? 1.0f : 255.0f / 224.0f;
+	yuvOffset[0] = isFullRange ? 0.0f : 16.0f / 255.0f;
+	yuvOffset[1] = 128.0f / 255.0f;
+	yuvOffset[2] = 128.0f / 255.0f;
+	/* column major (GLSL mat3): column 0 = Y, 1 = U (Cb), 2 = V (Cr) */
+	yuvToRgb[0] = yScale;
+	yuvToRgb[1] = yScale;
+	yuvToRgb[2] = yScale;
+	yuvToRgb[3] = 0.0f;
+	yuvToRgb[4] = -2.0f * kb * (1.0f - kb) / kg * cScale;
+	yuvToRgb[5] = 2.0f * (1.0f - kb) * cScale;
+	yuvToRgb[6] = 2.0f * (1.0f - kr) * cScale;
+	yuvToRgb[7] = -2.0f * kr * (1.0f - kr) / kg * cScale;
+	yuvToRgb[8] = 0.0f;
+}
+
+BackgroundDrawer::BackgroundDrawer()
+	: m_isInitialized(false), m_viewportWidth(1), m_viewportHeight(1), m_fit(BACKGROUND_FIT_LETTERBOX), m_uvScaleX(1.0f), m_uvScaleY(1.0f),
+	m_colorSpace(BACKGROUND_COLOR_SPACE_BT601), m_isFullRange(false), m_isOddSizeReported(false), m_planeNum(0), m_textureWidth(0), m_textureHeight(0),
+	m_textureFormat(BACKGROUND_FORMAT_BGR), m_pboIndex(0)
+{
+	for (int i = 0; i < MAX_PLANE_NUM; i++) m_textureId[i] = 0;
+	for (int i = 0; i < PBO_NUM; i++) {
+		m_pbo[i] = 0;
+		m_pboFence[i] = 0;
+	}
+}
+
+BackgroundDrawer::~BackgroundDrawer()
+{
+	Finalize();
+}
+
+bool BackgroundDrawer::Initialize(int width, int height)
+{
+	if (m_isInitialized) return true;
+	if (s_instanceNum == 0 && !createSharedResources()) return false;
+	s_instanceNum++;
+	m_isInitialized = true;
+	SetViewportSize(width, height);
+
+	/* Create Texture object and unpack buffers (blank, re-allocated when the first frame arrives if the size differs) */
+	AllocateStorage(width, height, BACKGROUND_FORMAT_BGR);
+	return true;
+}
+
+void BackgroundDrawer::Finalize()
+{
+	if (!m_isInitialized) return;
+	DeleteStorage();
+	m_isInitialized = false;
+	if (--s_instanceNum == 0) deleteSharedResources();
 }
 
-void BackgroundDrawer_draw(int width, int height, uint8_t *data)
+void BackgroundDrawer::SetViewportSize(int width, int height)
 {
-	/* Update texture image for background */
-	glBindTexture(GL_TEXTURE_2D, s_textureId);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
+	m_viewportWidth = (width > 0) ? width : 1;
+	m_viewportHeight = (height > 0) ? height : 1;
+}
+
+void BackgroundDrawer::SetColorSpace(BackgroundColorSpace colorSpace, bool isFullRange)
+{
+	m_colorSpace = colorSpace;
+	m_isFullRange = isFullRange;
+}
+
+void BackgroundDrawer::DeleteStorage()
+{
+	for (int i = 0; i < PBO_NUM; i++) {
+		if (m_pboFence[i]) glDeleteSync(m_pboFence[i]);
+		m_pboFence[i] = 0;
+	}
+	if (m_pbo[0]) glDeleteBuffers(PBO_NUM, m_pbo);
+	for (int i = 0; i < PBO_NUM; i++) m_pbo[i] = 0;
+	if (m_planeNum > 0) glDeleteTextures(m_planeNum, m_textureId);
+	for (int i = 0; i < MAX_PLANE_NUM; i++) m_textureId[i] = 0;
+	m_planeNum = 0;
+	m_textureWidth = 0;
+	m_textureHeight = 0;
+}
+
+/* (Re)allocate textures and unpack buffers for the frame size and format. Immutable storage when available */
+void BackgroundDrawer::AllocateStorage(int width, int height, BackgroundFormat format)
+{
+	DeleteStorage();
+	Plane planes[MAX_PLANE_NUM];
+	m_planeNum = getPlanes(format, width, height, planes);
+	glGenTextures(m_planeNum, m_textureId);
+	for (int i = 0; i < m_planeNum; i++) {
+		glBindTexture(GL_TEXTURE_2D, m_textureId[i]);
+		if (GLEW_ARB_texture_storage) {
+			glTexStorage2D(GL_TEXTURE_2D, 1, planes[i].internalFormat, planes[i].width, planes[i].height);
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, 0, planes[i].internalFormat, planes[i].width, planes[i].height, 0, planes[i].pixelFormat, GL_UNSIGNED_BYTE, NULL);
+		}
+		/* The frame is resampled to the window by the sampler */
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenBuffers(PBO_NUM, m_pbo);
+	for (int i = 0; i < PBO_NUM; i++) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)getFrameSize(m_planeNum, planes), NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	m_textureWidth = width;
+	m_textureHeight = height;
+	m_textureFormat = format;
+	m_pboIndex = 0;
+}
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	//glGenerateMipmap(GL_TEXTURE_2D);
+/* Screen UV -> frame UV scale around the center (> 1: letterbox bars, < 1: cropped) */
+void BackgroundDrawer::UpdateUvScale()
+{
+	float viewportAspect = (float)m_viewportWidth / m_viewportHeight;
+	float imageAspect = (float)m_textureWidth / m_textureHeight;
+	m_uvScaleX = 1.0f;
+	m_uvScaleY = 1.0f;
+	if (m_fit == BACKGROUND_FIT_LETTERBOX) {
+		if (imageAspect > viewportAspect) m_uvScaleY = imageAspect / viewportAspect;
+		else m_uvScaleX = viewportAspect / imageAspect;
+	} else if (m_fit == BACKGROUND_FIT_CROP) {
+		if (imageAspect > viewportAspect) m_uvScaleX = viewportAspect / imageAspect;
+		else m_uvScaleY = imageAspect / viewportAspect;
+	}
+}
+
+/* Copy the frame into the next unpack buffer and let the GPU pull it into the textures asynchronously */
+void BackgroundDrawer::UploadFrame(int width, int height, int stride, BackgroundFormat format, const uint8_t *data)
+{
+	if ((format == BACKGROUND_FORMAT_NV12 || format == BACKGROUND_FORMAT_I420) && (width % 2 != 0 || height % 2 != 0)) {
+		if (!m_isOddSizeReported) printf("%dx%d: NV12 / I420 frames need an even width and height. Not drawn\n", width, height);
+		m_isOddSizeReported = true;
+		return;
+	}
+	if (width != m_textureWidth || height != m_textureHeight || format != m_textureFormat) AllocateStorage(width, height, format);
+	Plane planes[MAX_PLANE_NUM];
+	int planeNum = getPlanes(format, width, height, planes);
+	size_t size = getFrameSize(planeNum, planes);
+
+	/* The buffer was last used PBO_NUM frames ago, so the fence has normally signaled already */
+	int index = m_pboIndex;
+	m_pboIndex = (m_pboIndex + 1) % PBO_NUM;
+	bool isIdle = true;
+	if (m_pboFence[index]) {
+		GLenum status = glClientWaitSync(m_pboFence[index], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+		isIdle = (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED);
+		glDeleteSync(m_pboFence[index]);
+		m_pboFence[index] = 0;
+	}
+
+	/* Unsynchronized only when the GPU is known to be done with the buffer.
+	 * Otherwise (timeout, wait failure) the driver orphans it on the invalidating map instead */
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[index]);
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | (isIdle ? GL_MAP_UNSYNCHRONIZED_BIT : 0);
+	uint8_t *dst = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, access);
+	if (dst) {
+		/* Rows are packed tightly here, so the padding of the source stride never reaches the GPU */
+		size_t srcOffset = 0;
+		size_t dstOffset[MAX_PLANE_NUM];
+		size_t rowSize0 = (size_t)planes[0].width * planes[0].bytesPerTexel;
+		for (int i = 0; i < planeNum; i++) {
+			size_t rowSize = (size_t)planes[i].width * planes[i].bytesPerTexel;
+			size_t srcStride = stride * rowSize / rowSize0;
+			dstOffset[i] = (i == 0) ? 0 : dstOffset[i - 1] + (size_t)planes[i - 1].width * planes[i - 1].height * planes[i - 1].bytesPerTexel;
+			if (srcStride == rowSize) {
+				memcpy(dst + dstOffset[i], data + srcOffset, rowSize * planes[i].height);
+			} else {
+				for (int y = 0; y < planes[i].height; y++) memcpy(dst + dstOffset[i] + rowSize * y, data + srcOffset + srcStride * y, rowSize);
+			}
+			srcOffset += srcStride * planes[i].height;
+		}
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int i = 0; i < planeNum; i++) {
+			glBindTexture(GL_TEXTURE_2D, m_textureId[i]);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, planes[i].width, planes[i].height, planes[i].pixelFormat, GL_UNSIGNED_BYTE, (void*)dstOffset[i]);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		m_pboFence[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void BackgroundDrawer::ImageToNdc(float x, float y, float *ndcX, float *ndcY) const
+{
+	/* inverse of the UV mapping in the fragment shader (image y is top-down) */
+	*ndcX = (2.0f * x / m_textureWidth - 1.0f) / m_uvScaleX;
+	*ndcY = -(2.0f * y / m_textureHeight - 1.0f) / m_uvScaleY;
+}
+
+void BackgroundDrawer::Draw(int width, int height, int stride, BackgroundFormat format, const uint8_t *data)
+{
+	if (!m_isInitialized) return;
+	/* Update texture image for background (NULL: keep the current one) */
+	if (data) UploadFrame(width, height, stride, format, data);
+	UpdateUvScale();
 
 	glUseProgram(s_shaderId);
 
-	/* Bind Texture */
+	/* Bind Texture (one unit per plane) */
+	for (int i = 0; i < m_planeNum; i++) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textureId[i]);
+		glUniform1i(s_textureUniformId[i], i);
+	}
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, s_textureId);
-	glUniform1i(s_textureUniformId, 0);
+	glUniform2f(s_uvScaleUniformId, m_uvScaleX, m_uvScaleY);
+	glUniform1i(s_pixelFormatUniformId, m_textureFormat);
+	float yuvToRgb[9], yuvOffset[3];
+	getYuvToRgb(m_colorSpace, m_isFullRange, yuvToRgb, yuvOffset);
+	glUniformMatrix3fv(s_yuvToRgbUniformId, 1, GL_FALSE, yuvToRgb);
+	glUniform3fv(s_yuvOffsetUniformId, 1, yuvOffset);
 
 	/* Set attribute buffer */
 	glEnableVertexAttribArray(0);
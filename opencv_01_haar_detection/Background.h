@@ -1,8 +1,90 @@
 #ifndef BACKGROUND_H
 #define BACKGROUND_H
 
-void BackgroundDrawer_init(int width, int height);
-void BackgroundDrawer_finalize();
-void BackgroundDrawer_draw(int width, int height, uint8_t *data);
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+/* Pixel layout of the frames given to BackgroundDrawer::Draw (channel swizzle and YUV -> RGB are done in the shader).
+ * YUV planes follow each other in data, chroma rows with the stride scaled like the row size (NV12: the same, I420: half).
+ * NV12 / I420 need an even width and height (no room for a half chroma row / column in this layout) */
+typedef enum {
+	BACKGROUND_FORMAT_BGR,
+	BACKGROUND_FORMAT_RGB,
+	BACKGROUND_FORMAT_GRAY,
+	BACKGROUND_FORMAT_RGBA,
+	BACKGROUND_FORMAT_YUYV,     /* Y0 U Y1 V */
+	BACKGROUND_FORMAT_NV12,     /* Y plane, interleaved UV plane at half resolution */
+	BACKGROUND_FORMAT_I420,     /* Y, U and V planes, chroma at half resolution */
+} BackgroundFormat;
+
+/* YUV -> RGB matrix of YUV frames */
+typedef enum {
+	BACKGROUND_COLOR_SPACE_BT601,   /* SD, most webcams */
+	BACKGROUND_COLOR_SPACE_BT709,   /* HD */
+} BackgroundColorSpace;
+
+/* How a frame whose aspect ratio differs from the window's is placed */
+typedef enum {
+	BACKGROUND_FIT_STRETCH,
+	BACKGROUND_FIT_LETTERBOX,   /* whole frame visible, black bars */
+	BACKGROUND_FIT_CROP,        /* window filled, frame edges cut */
+} BackgroundFit;
+
+/*
+ * Streaming background: a frame is copied into a ring of unpack buffers and pulled into its textures by the GPU,
+ * then drawn as one quad fit into the current viewport. One instance per stream (e.g. one per tile);
+ * the shader program and the quad are shared by all instances. GL context thread only
+ */
+class BackgroundDrawer
+{
+public:
+	enum { MAX_PLANE_NUM = 3 };   /* I420 */
+
+	BackgroundDrawer();
+	~BackgroundDrawer();
+	/* width / height: size of the viewport the frame is drawn into (for the aspect fit) */
+	bool Initialize(int width, int height);
+	void Finalize();
+	void SetViewportSize(int width, int height);
+	void SetFit(BackgroundFit fit) { m_fit = fit; }
+	/* isFullRange: Y and UV use 0 - 255 (JPEG style). Otherwise limited range, Y 16 - 235 and UV 16 - 240 (default BT.601 limited) */
+	void SetColorSpace(BackgroundColorSpace colorSpace, bool isFullRange);
+	/* Frame at capture resolution. stride is in bytes; scaling to the viewport happens on the GPU.
+	 * data = NULL redraws the last uploaded frame, as does a frame of an unsupported size */
+	void Draw(int width, int height, int stride, BackgroundFormat format, const uint8_t *data);
+	/* Map a pixel position of the last drawn frame to normalized device coordinates of the viewport */
+	void ImageToNdc(float x, float y, float *ndcX, float *ndcY) const;
+
+private:
+	BackgroundDrawer(const BackgroundDrawer&);
+	BackgroundDrawer& operator=(const BackgroundDrawer&);
+	void AllocateStorage(int width, int height, BackgroundFormat format);
+	void DeleteStorage();
+	void UploadFrame(int width, int height, int stride, BackgroundFormat format, const uint8_t *data);
+	void UpdateUvScale();
+
+private:
+	enum { PBO_NUM = 3 };   /* frames in flight between the CPU copy and the texture upload */
+	bool m_isInitialized;
+	int m_viewportWidth;
+	int m_viewportHeight;
+	BackgroundFit m_fit;
+	float m_uvScaleX;
+	float m_uvScaleY;
+	BackgroundColorSpace m_colorSpace;
+	bool m_isFullRange;
+	bool m_isOddSizeReported;
+
+	/* texture storage is allocated once per size / format, frames go through a ring of unpack buffers */
+	GLuint m_textureId[MAX_PLANE_NUM];
+	int m_planeNum;
+	int m_textureWidth;
+	int m_textureHeight;
+	BackgroundFormat m_textureFormat;
+	GLuint m_pbo[PBO_NUM];
+	GLsync m_pboFence[PBO_NUM];
+	int m_pboIndex;
+};
 
 #endif
@@ -0,0 +1,177 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctime>
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "ResourcePack.h"
+#include "FramePipeline.h"
+#include "BatchRenderer.h"
+#include "AppSettings.h"
+
+/*** Macro ***/
+#define DEFAULT_WIDTH 1280
+#define DEFAULT_HEIGHT 720
+#define DEFAULT_FPS 30.0
+#define DEFAULT_FORMAT "avi"
+
+/*** Function ***/
+static void printUsage(const char *name)
+{
+	printf("usage: %s [options] VIDEO...\n", name);
+	printf("  renders the overlay on every frame of each video without a display (EGL surfaceless / OSMesa) as fast as possible\n");
+	printf("  --jobs K          videos rendered at once, one context and pipeline each (default: min(videos, cores / 2))\n");
+	printf("  --output DIR      where <video name>_ar.<format> are written (default: next to each video)\n");
+	printf("  --format FORMAT   avi, mp4, y4m or png (numbered images) (default %s)\n", DEFAULT_FORMAT);
+	printf("  --size WxH        output size (default %dx%d)\n", DEFAULT_WIDTH, DEFAULT_HEIGHT);
+	printf("  --fps FPS         frame rate written into the outputs (default %.0f)\n", DEFAULT_FPS);
+	printf("  --detector        haar: %s (default), dnn:MODEL: ONNX model file on OpenCV DNN, required (none is shipped; no tracking)\n", HAAR_FILENAME);
+	printf("                    multi: %s and %s on one shared image pyramid (no tracking)\n", HAAR_FILENAME, SECOND_HAAR_FILENAME);
+	printf("  --detectors N     detector workers per video when not tracking (default 1)\n");
+	printf("  --model PATH      overlay model, repeat to rotate through several (default: the interactive app's)\n");
+}
+
+/* DIR/<name without extension>_ar.<format>, or next to the video without DIR */
+static std::string makeOutputPath(const std::string &inputPath, const std::string &outputDir, const std::string &format)
+{
+	size_t slash = inputPath.find_last_of("/\\");
+	std::string dir = (slash == std::string::npos) ? "" : inputPath.substr(0, slash + 1);
+	std::string name = (slash == std::string::npos) ? inputPath : inputPath.substr(slash + 1);
+	size_t dot = name.find_last_of('.');
+	if (dot != std::string::npos && dot > 0) name = name.substr(0, dot);
+	if (!outputDir.empty()) {
+		dir = outputDir;
+		if (dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\') dir += "/";
+	}
+	return dir + name + "_ar." + format;
+}
+
+int main(int argc, char *argv[])
+{
+	/*** Initialize ***/
+	/* Resources are read from the pack if it exists, otherwise from the resource directory */
+	if (!Resource_openPack(RESOURCE_PACK_FILENAME)) printf("%s is not found. Use the resource directory\n", RESOURCE_PACK_FILENAME);
+
+	/* Parse arguments */
+	std::vector<std::string> inputPaths;
+	std::vector<std::string> modelPaths;
+	std::string outputDir;
+	std::string format = DEFAULT_FORMAT;
+	int jobNum = 0;
+	int width = DEFAULT_WIDTH;
+	int height = DEFAULT_HEIGHT;
+	double fps = DEFAULT_FPS;
+	int detectorNum = 1;
+	DetectorBackend detectorBackend = DETECTOR_BACKEND_HAAR;
+	const char *dnnModelPath = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+			jobNum = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			outputDir = argv[++i];
+		} else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			format = argv[++i];
+		} else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+			i++;
+		} else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+			fps = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--detector") == 0 && i + 1 < argc && strncmp(argv[i + 1], "dnn:", 4) == 0 && argv[i + 1][4] != '\0') {
+			detectorBackend = DETECTOR_BACKEND_DNN;
+			dnnModelPath = argv[++i] + 4;
+		} else if (strcmp(argv[i], "--detector") == 0 && i + 1 < argc && strcmp(argv[i + 1], "haar") == 0) {
+			detectorBackend = DETECTOR_BACKEND_HAAR;
+			i++;
+		} else if (strcmp(argv[i], "--detector") == 0 && i + 1 < argc && strcmp(argv[i + 1], "multi") == 0) {
+			detectorBackend = DETECTOR_BACKEND_MULTI_HAAR;
+			i++;
+		} else if (strcmp(argv[i], "--detectors") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+			detectorNum = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+			modelPaths.push_back(argv[++i]);
+		} else if (argv[i][0] != '-') {
+			inputPaths.push_back(argv[i]);
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (inputPaths.empty()) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (modelPaths.empty()) modelPaths.assign(MODEL_FILENAMES, MODEL_FILENAMES + sizeof(MODEL_FILENAMES) / sizeof(MODEL_FILENAMES[0]));
+
+	/* Videos share the cores: half of them each by default (decode, detection, drawing and encoding run in parallel) */
+	int coreNum = (std::max)(1, (int)std::thread::hardware_concurrency());
+	if (jobNum == 0) jobNum = (std::max)(1, coreNum / 2);
+	jobNum = (std::min)(jobNum, (int)inputPaths.size());
+#ifndef _WIN32
+	/* llvmpipe rasterizes on as many threads as cores in every context: split them between the videos */
+	if (getenv("LP_NUM_THREADS") == NULL) setenv("LP_NUM_THREADS", std::to_string((std::max)(1, coreNum / jobNum)).c_str(), 0);
+#endif
+
+	BatchRendererConfig config;
+	BatchRenderer_getDefaultConfig(&config);
+	config.workerNum = jobNum;
+	config.width = width;
+	config.height = height;
+	config.fps = fps;
+	config.modelPaths = modelPaths;
+	config.streamConfig.backend = detectorBackend;
+	config.streamConfig.cascadePath = HAAR_FILENAME;
+	config.streamConfig.cascadePaths.push_back(HAAR_FILENAME);
+	config.streamConfig.cascadePaths.push_back(SECOND_HAAR_FILENAME);
+	config.streamConfig.dnnModelPath = dnnModelPath;
+	config.streamConfig.useTracking = USE_TRACKING;
+	config.streamConfig.useMotionGate = USE_MOTION_GATE;
+	config.streamConfig.detectorNum = detectorNum;
+	config.streamConfig.detectBatchSize = DETECT_BATCH_SIZE;
+	config.streamConfig.detectInFlight = DETECT_IN_FLIGHT;
+	config.streamConfig.isLossless = true;
+	BatchRenderer renderer;
+	if (!renderer.Initialize(config)) return 1;
+
+	std::vector<BatchJob> jobs;
+	for (size_t i = 0; i < inputPaths.size(); i++) {
+		BatchJob job;
+		job.inputPath = inputPaths[i];
+		job.outputPath = makeOutputPath(inputPaths[i], outputDir, format);
+		jobs.push_back(job);
+	}
+	printf("rendering %d videos, %d at once, on %d cores\n", (int)jobs.size(), jobNum, coreNum);
+
+	/*** Run ***/
+	std::vector<BatchJobResult> results;
+	std::clock_t cpuStartTime = std::clock();
+	double startTime = FramePipeline_getTime();
+	renderer.Run(jobs, &results);
+	double elapsedTime = FramePipeline_getTime() - startTime;
+	double cpuTime = (double)(std::clock() - cpuStartTime) / CLOCKS_PER_SEC;
+	renderer.Finalize();
+
+	/*** Report ***/
+	int failedNum = 0;
+	uint64_t totalFrameNum = 0;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		const BatchJobResult &result = results[i];
+		if (!result.isSucceeded) failedNum++;
+		totalFrameNum += result.frameNum;
+		printf("%s -> %s: %s, %d frames in %.2f s (%.1f fps), dropped %llu\n", jobs[i].inputPath.c_str(), jobs[i].outputPath.c_str(),
+			result.isSucceeded ? "done" : "FAILED", result.frameNum, result.elapsedTime,
+			result.elapsedTime > 0 ? result.frameNum / result.elapsedTime : 0.0, (unsigned long long)result.droppedNum);
+	}
+	/* std::clock is the CPU time of every thread of the process (POSIX) */
+	double totalFps = elapsedTime > 0 ? totalFrameNum / elapsedTime : 0.0;
+	printf("total: %llu frames in %.2f s = %.1f fps, %.2f fps per core (%d cores)\n", (unsigned long long)totalFrameNum, elapsedTime, totalFps, totalFps / coreNum, coreNum);
+	printf("       CPU %.1f s = %.2f frames per CPU second\n", cpuTime, cpuTime > 0 ? totalFrameNum / cpuTime : 0.0);
+	return failedNum == 0 ? 0 : 1;
+}
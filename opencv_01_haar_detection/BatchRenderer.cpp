@@ -0,0 +1,269 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+/* for GL */
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "shader.h"
+#include "AssetManager.h"
+#include "InstancedOverlay.h"
+#include "FramePipeline.h"
+#include "FrameReadback.h"
+#include "FrameRecorder.h"
+#include "VideoStream.h"
+#include "HeadlessContext.h"
+#include "BatchRenderer.h"
+
+/*** Macro ***/
+#define READBACK_DEPTH 3	// frames being read back at once (pack buffers)
+#define RECORD_QUEUE_SIZE 8	// read back frames waiting for the encoder
+#define DETECTION_WAIT_SEC 1.0	// for the detection of the frame just drawn (normally a frame time at most)
+#define MODEL_SWITCH_SEC 2.0	// video time without detection before the next model is put on
+
+/*** Functions ***/
+void BatchRenderer_getDefaultConfig(BatchRendererConfig *config)
+{
+	config->workerNum = 1;
+	config->width = 1280;
+	config->height = 720;
+	config->fps = 30;
+	VideoStream_getDefaultConfig(&config->streamConfig);
+	config->vertexShaderPath = "resource/InstancedVertexShader.vertexshader";
+	config->fragmentShaderPath = "resource/TextureFragmentShader.fragmentshader";
+	config->texturePath = "resource/uvmap.DDS";
+	config->modelPaths.clear();
+}
+
+BatchRenderer::BatchRenderer()
+	: m_nextJob(0)
+{
+	BatchRenderer_getDefaultConfig(&m_config);
+}
+
+BatchRenderer::~BatchRenderer()
+{
+	Finalize();
+}
+
+bool BatchRenderer::Initialize(const BatchRendererConfig &config)
+{
+	Finalize();
+	m_config = config;
+	m_config.workerNum = (std::max)(1, config.workerNum);
+	m_config.streamConfig.isLossless = true;
+	if (!m_mainContext.Initialize() || !m_mainContext.MakeCurrent() || !HeadlessContext::InitializeGl()) {
+		m_mainContext.Finalize();
+		return false;
+	}
+
+	/* Assets are loaded once here and used by every worker context. Not the program: its uniforms would be shared too */
+	m_assetManager.reset(new AssetManager());
+	m_texture = m_assetManager->LoadTexture(m_config.texturePath);
+	bool isLoaded = m_texture && m_meshPack.Load(m_config.modelPaths);
+	for (int i = 0; i < m_meshPack.GetModelNum(); i++) m_modelScales.push_back(2.0f / m_meshPack.GetModel(i).sizeY);
+	/* complete before another context uses them */
+	glFinish();
+	m_mainContext.ReleaseCurrent();
+	if (!isLoaded) {
+		printf("Impossible to load the overlay assets\n");
+		Finalize();
+		return false;
+	}
+	m_assetManager->PrintReport();
+
+	for (int i = 0; i < m_config.workerNum; i++) {
+		m_workerContexts.push_back(std::unique_ptr<HeadlessContext>(new HeadlessContext()));
+		if (!m_workerContexts[i]->Initialize(&m_mainContext)) {
+			Finalize();
+			return false;
+		}
+	}
+	return true;
+}
+
+void BatchRenderer::Finalize()
+{
+	m_workerContexts.clear();
+	if (m_assetManager) {
+		/* GL objects are deleted with the last handle: the context has to be current */
+		m_mainContext.MakeCurrent();
+		m_meshPack.Finalize();
+		m_modelScales.clear();
+		m_texture.reset();
+		m_assetManager.reset();
+		m_mainContext.ReleaseCurrent();
+	}
+	m_mainContext.Finalize();
+}
+
+void BatchRenderer::Run(const std::vector<BatchJob> &jobs, std::vector<BatchJobResult> *results)
+{
+	results->assign(jobs.size(), BatchJobResult());
+	m_nextJob = 0;
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < m_workerContexts.size() && i < jobs.size(); i++) {
+		workers.push_back(std::thread(&BatchRenderer::WorkerLoop, this, (int)i, &jobs, results));
+	}
+	for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+void BatchRenderer::WorkerLoop(int workerIndex, const std::vector<BatchJob> *jobs, std::vector<BatchJobResult> *results)
+{
+	HeadlessContext &context = *m_workerContexts[workerIndex];
+	bool isCurrent = context.MakeCurrent();
+	if (!isCurrent) printf("Impossible to use the context of worker %d\n", workerIndex);
+	while (true) {
+		int index = m_nextJob++;
+		if (index >= (int)jobs->size()) break;
+		BatchJobResult &result = (*results)[index];
+		if (isCurrent) {
+			result = RenderJob((*jobs)[index]);
+		} else {
+			result.isSucceeded = false;
+			result.frameNum = 0;
+			result.elapsedTime = 0;
+			result.droppedNum = 0;
+		}
+	}
+	context.ReleaseCurrent();
+}
+
+BatchJobResult BatchRenderer::RenderJob(const BatchJob &job)
+{
+	BatchJobResult result;
+	result.isSucceeded = false;
+	result.frameNum = 0;
+	result.elapsedTime = 0;
+	result.droppedNum = 0;
+	int width = m_config.width;
+	int height = m_config.height;
+	double startTime = FramePipeline_getTime();
+
+	/* Offscreen target of this context: color + depth renderbuffers, and a VAO for the background.
+	 * VAOs and FBOs are not shared between contexts */
+	GLuint fbo = 0;
+	GLuint renderbuffers[2] = { 0, 0 };
+	GLuint vao = 0;
+	GLuint programId = LoadShaders(m_config.vertexShaderPath, m_config.fragmentShaderPath);
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glViewport(0, 0, width, height);
+	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glEnable(GL_CULL_FACE);
+
+	InstancedOverlay overlay;
+	FrameReadback readback(READBACK_DEPTH);
+	FrameRecorder recorder;
+	VideoStream stream;
+	FrameRecorderConfig recorderConfig;
+	FrameRecorderConfig_getDefaultConfig(&recorderConfig);
+	recorderConfig.fps = m_config.fps;
+	recorderConfig.queueSize = RECORD_QUEUE_SIZE;
+	recorderConfig.isLossless = true;
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE || programId == 0 || !overlay.Initialize(programId, &m_meshPack) || !readback.Initialize(width, height)
+		|| !stream.Start("video:" + job.inputPath, width, height, m_config.streamConfig)
+		|| !recorder.Start(job.outputPath.c_str(), width, height, recorderConfig)) {
+		printf("Impossible to render %s\n", job.inputPath.c_str());
+	} else {
+		/* The interactive app's initial camera: on +Z toward -Z, orthogonal */
+		glm::mat4 viewProjection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -10.0f, 100.0f) * glm::lookAt(glm::vec3(0, 0, 5), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+		int modelNum = m_meshPack.GetModelNum();
+		int modelIndex = 0;
+		int undetectedFrameNum = 0;
+		int modelSwitchFrameNum = (int)(MODEL_SWITCH_SEC * m_config.fps);
+		float rotY = 0.0f;
+		ReadbackFrame readbackFrame;
+		while (true) {
+			/* Background: the next frame, as soon as it is decoded */
+			stream.UpdateDetection();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			uint64_t frameId = 0;
+			double captureTime = 0;
+			if (!stream.Draw(&frameId, &captureTime)) {
+				if (stream.IsFinished()) break;
+				std::this_thread::yield();
+				continue;
+			}
+			/* Every frame is detected in lossless mode: the overlay goes with the detections of this very frame */
+			double waitStartTime = FramePipeline_getTime();
+			while (stream.GetDetectionFrameId() < frameId && FramePipeline_getTime() - waitStartTime < DETECTION_WAIT_SEC) {
+				std::this_thread::yield();
+				stream.UpdateDetection();
+			}
+
+			/* Overlay: one instance per detection, the model switched after a while without detection */
+			glClear(GL_DEPTH_BUFFER_BIT);
+			const std::vector<cv::Rect> &listDet = stream.GetDetections();
+			undetectedFrameNum = listDet.empty() ? undetectedFrameNum + 1 : 0;
+			if (undetectedFrameNum == modelSwitchFrameNum) modelIndex = (modelIndex + 1) % modelNum;
+			rotY += 0.8f;
+			overlay.Clear();
+			for (size_t i = 0; i < listDet.size(); i++) {
+				float x0, y0, x1, y1;
+				stream.BoxToNdc(listDet[i], &x0, &y0, &x1, &y1);
+				OverlayInstance instance;
+				instance.x = (x0 + x1) / 2;
+				instance.y = (y0 + y1) / 2;
+				instance.scale = (y0 - y1) / 2 * 0.75f * m_modelScales[modelIndex];
+				instance.rotation = rotY / (2 * 3.14f);
+				overlay.Add(modelIndex, instance);
+			}
+			overlay.Draw(viewProjection, m_texture.get());
+
+			/* Readback: completed frames go to the encoder. The ring is only waited for when every buffer is pending */
+			while (readback.Acquire(&readbackFrame)) {
+				recorder.Push(readbackFrame);
+				readback.Release();
+			}
+			if (readback.IsFull() && readback.Acquire(&readbackFrame, true)) {
+				recorder.Push(readbackFrame);
+				readback.Release();
+			}
+			readback.Read(frameId, captureTime);
+			glFlush();
+			result.frameNum++;
+		}
+		while (readback.Acquire(&readbackFrame, true)) {
+			recorder.Push(readbackFrame);
+			readback.Release();
+		}
+		recorder.Stop();
+		result.isSucceeded = true;
+	}
+	stream.Stop();
+	result.elapsedTime = FramePipeline_getTime() - startTime;
+	result.droppedNum = stream.GetDroppedNum() + readback.GetDroppedNum() + recorder.GetDroppedNum();
+
+	readback.Finalize();
+	overlay.Finalize();
+	glBindVertexArray(0);
+	glDeleteVertexArrays(1, &vao);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteFramebuffers(1, &fbo);
+	if (programId != 0) glDeleteProgram(programId);
+	return result;
+}
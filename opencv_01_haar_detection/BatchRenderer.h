@@ -0,0 +1,78 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include <GL/glew.h>
+
+#include "HeadlessContext.h"
+#include "AssetManager.h"
+#include "MeshPack.h"
+#include "VideoStream.h"
+
+typedef struct {
+	int workerNum;           /* videos rendered at once */
+	int width;               /* output size */
+	int height;
+	double fps;              /* written into the outputs */
+	VideoStreamConfig streamConfig;   /* lossless whatever is set */
+	const char *vertexShaderPath;     /* overlay program (built by each job) */
+	const char *fragmentShaderPath;
+	const char *texturePath;
+	std::vector<std::string> modelPaths;
+} BatchRendererConfig;
+
+void BatchRenderer_getDefaultConfig(BatchRendererConfig *config);
+
+typedef struct {
+	std::string inputPath;   /* video file */
+	std::string outputPath;  /* as FrameRecorder: video, .y4m or .png */
+} BatchJob;
+
+typedef struct {
+	bool isSucceeded;
+	int frameNum;
+	double elapsedTime;      /* seconds */
+	uint64_t droppedNum;     /* should stay 0: every stage waits for the next one */
+} BatchJobResult;
+
+/*
+ * Overlay rendering of video files without a display: every frame of a video is decoded (capture thread), detected
+ * (detection threads), drawn into a framebuffer object, read back asynchronously and encoded (recorder thread),
+ * the stages running in parallel and none of them dropping frames. workerNum videos go at once, each on a worker thread
+ * with its own headless context. The contexts share the overlay meshes and texture, loaded once
+ */
+class BatchRenderer
+{
+public:
+	BatchRenderer();
+	~BatchRenderer();
+	/* Creates the contexts and loads the assets. Calling thread (which then has no context current) */
+	bool Initialize(const BatchRendererConfig &config);
+	void Finalize();
+	/* Renders every job (in order of start), returns when all are done. results has one entry per job */
+	void Run(const std::vector<BatchJob> &jobs, std::vector<BatchJobResult> *results);
+
+private:
+	BatchRenderer(const BatchRenderer&);
+	BatchRenderer& operator=(const BatchRenderer&);
+
+	void WorkerLoop(int workerIndex, const std::vector<BatchJob> *jobs, std::vector<BatchJobResult> *results);
+	BatchJobResult RenderJob(const BatchJob &job);
+
+private:
+	BatchRendererConfig m_config;
+	HeadlessContext m_mainContext;       /* owns the shared objects */
+	std::vector<std::unique_ptr<HeadlessContext> > m_workerContexts;
+	std::unique_ptr<AssetManager> m_assetManager;
+	TextureHandle m_texture;
+	MeshPack m_meshPack;                 /* every model in one buffer */
+	std::vector<float> m_modelScales;    /* fits a model to -1.0 ~ 1.0 */
+	std::atomic<int> m_nextJob;
+};
+
+#endif
@@ -0,0 +1,405 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+/* SSE2 is always available on x86-64. Other targets use the scalar path */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "BcEncoder.h"
+
+/*** Macro ***/
+/* Settings */
+#define MIN_BLOCKS_PER_THREAD 256
+
+/* DDS header values */
+#define DDSD_CAPS        0x1
+#define DDSD_HEIGHT      0x2
+#define DDSD_WIDTH       0x4
+#define DDSD_PIXELFORMAT 0x1000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE  0x80000
+#define DDPF_FOURCC      0x4
+#define DDSCAPS_COMPLEX  0x8
+#define DDSCAPS_TEXTURE  0x1000
+#define DDSCAPS_MIPMAP   0x400000
+#define DXGI_FORMAT_BC7_UNORM 98
+#define DDS_DIMENSION_TEXTURE2D 3
+#define MAKE_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/*** Functions ***/
+static inline int blockBytes(BcFormat format)
+{
+	return format == BC_FORMAT_BC1 ? 8 : 16;
+}
+
+size_t BcEncoder_getCompressedSize(int width, int height, BcFormat format)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+/* Gather a 4x4 block (RGBA8, 64 bytes). Edge blocks repeat the last row / column */
+static void fetchBlock(const uint8_t *rgba, int width, int height, int bx, int by, uint8_t block[64])
+{
+	int x0 = bx * 4;
+	int y0 = by * 4;
+	if (x0 + 4 <= width && y0 + 4 <= height) {
+		for (int y = 0; y < 4; y++) {
+			memcpy(&block[y * 16], &rgba[((size_t)(y0 + y) * width + x0) * 4], 16);
+		}
+		return;
+	}
+	for (int y = 0; y < 4; y++) {
+		int sy = std::min(y0 + y, height - 1);
+		for (int x = 0; x < 4; x++) {
+			int sx = std::min(x0 + x, width - 1);
+			memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+		}
+	}
+}
+
+/* Bounding box of the block colors, inset by 1/16 of the range to reduce the error of the interpolated colors */
+static void getInsetBoundingBox(const uint8_t block[64], uint8_t minColor[4], uint8_t maxColor[4])
+{
+#ifdef BC_USE_SSE2
+	__m128i r0 = _mm_loadu_si128((const __m128i*)&block[0]);
+	__m128i r1 = _mm_loadu_si128((const __m128i*)&block[16]);
+	__m128i r2 = _mm_loadu_si128((const __m128i*)&block[32]);
+	__m128i r3 = _mm_loadu_si128((const __m128i*)&block[48]);
+	__m128i mn = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+	__m128i mx = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+	mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 8));
+	mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4));
+	mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 8));
+	mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 4));
+	uint32_t mnPacked = (uint32_t)_mm_cvtsi128_si32(mn);
+	uint32_t mxPacked = (uint32_t)_mm_cvtsi128_si32(mx);
+	memcpy(minColor, &mnPacked, 4);
+	memcpy(maxColor, &mxPacked, 4);
+#else
+	for (int c = 0; c < 4; c++) {
+		minColor[c] = 255;
+		maxColor[c] = 0;
+	}
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 4; c++) {
+			minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+			maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+		}
+	}
+#endif
+	for (int c = 0; c < 4; c++) {
+		int inset = (maxColor[c] - minColor[c]) >> 4;
+		minColor[c] = (uint8_t)(minColor[c] + inset);
+		maxColor[c] = (uint8_t)(maxColor[c] - inset);
+	}
+}
+
+/* Project every pixel on the line from endpoint0 to endpoint1 and quantize the position to [0, steps] */
+static void projectIndices(const uint8_t block[64], const uint8_t endpoint0[4], const uint8_t endpoint1[4], bool useAlpha, int steps, uint8_t indices[16])
+{
+	int axis[4];
+	int lengthSq = 0;
+	for (int c = 0; c < 4; c++) {
+		axis[c] = (c == 3 && !useAlpha) ? 0 : endpoint1[c] - endpoint0[c];
+		lengthSq += axis[c] * axis[c];
+	}
+	if (lengthSq == 0) {
+		memset(indices, 0, 16);
+		return;
+	}
+	float scale = (float)steps / lengthSq;
+#ifdef BC_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i axis16 = _mm_setr_epi16((short)axis[0], (short)axis[1], (short)axis[2], (short)axis[3], (short)axis[0], (short)axis[1], (short)axis[2], (short)axis[3]);
+	const __m128i origin16 = _mm_setr_epi16(endpoint0[0], endpoint0[1], endpoint0[2], endpoint0[3], endpoint0[0], endpoint0[1], endpoint0[2], endpoint0[3]);
+	const __m128 scale4 = _mm_set1_ps(scale);
+	const __m128 half4 = _mm_set1_ps(0.5f);
+	__m128i quantized[4];
+	for (int row = 0; row < 4; row++) {
+		__m128i pixels = _mm_loadu_si128((const __m128i*)&block[row * 16]);
+		/* dot(pixel - endpoint0, axis) as (r+g, b+a) partial sums per pixel */
+		__m128i lo = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(pixels, zero), origin16), axis16);
+		__m128i hi = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(pixels, zero), origin16), axis16);
+		__m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+		__m128 t = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(even, odd)), scale4), half4);
+		quantized[row] = _mm_cvttps_epi32(_mm_max_ps(t, _mm_setzero_ps()));
+	}
+	__m128i packed = _mm_packs_epi32(quantized[0], quantized[1]);
+	packed = _mm_min_epi16(packed, _mm_set1_epi16((short)steps));
+	__m128i packed2 = _mm_packs_epi32(quantized[2], quantized[3]);
+	packed2 = _mm_min_epi16(packed2, _mm_set1_epi16((short)steps));
+	_mm_storeu_si128((__m128i*)indices, _mm_packus_epi16(packed, packed2));
+#else
+	for (int i = 0; i < 16; i++) {
+		int dot = 0;
+		for (int c = 0; c < 4; c++) dot += (block[i * 4 + c] - endpoint0[c]) * axis[c];
+		float t = dot * scale + 0.5f;
+		int index = t > 0 ? (int)t : 0;
+		indices[i] = (uint8_t)std::min(index, steps);
+	}
+#endif
+}
+
+static inline uint16_t toRGB565(const uint8_t color[4])
+{
+	return (uint16_t)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+static inline void fromRGB565(uint16_t packed, uint8_t color[4])
+{
+	int r = (packed >> 11) & 0x1F;
+	int g = (packed >> 5) & 0x3F;
+	int b = packed & 0x1F;
+	color[0] = (uint8_t)((r << 3) | (r >> 2));
+	color[1] = (uint8_t)((g << 2) | (g >> 4));
+	color[2] = (uint8_t)((b << 3) | (b >> 2));
+	color[3] = 255;
+}
+
+/* BC1 color block (always 4-color mode, so it is also valid as the color part of BC3) */
+static void encodeColorBlock(const uint8_t block[64], uint8_t *dst)
+{
+	uint8_t minColor[4], maxColor[4];
+	getInsetBoundingBox(block, minColor, maxColor);
+	uint16_t color0 = toRGB565(maxColor);
+	uint16_t color1 = toRGB565(minColor);
+	uint32_t bits = 0;
+	/* color0 >= color1 always holds since maxColor >= minColor per channel. If equal, every pixel uses index 0 */
+	if (color0 != color1) {
+		uint8_t endpoint0[4], endpoint1[4];
+		fromRGB565(color1, endpoint0);
+		fromRGB565(color0, endpoint1);
+		uint8_t t[16];
+		projectIndices(block, endpoint0, endpoint1, false, 3, t);
+		/* position on the line (color1 -> color0) to BC1 index */
+		static const uint32_t indexMap[4] = { 1, 3, 2, 0 };
+		for (int i = 0; i < 16; i++) bits |= indexMap[t[i]] << (2 * i);
+	}
+	dst[0] = (uint8_t)(color0 & 0xFF);
+	dst[1] = (uint8_t)(color0 >> 8);
+	dst[2] = (uint8_t)(color1 & 0xFF);
+	dst[3] = (uint8_t)(color1 >> 8);
+	memcpy(&dst[4], &bits, 4);
+}
+
+/* BC3 alpha block (8-alpha mode) */
+static void encodeAlphaBlock(const uint8_t block[64], uint8_t *dst)
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for (int i = 0; i < 16; i++) {
+		minAlpha = std::min(minAlpha, (int)block[i * 4 + 3]);
+		maxAlpha = std::max(maxAlpha, (int)block[i * 4 + 3]);
+	}
+	uint64_t bits = 0;
+	if (maxAlpha != minAlpha) {
+		int range = maxAlpha - minAlpha;
+		for (int i = 0; i < 16; i++) {
+			int t = ((block[i * 4 + 3] - minAlpha) * 7 + range / 2) / range;
+			/* t = 0 is alpha1 (index 1), t = 7 is alpha0 (index 0), the others are interpolated (index 2-7) */
+			uint64_t index = (t == 0) ? 1 : (t == 7) ? 0 : (uint64_t)(8 - t);
+			bits |= index << (3 * i);
+		}
+	}
+	dst[0] = (uint8_t)maxAlpha;
+	dst[1] = (uint8_t)minAlpha;
+	for (int i = 0; i < 6; i++) dst[2 + i] = (uint8_t)(bits >> (8 * i));
+}
+
+/* little-endian bit writer for 128-bit BC7 blocks */
+static inline void writeBits(uint8_t *dst, int &position, uint32_t value, int bitNum)
+{
+	for (int i = 0; i < bitNum; i++, position++) {
+		if (value & (1u << i)) dst[position >> 3] |= (uint8_t)(1 << (position & 7));
+	}
+}
+
+/* BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints with a unique p-bit each, 4-bit indices */
+static void encodeBC7Block(const uint8_t block[64], uint8_t *dst)
+{
+	uint8_t endpoint[2][4];
+	getInsetBoundingBox(block, endpoint[0], endpoint[1]);
+
+	/* Quantize to 7 bits + p-bit. The p-bit follows the majority of the channel LSBs */
+	int quantized[2][4];
+	int pbit[2];
+	uint8_t reconstructed[2][4];
+	for (int e = 0; e < 2; e++) {
+		int lsbCount = (endpoint[e][0] & 1) + (endpoint[e][1] & 1) + (endpoint[e][2] & 1) + (endpoint[e][3] & 1);
+		pbit[e] = lsbCount >= 2 ? 1 : 0;
+		for (int c = 0; c < 4; c++) {
+			quantized[e][c] = std::min(std::max((endpoint[e][c] - pbit[e] + 1) >> 1, 0), 127);
+			reconstructed[e][c] = (uint8_t)((quantized[e][c] << 1) | pbit[e]);
+		}
+	}
+
+	uint8_t indices[16];
+	projectIndices(block, reconstructed[0], reconstructed[1], true, 15, indices);
+
+	/* The MSB of the anchor index (pixel 0) is implicit zero */
+	if (indices[0] & 0x8) {
+		for (int c = 0; c < 4; c++) std::swap(quantized[0][c], quantized[1][c]);
+		std::swap(pbit[0], pbit[1]);
+		for (int i = 0; i < 16; i++) indices[i] = (uint8_t)(15 - indices[i]);
+	}
+
+	memset(dst, 0, 16);
+	int position = 0;
+	writeBits(dst, position, 1 << 6, 7);   /* mode 6 */
+	for (int c = 0; c < 4; c++) {
+		writeBits(dst, position, quantized[0][c], 7);
+		writeBits(dst, position, quantized[1][c], 7);
+	}
+	writeBits(dst, position, pbit[0], 1);
+	writeBits(dst, position, pbit[1], 1);
+	writeBits(dst, position, indices[0], 3);
+	for (int i = 1; i < 16; i++) writeBits(dst, position, indices[i], 4);
+}
+
+static void compressBlockRows(const uint8_t *rgba, int width, int height, BcFormat format, uint8_t *dst, int blockRowStart, int blockRowEnd)
+{
+	int blocksX = (width + 3) / 4;
+	int bytes = blockBytes(format);
+	uint8_t block[64];
+	for (int by = blockRowStart; by < blockRowEnd; by++) {
+		uint8_t *out = dst + (size_t)by * blocksX * bytes;
+		for (int bx = 0; bx < blocksX; bx++, out += bytes) {
+			fetchBlock(rgba, width, height, bx, by, block);
+			switch (format) {
+			case BC_FORMAT_BC1:
+				encodeColorBlock(block, out);
+				break;
+			case BC_FORMAT_BC3:
+				encodeAlphaBlock(block, out);
+				encodeColorBlock(block, out + 8);
+				break;
+			case BC_FORMAT_BC7:
+				encodeBC7Block(block, out);
+				break;
+			}
+		}
+	}
+}
+
+void BcEncoder_compress(const uint8_t *rgba, int width, int height, BcFormat format, uint8_t *dst, int numThreads)
+{
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+	/* Small mip levels are not worth starting threads for */
+	numThreads = std::min(numThreads, (blocksX * blocksY) / MIN_BLOCKS_PER_THREAD);
+	numThreads = std::min(numThreads, blocksY);
+	if (numThreads <= 1) {
+		compressBlockRows(rgba, width, height, format, dst, 0, blocksY);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < numThreads; i++) {
+		int rowStart = blocksY * i / numThreads;
+		int rowEnd = blocksY * (i + 1) / numThreads;
+		threads.push_back(std::thread(compressBlockRows, rgba, width, height, format, dst, rowStart, rowEnd));
+	}
+	for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+}
+
+/* 2x2 box filter. Odd sizes repeat the last row / column */
+static void downsample(const std::vector<uint8_t> &src, int width, int height, std::vector<uint8_t> &dst, int dstWidth, int dstHeight)
+{
+	dst.resize((size_t)dstWidth * dstHeight * 4);
+	for (int y = 0; y < dstHeight; y++) {
+		const uint8_t *row0 = &src[(size_t)std::min(y * 2, height - 1) * width * 4];
+		const uint8_t *row1 = &src[(size_t)std::min(y * 2 + 1, height - 1) * width * 4];
+		uint8_t *out = &dst[(size_t)y * dstWidth * 4];
+		for (int x = 0; x < dstWidth; x++) {
+			int x0 = std::min(x * 2, width - 1) * 4;
+			int x1 = std::min(x * 2 + 1, width - 1) * 4;
+			for (int c = 0; c < 4; c++) {
+				out[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+}
+
+void BcEncoder_compressMipChain(const uint8_t *rgba, int width, int height, BcFormat format, std::vector<BcLevel> &levels, int numThreads)
+{
+	levels.clear();
+	std::vector<uint8_t> current(rgba, rgba + (size_t)width * height * 4);
+	std::vector<uint8_t> next;
+	while (true) {
+		BcLevel level;
+		level.width = width;
+		level.height = height;
+		level.data.resize(BcEncoder_getCompressedSize(width, height, format));
+		BcEncoder_compress(&current[0], width, height, format, &level.data[0], numThreads);
+		levels.push_back(level);
+		if (width == 1 && height == 1) break;
+
+		int nextWidth = std::max(width / 2, 1);
+		int nextHeight = std::max(height / 2, 1);
+		downsample(current, width, height, next, nextWidth, nextHeight);
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+static void appendU32(std::vector<uint8_t> &dst, uint32_t value)
+{
+	for (int i = 0; i < 4; i++) dst.push_back((uint8_t)(value >> (8 * i)));
+}
+
+void BcEncoder_buildDDS(BcFormat format, const std::vector<BcLevel> &levels, std::vector<uint8_t> &dds)
+{
+	dds.clear();
+	if (levels.empty()) return;
+	uint32_t header[31];
+	memset(header, 0, sizeof(header));
+	header[0] = 124;
+	header[1] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header[2] = levels[0].height;
+	header[3] = levels[0].width;
+	header[4] = (uint32_t)levels[0].data.size();
+	header[6] = (uint32_t)levels.size();
+	header[18] = 32;   /* pixel format size */
+	header[19] = DDPF_FOURCC;
+	header[20] = (format == BC_FORMAT_BC1) ? MAKE_FOURCC('D', 'X', 'T', '1') : (format == BC_FORMAT_BC3) ? MAKE_FOURCC('D', 'X', 'T', '5') : MAKE_FOURCC('D', 'X', '1', '0');
+	header[26] = DDSCAPS_TEXTURE | (levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+	dds.push_back('D'); dds.push_back('D'); dds.push_back('S'); dds.push_back(' ');
+	for (int i = 0; i < 31; i++) appendU32(dds, header[i]);
+	if (format == BC_FORMAT_BC7) {
+		appendU32(dds, DXGI_FORMAT_BC7_UNORM);
+		appendU32(dds, DDS_DIMENSION_TEXTURE2D);
+		appendU32(dds, 0);  /* misc flag */
+		appendU32(dds, 1);  /* array size */
+		appendU32(dds, 0);  /* misc flag 2 */
+	}
+	for (size_t i = 0; i < levels.size(); i++) {
+		dds.insert(dds.end(), levels[i].data.begin(), levels[i].data.end());
+	}
+}
+
+bool BcEncoder_writeDDS(const char *path, BcFormat format, const std::vector<BcLevel> &levels)
+{
+	std::vector<uint8_t> dds;
+	BcEncoder_buildDDS(format, levels, dds);
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL) {
+		printf("%s could not be opened for writing\n", path);
+		return false;
+	}
+	bool ret = fwrite(&dds[0], 1, dds.size(), fp) == dds.size();
+	fclose(fp);
+	if (!ret) printf("%s could not be written\n", path);
+	return ret;
+}
@@ -0,0 +1,33 @@
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+typedef enum {
+	BC_FORMAT_BC1,  /* RGB, 4 bits per pixel */
+	BC_FORMAT_BC3,  /* RGBA, 8 bits per pixel */
+	BC_FORMAT_BC7,  /* RGBA, 8 bits per pixel (mode 6 only: fast, better quality than BC3) */
+} BcFormat;
+
+/* One compressed mip level */
+typedef struct {
+	int width;
+	int height;
+	std::vector<uint8_t> data;
+} BcLevel;
+
+size_t BcEncoder_getCompressedSize(int width, int height, BcFormat format);
+
+/* Compress a tightly packed RGBA8 image. Block rows are split among numThreads threads (0: number of cores) */
+void BcEncoder_compress(const uint8_t *rgba, int width, int height, BcFormat format, uint8_t *dst, int numThreads = 0);
+
+/* Generate the whole mip chain (2x2 box filter) on the CPU and compress every level */
+void BcEncoder_compressMipChain(const uint8_t *rgba, int width, int height, BcFormat format, std::vector<BcLevel> &levels, int numThreads = 0);
+
+/* Serialize levels as a DDS file image (legacy DXT1/DXT5 header, or DX10 header for BC7) */
+void BcEncoder_buildDDS(BcFormat format, const std::vector<BcLevel> &levels, std::vector<uint8_t> &dds);
+bool BcEncoder_writeDDS(const char *path, BcFormat format, const std::vector<BcLevel> &levels);
+
+#endif
@@ -0,0 +1,43 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+#include "ImageDecoder.h"
+#include "BcEncoder.h"
+
+/*** Function ***/
+/* Offline converter: bc_encoder <input image> <output.dds> [bc1|bc3|bc7] [threads] */
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		printf("usage: %s <input image> <output.dds> [bc1|bc3|bc7] [threads]\n", argv[0]);
+		return 1;
+	}
+	BcFormat format = BC_FORMAT_BC7;
+	if (argc > 3) {
+		if (strcmp(argv[3], "bc1") == 0) format = BC_FORMAT_BC1;
+		else if (strcmp(argv[3], "bc3") == 0) format = BC_FORMAT_BC3;
+		else if (strcmp(argv[3], "bc7") == 0) format = BC_FORMAT_BC7;
+		else {
+			printf("unknown format %s\n", argv[3]);
+			return 1;
+		}
+	}
+	int numThreads = (argc > 4) ? atoi(argv[4]) : 0;
+
+	Image image;
+	if (!ImageDecoder_load(argv[1], &image)) return 1;
+
+	const auto& tStart = std::chrono::steady_clock::now();
+	std::vector<BcLevel> levels;
+	BcEncoder_compressMipChain(&image.rgba[0], image.width, image.height, format, levels, numThreads);
+	const auto& tEnd = std::chrono::steady_clock::now();
+	printf("%dx%d, %d levels, %.1f ms\n", image.width, image.height, (int)levels.size(), std::chrono::duration<double, std::milli>(tEnd - tStart).count());
+
+	return BcEncoder_writeDDS(argv[2], format, levels) ? 0 : 1;
+}
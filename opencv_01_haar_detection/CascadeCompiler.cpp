@@ -0,0 +1,158 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "ResourcePack.h"
+#include "HaarCascade.h"
+#include "HaarEvaluator.h"
+
+/*** Macro ***/
+/* Settings (same as the detector) */
+#define SCALE_FACTOR  1.1f
+#define MIN_NEIGHBORS 8
+#define GROUP_EPS     0.2
+
+/*** Functions ***/
+static double getElapsedMs(const std::chrono::steady_clock::time_point &tStart)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+static bool isRectLess(const cv::Rect &a, const cv::Rect &b)
+{
+	if (a.x != b.x) return a.x < b.x;
+	if (a.y != b.y) return a.y < b.y;
+	if (a.width != b.width) return a.width < b.width;
+	return a.height < b.height;
+}
+
+/* Always the XML itself (HaarCascade::Load would take the binary next to it) */
+static bool loadXml(const char *path, HaarCascade &cascade)
+{
+	ResourceView view;
+	if (!Resource_read(path, &view) || HaarCascade_isBinary(view.data, view.size)) return false;
+	return cascade.LoadFromMemory((const char*)view.data, view.size);
+}
+
+/* Raw hits of every level (no grouping), the way MultiCascadeDetector scans them */
+static void detect(const HaarCascade &cascade, const cv::Mat &gray, std::vector<cv::Rect> &objects)
+{
+	HaarEvaluator evaluator(&cascade.GetData());
+	HaarPyramid pyramid;
+	pyramid.Build(gray, SCALE_FACTOR, evaluator.GetWindowSize(), cascade.GetData().hasTilted != 0);
+	evaluator.Prepare(pyramid);
+	objects.clear();
+	for (int l = 0; l < pyramid.GetLevelNum(); l++) {
+		int scanHeight = evaluator.GetScanHeight(pyramid, l, cv::Size(), cv::Size(gray.cols, gray.rows));
+		if (scanHeight > 0) evaluator.Scan(pyramid, l, 0, scanHeight, objects);
+	}
+}
+
+static bool isSameRects(std::vector<cv::Rect> a, std::vector<cv::Rect> b)
+{
+	std::sort(a.begin(), a.end(), isRectLess);
+	std::sort(b.begin(), b.end(), isRectLess);
+	return a == b;
+}
+
+/* cascade_compiler convert <input.xml> <output.hcb> */
+static int convert(const char *inputPath, const char *outputPath)
+{
+	HaarCascade cascade;
+	const auto& tStart = std::chrono::steady_clock::now();
+	if (!loadXml(inputPath, cascade)) {
+		printf("failed to load %s\n", inputPath);
+		return 1;
+	}
+	double parseTime = getElapsedMs(tStart);
+	if (!cascade.SaveBinary(outputPath)) {
+		printf("failed to write %s\n", outputPath);
+		return 1;
+	}
+	const HaarCascadeData &data = cascade.GetData();
+	printf("%s -> %s: %dx%d window, %d stages, %d weak classifiers, %d features%s%s (%.1f ms to parse)\n", inputPath, outputPath,
+		data.windowWidth, data.windowHeight, data.stageNum, data.weakNum, data.featureNum,
+		data.isStumpOnly ? ", stumps" : "", data.hasTilted ? ", tilted" : "", parseTime);
+	return 0;
+}
+
+/* cascade_compiler verify <cascade.xml> <cascade.hcb> <image>...
+ * Raw and grouped hits of the binary (mapped, evaluated by HaarEvaluator) have to equal cv::CascadeClassifier's on every image */
+static int verify(const char *xmlPath, const char *binaryPath, int imageNum, char *imagePaths[])
+{
+	auto tStart = std::chrono::steady_clock::now();
+	cv::CascadeClassifier classifier;
+	if (!classifier.load(xmlPath)) {
+		printf("failed to load %s\n", xmlPath);
+		return 1;
+	}
+	double classifierTime = getElapsedMs(tStart);
+
+	tStart = std::chrono::steady_clock::now();
+	HaarCascade xmlCascade;
+	if (!loadXml(xmlPath, xmlCascade)) {
+		printf("failed to load %s\n", xmlPath);
+		return 1;
+	}
+	double xmlTime = getElapsedMs(tStart);
+
+	tStart = std::chrono::steady_clock::now();
+	HaarCascade binaryCascade;
+	ResourceView view;
+	if (!Resource_read(binaryPath, &view) || !binaryCascade.LoadFromBinary(view.data, view.size, view.holder)) {
+		printf("failed to load %s\n", binaryPath);
+		return 1;
+	}
+	double binaryTime = getElapsedMs(tStart);
+	printf("load: cv::CascadeClassifier %.2f ms, XML %.2f ms, binary %.3f ms\n", classifierTime, xmlTime, binaryTime);
+
+	int failNum = 0;
+	for (int i = 0; i < imageNum; i++) {
+		cv::Mat image = cv::imread(imagePaths[i]);
+		if (image.empty()) {
+			printf("failed to read %s\n", imagePaths[i]);
+			failNum++;
+			continue;
+		}
+		cv::Mat gray;
+		cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+
+		std::vector<cv::Rect> expected, expectedGrouped;
+		classifier.detectMultiScale(gray, expected, SCALE_FACTOR, 0);
+		classifier.detectMultiScale(gray, expectedGrouped, SCALE_FACTOR, MIN_NEIGHBORS);
+
+		std::vector<cv::Rect> xmlObjects, objects;
+		detect(xmlCascade, gray, xmlObjects);
+		tStart = std::chrono::steady_clock::now();
+		detect(binaryCascade, gray, objects);
+		double detectTime = getElapsedMs(tStart);
+		std::vector<cv::Rect> grouped = objects;
+		cv::groupRectangles(grouped, MIN_NEIGHBORS, GROUP_EPS);
+
+		bool isMatched = isSameRects(objects, expected) && isSameRects(xmlObjects, objects) && isSameRects(grouped, expectedGrouped);
+		printf("%-40s %s: %d hits (OpenCV %d), %d grouped (OpenCV %d), %.1f ms\n", imagePaths[i], isMatched ? "OK  " : "FAIL",
+			(int)objects.size(), (int)expected.size(), (int)grouped.size(), (int)expectedGrouped.size(), detectTime);
+		if (!isMatched) failNum++;
+	}
+	printf("%d / %d images match\n", imageNum - failNum, imageNum);
+	return failNum == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc >= 4 && strcmp(argv[1], "convert") == 0) return convert(argv[2], argv[3]);
+	if (argc >= 5 && strcmp(argv[1], "verify") == 0) return verify(argv[2], argv[3], argc - 4, argv + 4);
+	printf("usage: %s convert <input.xml> <output.hcb>\n", argv[0]);
+	printf("       %s verify <cascade.xml> <cascade.hcb> <image>...\n", argv[0]);
+	return 1;
+}
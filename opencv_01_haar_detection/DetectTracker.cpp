@@ -0,0 +1,114 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "Profiler.h"
+#include "DetectTracker.h"
+
+/*** Macro ***/
+#define REFRESH_SCORE 0.9f   /* matches this good also refresh the template, following slow appearance changes */
+
+/*** Functions ***/
+void DetectTracker_getDefaultConfig(DetectTrackerConfig *config)
+{
+	config->detectInterval = 15;
+	config->searchMargin = 0.5f;
+	config->minScore = 0.6f;
+	config->maxMotion = 0.3f;
+	config->templateSize = 32;
+	config->minNeighbors = 8;
+	config->minSize = 30;
+}
+
+DetectTracker::DetectTracker(cv::CascadeClassifier *cascade, const DetectTrackerConfig &config)
+	: m_cascade(cascade), m_config(config), m_framesSinceDetect(0), m_isDetectRequested(true), m_scaleFactor(1.1f), m_frameNum(0), m_detectNum(0)
+{
+}
+
+void DetectTracker::Process(const cv::Mat &gray, std::vector<cv::Rect> &listDet)
+{
+	m_frameNum++;
+	/* boxes and templates are in the coordinates of the previous image size (e.g. the detection width was changed) */
+	if (gray.cols != m_imageSize.width || gray.rows != m_imageSize.height) {
+		m_imageSize = cv::Size(gray.cols, gray.rows);
+		m_targets.clear();
+	}
+	/* Full cascade: nothing to track, on schedule, or after a large motion / track loss */
+	if (m_targets.empty() || m_isDetectRequested || m_framesSinceDetect >= m_config.detectInterval) {
+		Detect(gray);
+	} else {
+		m_framesSinceDetect++;
+		bool isLost = false;
+		{
+			ScopedTimer timer("track");
+			for (size_t i = 0; i < m_targets.size(); i++) {
+				bool isLargeMotion = false;
+				if (!Track(gray, m_targets[i], &isLargeMotion)) isLost = true;
+				if (isLargeMotion) m_isDetectRequested = true;
+			}
+		}
+		/* a lost target is re-acquired in this frame, so the overlay does not blink */
+		if (isLost) Detect(gray);
+	}
+
+	listDet.clear();
+	for (size_t i = 0; i < m_targets.size(); i++) listDet.push_back(m_targets[i].box);
+}
+
+void DetectTracker::Detect(const cv::Mat &gray)
+{
+	ScopedTimer timer("cascade");
+	m_detectNum++;
+	m_framesSinceDetect = 0;
+	m_isDetectRequested = false;
+	std::vector<cv::Rect> listDet;
+	m_cascade->detectMultiScale(gray, listDet, m_scaleFactor, m_config.minNeighbors, cv::CASCADE_SCALE_IMAGE, cv::Size(m_config.minSize, m_config.minSize));
+	m_targets.resize(listDet.size());
+	for (size_t i = 0; i < listDet.size(); i++) {
+		m_targets[i].box = listDet[i];
+		UpdateTemplate(gray, m_targets[i]);
+	}
+}
+
+void DetectTracker::UpdateTemplate(const cv::Mat &gray, Target &target)
+{
+	target.scale = (std::min)(1.0f, (float)m_config.templateSize / target.box.width);
+	cv::Size size((std::max)(1, (int)(target.box.width * target.scale)), (std::max)(1, (int)(target.box.height * target.scale)));
+	cv::resize(gray(target.box), target.templ, size, 0, 0, cv::INTER_AREA);
+}
+
+/* NCC search in a ROI around the last box, at template scale */
+bool DetectTracker::Track(const cv::Mat &gray, Target &target, bool *isLargeMotion)
+{
+	cv::Rect &box = target.box;
+	int marginX = (int)(box.width * m_config.searchMargin);
+	int marginY = (int)(box.height * m_config.searchMargin);
+	cv::Rect roi = cv::Rect(box.x - marginX, box.y - marginY, box.width + 2 * marginX, box.height + 2 * marginY) & cv::Rect(0, 0, gray.cols, gray.rows);
+	if (roi.width < box.width || roi.height < box.height) return false;
+
+	cv::Size roiSize((int)(roi.width * target.scale), (int)(roi.height * target.scale));
+	if (roiSize.width < target.templ.cols || roiSize.height < target.templ.rows) return false;
+	cv::resize(gray(roi), m_roiScaled, roiSize, 0, 0, cv::INTER_AREA);
+	cv::matchTemplate(m_roiScaled, target.templ, m_matchResult, cv::TM_CCOEFF_NORMED);
+	double score;
+	cv::Point location;
+	cv::minMaxLoc(m_matchResult, NULL, &score, NULL, &location);
+	if (score < m_config.minScore) return false;
+
+	int x = roi.x + (int)(location.x / target.scale);
+	int y = roi.y + (int)(location.y / target.scale);
+	int dx = x - box.x;
+	int dy = y - box.y;
+	*isLargeMotion = (std::abs(dx) > box.width * m_config.maxMotion) || (std::abs(dy) > box.height * m_config.maxMotion);
+	box.x = (std::max)(0, (std::min)(x, gray.cols - box.width));
+	box.y = (std::max)(0, (std::min)(y, gray.rows - box.height));
+	if (score >= REFRESH_SCORE) UpdateTemplate(gray, target);
+	return true;
+}
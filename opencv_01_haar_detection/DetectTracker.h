@@ -0,0 +1,58 @@
+#ifndef DETECT_TRACKER_H
+#define DETECT_TRACKER_H
+
+#include <vector>
+#include <atomic>
+
+#include <opencv2/opencv.hpp>
+
+typedef struct {
+	int detectInterval;      /* frames tracked before the full cascade runs again */
+	float searchMargin;      /* search ROI = box grown by this ratio of its size on each side */
+	float minScore;          /* NCC below this means the target is lost */
+	float maxMotion;         /* displacement (ratio of box size) that forces a re-detection on the next frame */
+	int templateSize;        /* templates are downscaled to at most this width for matching */
+	int minNeighbors;        /* cascade settings, as HaarDetectorConfig */
+	int minSize;             /* in detection image pixels */
+} DetectTrackerConfig;
+
+void DetectTracker_getDefaultConfig(DetectTrackerConfig *config);
+
+/* Runs the cascade on a schedule and follows the boxes with NCC template matching in between.
+ * Stateful: feed the frames of one stream in order, from one thread */
+class DetectTracker
+{
+public:
+	DetectTracker(cv::CascadeClassifier *cascade, const DetectTrackerConfig &config);
+	void Process(const cv::Mat &gray, std::vector<cv::Rect> &listDet);
+	int GetFrameNum() const { return m_frameNum; }
+	int GetDetectNum() const { return m_detectNum; }
+	/* cascade scaleFactor (1.1 by default), can be changed from another thread */
+	void SetScaleFactor(float scaleFactor) { m_scaleFactor = scaleFactor; }
+
+private:
+	typedef struct {
+		cv::Rect box;
+		cv::Mat templ;       /* downscaled gray patch of the box */
+		float scale;         /* templ size / box size */
+	} Target;
+
+	void Detect(const cv::Mat &gray);
+	bool Track(const cv::Mat &gray, Target &target, bool *isLargeMotion);
+	void UpdateTemplate(const cv::Mat &gray, Target &target);
+
+private:
+	cv::CascadeClassifier *m_cascade;
+	DetectTrackerConfig m_config;
+	std::vector<Target> m_targets;
+	int m_framesSinceDetect;
+	bool m_isDetectRequested;
+	cv::Size m_imageSize;
+	std::atomic<float> m_scaleFactor;
+	cv::Mat m_roiScaled;
+	cv::Mat m_matchResult;
+	std::atomic<int> m_frameNum;
+	std::atomic<int> m_detectNum;
+};
+
+#endif
@@ -0,0 +1,77 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "DetectionFrontEnd.h"
+
+/*** Functions ***/
+void DetectionFrontEnd_getDefaultConfig(DetectionFrontEndConfig *config)
+{
+	/* a hand is still well above the cascade window at this width */
+	config->targetWidth = 640;
+	config->normalize = DETECT_NORMALIZE_NONE;
+	config->claheClipLimit = 2.0;
+}
+
+DetectionFrontEnd::DetectionFrontEnd(const DetectionFrontEndConfig &config)
+	: m_config(config), m_targetWidth(config.targetWidth)
+{
+	if (m_config.normalize == DETECT_NORMALIZE_CLAHE) m_clahe = cv::createCLAHE(m_config.claheClipLimit);
+}
+
+float DetectionFrontEnd::Process(const cv::Mat &image, FrameFormat format, cv::Mat &detectImage)
+{
+	int targetWidth = m_targetWidth;
+	cv::Size imageSize = FrameFormat_getSize(image, format);
+	float scale = 1.0f;
+	if (targetWidth > 0 && imageSize.width > targetWidth) scale = (float)targetWidth / imageSize.width;
+
+	/* Planar YUV: the Y plane is the gray image already */
+	cv::Mat gray = FrameFormat_getLumaPlane(image, format);
+	if (!gray.empty()) {
+		/* a copy at full resolution: the render thread may draw into the frame while it is detected */
+		if (scale == 1.0f) gray.copyTo(detectImage);
+	} else {
+		/* Convert at full resolution only when it is the final image; otherwise into the intermediate buffer */
+		cv::Mat &converted = (scale < 1.0f) ? m_gray : detectImage;
+		if (format == FRAME_FORMAT_YUYV) {
+			cv::extractChannel(image, converted, 0);
+		} else if (image.channels() == 3) {
+			cv::cvtColor(image, converted, cv::COLOR_BGR2GRAY);
+		} else if (image.channels() == 4) {
+			cv::cvtColor(image, converted, cv::COLOR_BGRA2GRAY);
+		} else {
+			image.copyTo(converted);
+		}
+		gray = converted;
+	}
+	if (scale < 1.0f) {
+		cv::Size size(targetWidth, (std::max)(1, (int)(imageSize.height * scale + 0.5f)));
+		cv::resize(gray, detectImage, size, 0, 0, cv::INTER_AREA);
+	}
+
+	if (m_config.normalize == DETECT_NORMALIZE_EQUALIZE) {
+		cv::equalizeHist(detectImage, detectImage);
+	} else if (m_config.normalize == DETECT_NORMALIZE_CLAHE) {
+		/* swap keeps both buffers allocated for the next frame */
+		m_clahe->apply(detectImage, m_normalized);
+		std::swap(m_normalized, detectImage);
+	}
+	return scale;
+}
+
+void DetectionFrontEnd::MapToSource(float scale, std::vector<cv::Rect> &listDet)
+{
+	if (scale == 1.0f) return;
+	float inv = 1.0f / scale;
+	for (size_t i = 0; i < listDet.size(); i++) {
+		cv::Rect &r = listDet[i];
+		r = cv::Rect((int)(r.x * inv + 0.5f), (int)(r.y * inv + 0.5f), (int)(r.width * inv + 0.5f), (int)(r.height * inv + 0.5f));
+	}
+}
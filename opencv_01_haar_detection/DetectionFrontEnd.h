@@ -0,0 +1,45 @@
+#ifndef DETECTION_FRONT_END_H
+#define DETECTION_FRONT_END_H
+
+#include <vector>
+#include <atomic>
+
+#include <opencv2/opencv.hpp>
+
+#include "FrameSource.h"
+
+typedef enum {
+	DETECT_NORMALIZE_NONE,
+	DETECT_NORMALIZE_EQUALIZE,   /* cv::equalizeHist */
+	DETECT_NORMALIZE_CLAHE,      /* contrast limited adaptive histogram equalization */
+} DetectNormalize;
+
+typedef struct {
+	int targetWidth;             /* frames wider than this are downscaled for detection (0: keep resolution) */
+	DetectNormalize normalize;
+	double claheClipLimit;
+} DetectionFrontEndConfig;
+
+void DetectionFrontEnd_getDefaultConfig(DetectionFrontEndConfig *config);
+
+/* Gray conversion, downscale and normalization for the detector, done once per frame into reused buffers */
+class DetectionFrontEnd
+{
+public:
+	explicit DetectionFrontEnd(const DetectionFrontEndConfig &config);
+	/* BGR, BGRA, gray or a YUV frame (its Y plane is used as is) in. Returns the scale of the detection image against the input (<= 1) */
+	float Process(const cv::Mat &image, FrameFormat format, cv::Mat &detectImage);
+	/* Boxes found in a detection image of the given scale -> input image coordinates */
+	static void MapToSource(float scale, std::vector<cv::Rect> &listDet);
+	/* Can be called from another thread; used from the next frame */
+	void SetTargetWidth(int targetWidth) { m_targetWidth = targetWidth; }
+
+private:
+	DetectionFrontEndConfig m_config;
+	std::atomic<int> m_targetWidth;
+	cv::Mat m_gray;
+	cv::Mat m_normalized;
+	cv::Ptr<cv::CLAHE> m_clahe;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*** Include ***/
+/* for general */
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <future>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "Profiler.h"
+#include "Detector.h"
+
+/*** Macro ***/
+
+/*** Global variables ***/
+
+/*** Functions ***/
+void Detector_getDefaultConfig(DetectorConfig *config)
+{
+	config->workerNum = 1;
+	config->maxBatchSize = 1;
+	config->maxInFlight = 2;
+}
+
+void Detector_detect(Detector *detector, const cv::Mat &image, std::vector<cv::Rect> &listDet)
+{
+	std::future<std::vector<cv::Rect> > result = detector->Submit(image);
+	if (result.valid()) {
+		listDet = result.get();
+	} else {
+		listDet.clear();
+	}
+}
+
+Detector::Detector(const DetectorConfig &config)
+	: m_config(config), m_inFlightNum(0), m_stop(false)
+{
+	if (m_config.workerNum < 1) m_config.workerNum = 1;
+	if (m_config.maxBatchSize < 1) m_config.maxBatchSize = 1;
+	if (m_config.maxInFlight < 1) m_config.maxInFlight = 1;
+}
+
+Detector::~Detector()
+{
+	Stop();
+}
+
+bool Detector::Start()
+{
+	if (!m_threads.empty()) return true;
+	for (int i = 0; i < m_config.workerNum; i++) {
+		if (!CreateWorker(i)) {
+			printf("%s: failed to create worker %d\n", GetName().c_str(), i);
+			return false;
+		}
+	}
+	m_stop = false;
+	for (int i = 0; i < m_config.workerNum; i++) {
+		m_threads.push_back(std::thread(&Detector::WorkerLoop, this, i));
+	}
+	return true;
+}
+
+void Detector::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_cond.notify_all();
+	for (size_t i = 0; i < m_threads.size(); i++) m_threads[i].join();
+	m_threads.clear();
+}
+
+std::future<std::vector<cv::Rect> > Detector::Submit(const cv::Mat &image)
+{
+	std::future<std::vector<cv::Rect> > result;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_stop || m_threads.empty() || m_inFlightNum >= m_config.maxInFlight) return result;
+		m_requests.push_back(Request());
+		m_requests.back().image = image;
+		result = m_requests.back().promise.get_future();
+		m_inFlightNum++;
+	}
+	m_cond.notify_one();
+	return result;
+}
+
+int Detector::GetInFlightNum()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_inFlightNum;
+}
+
+void Detector::WorkerLoop(int workerIndex)
+{
+	char threadName[32];
+	snprintf(threadName, sizeof(threadName), "detector %d", workerIndex);
+	Profiler_setThreadName(threadName);
+	std::vector<Request> batch;
+	std::vector<cv::Mat> images;
+	std::vector<std::vector<cv::Rect> > results;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this]() { return m_stop || !m_requests.empty(); });
+			/* requests still queued are answered before leaving, so that no future is left broken */
+			if (m_requests.empty()) return;
+			batch.clear();
+			while (!m_requests.empty() && (int)batch.size() < m_config.maxBatchSize) {
+				batch.push_back(std::move(m_requests.front()));
+				m_requests.pop_front();
+			}
+		}
+
+		images.resize(batch.size());
+		for (size_t i = 0; i < batch.size(); i++) images[i] = batch[i].image;
+		results.assign(batch.size(), std::vector<cv::Rect>());
+		double startTime = Profiler_getTime();
+		try {
+			DetectBatch(workerIndex, images, results);
+		} catch (const cv::Exception &e) {
+			printf("%s: %s\n", GetName().c_str(), e.what());
+			results.assign(batch.size(), std::vector<cv::Rect>());
+		}
+		Profiler_record("inference", 0, startTime, Profiler_getTime());
+
+		/* room is made before the results are handed over, so a caller woken by its future can submit again at once */
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_inFlightNum -= (int)batch.size();
+		}
+		for (size_t i = 0; i < batch.size(); i++) batch[i].promise.set_value(std::move(results[i]));
+	}
+}
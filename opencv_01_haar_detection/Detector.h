@@ -0,0 +1,72 @@
+#ifndef DETECTOR_H
+#define DETECTOR_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+
+#include <opencv2/opencv.hpp>
+
+typedef struct {
+	int workerNum;       /* inference threads, each with its own model instance */
+	int maxBatchSize;    /* queued requests a worker takes together into one inference call */
+	int maxInFlight;     /* requests queued or running. Submit is refused beyond this */
+} DetectorConfig;
+
+void Detector_getDefaultConfig(DetectorConfig *config);
+
+/*
+ * Asynchronous detector: Submit returns at once, the boxes arrive through the future.
+ * Requests are queued (bounded by maxInFlight) and taken by the workers in batches of up to maxBatchSize.
+ * Backends implement CreateWorker / DetectBatch, and must call Stop in their destructor (the workers call into them)
+ */
+class Detector
+{
+public:
+	explicit Detector(const DetectorConfig &config);
+	virtual ~Detector();
+	bool Start();
+	void Stop();
+	/* image: gray detection image, must stay unchanged until the result is ready. Boxes are in its coordinates.
+	 * Returns an invalid future (valid() == false) if maxInFlight requests are pending */
+	std::future<std::vector<cv::Rect> > Submit(const cv::Mat &image);
+	int GetInFlightNum();
+	const DetectorConfig &GetConfig() const { return m_config; }
+	virtual std::string GetName() const = 0;
+
+protected:
+	/* Load the model of a worker (called from Start, before the worker runs) */
+	virtual bool CreateWorker(int workerIndex) = 0;
+	/* In the worker thread. results has the same size as images */
+	virtual void DetectBatch(int workerIndex, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &results) = 0;
+
+private:
+	Detector(const Detector&);
+	Detector& operator=(const Detector&);
+
+	typedef struct {
+		cv::Mat image;
+		std::promise<std::vector<cv::Rect> > promise;
+	} Request;
+
+	void WorkerLoop(int workerIndex);
+
+private:
+	DetectorConfig m_config;
+	std::deque<Request> m_requests;
+	int m_inFlightNum;       /* queued + being detected */
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	bool m_stop;
+};
+
+/* Wrap a detector as a blocking call, e.g. for MotionGate::Detector. Boxes are left empty if it is saturated.
+ * Several threads calling it at once is how the pipeline fills the detector's batches */
+void Detector_detect(Detector *detector, const cv::Mat &image, std::vector<cv::Rect> &listDet);
+
+#endif
@@ -0,0 +1,157 @@
+/*** Include ***/
+/* for general */
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "ResourcePack.h"
+#include "DnnDetector.h"
+
+/*** Macro ***/
+
+/*** Global variables ***/
+
+/*** Functions ***/
+void DnnDetector_getDefaultConfig(DnnDetectorConfig *config)
+{
+	config->modelPath = NULL;
+	config->inputWidth = 320;
+	config->inputHeight = 320;
+	config->inputChannels = 3;
+	config->inputScale = 1.0f / 255;
+	config->inputMean = 0.0f;
+	config->outputLayout = DNN_OUTPUT_YOLO;
+	config->classId = -1;
+	config->scoreThreshold = 0.5f;
+	config->nmsThreshold = 0.45f;
+}
+
+DnnDetector::DnnDetector(const DnnDetectorConfig &dnnConfig, const DetectorConfig &config)
+	: Detector(config), m_dnnConfig(dnnConfig)
+{
+	m_nets.resize(GetConfig().workerNum);
+}
+
+DnnDetector::~DnnDetector()
+{
+	Stop();
+}
+
+bool DnnDetector::CreateWorker(int workerIndex)
+{
+	cv::dnn::Net &net = m_nets[workerIndex];
+	if (m_dnnConfig.modelPath == NULL) {
+		printf("no ONNX model given for the DNN detector\n");
+		return false;
+	}
+	try {
+		ResourceView view;
+		if (Resource_isInPack(m_dnnConfig.modelPath) && Resource_read(m_dnnConfig.modelPath, &view)) {
+			net = cv::dnn::readNetFromONNX((const char*)view.data, view.size);
+		} else {
+			net = cv::dnn::readNetFromONNX(m_dnnConfig.modelPath);
+		}
+	} catch (const cv::Exception &e) {
+		printf("failed to load %s: %s\n", m_dnnConfig.modelPath, e.what());
+		return false;
+	}
+	if (net.empty()) {
+		printf("failed to load %s\n", m_dnnConfig.modelPath);
+		return false;
+	}
+	net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+	net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+	return true;
+}
+
+void DnnDetector::DetectBatch(int workerIndex, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &results)
+{
+	/* blobFromImages resizes each image to the input size, so a batch may mix detection image sizes */
+	std::vector<cv::Mat> inputs(images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		if (m_dnnConfig.inputChannels == 3 && images[i].channels() == 1) {
+			cv::cvtColor(images[i], inputs[i], cv::COLOR_GRAY2BGR);
+		} else {
+			inputs[i] = images[i];
+		}
+	}
+	cv::dnn::Net &net = m_nets[workerIndex];
+	float mean = m_dnnConfig.inputMean;
+	cv::Mat blob = cv::dnn::blobFromImages(inputs, m_dnnConfig.inputScale, cv::Size(m_dnnConfig.inputWidth, m_dnnConfig.inputHeight), cv::Scalar(mean, mean, mean), false, false);
+	net.setInput(blob);
+	cv::Mat output = net.forward();
+
+	std::vector<std::vector<cv::Rect> > boxes(images.size());
+	std::vector<std::vector<float> > scores(images.size());
+	if (m_dnnConfig.outputLayout == DNN_OUTPUT_SSD) {
+		ParseSsd(output, images, boxes, scores);
+	} else {
+		ParseYolo(output, images, boxes, scores);
+	}
+	for (size_t i = 0; i < images.size(); i++) {
+		std::vector<int> indices;
+		cv::dnn::NMSBoxes(boxes[i], scores[i], m_dnnConfig.scoreThreshold, m_dnnConfig.nmsThreshold, indices);
+		results[i].clear();
+		cv::Rect imageRect(0, 0, images[i].cols, images[i].rows);
+		for (size_t j = 0; j < indices.size(); j++) {
+			cv::Rect box = boxes[i][indices[j]] & imageRect;
+			if (!box.empty()) results[i].push_back(box);
+		}
+	}
+}
+
+void DnnDetector::ParseSsd(const cv::Mat &output, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &boxes, std::vector<std::vector<float> > &scores) const
+{
+	/* every image of the batch in one list, told apart by the image index */
+	const float *data = (const float*)output.data;
+	size_t detectionNum = output.total() / 7;
+	for (size_t i = 0; i < detectionNum; i++) {
+		const float *detection = data + i * 7;
+		int imageIndex = (int)detection[0];
+		float score = detection[2];
+		if (imageIndex < 0 || imageIndex >= (int)images.size() || score < m_dnnConfig.scoreThreshold) continue;
+		if (m_dnnConfig.classId >= 0 && (int)detection[1] != m_dnnConfig.classId) continue;
+		const cv::Mat &image = images[imageIndex];
+		int x0 = (int)(detection[3] * image.cols);
+		int y0 = (int)(detection[4] * image.rows);
+		int x1 = (int)(detection[5] * image.cols);
+		int y1 = (int)(detection[6] * image.rows);
+		boxes[imageIndex].push_back(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+		scores[imageIndex].push_back(score);
+	}
+}
+
+void DnnDetector::ParseYolo(const cv::Mat &output, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &boxes, std::vector<std::vector<float> > &scores) const
+{
+	/* [batch, N, attributes], or [N, attributes] for a single image */
+	int candidateNum = (output.dims == 3) ? output.size[1] : output.size[0];
+	int attributeNum = (output.dims == 3) ? output.size[2] : output.size[1];
+	int classNum = attributeNum - 5;
+	if (classNum < 1 || (output.dims != 3 && images.size() > 1)) return;
+	const float *data = (const float*)output.data;
+	for (size_t b = 0; b < images.size(); b++) {
+		const cv::Mat &image = images[b];
+		float scaleX = (float)image.cols / m_dnnConfig.inputWidth;
+		float scaleY = (float)image.rows / m_dnnConfig.inputHeight;
+		for (int i = 0; i < candidateNum; i++) {
+			const float *candidate = data + ((size_t)b * candidateNum + i) * attributeNum;
+			float objectness = candidate[4];
+			if (objectness < m_dnnConfig.scoreThreshold) continue;
+			const float *classScores = candidate + 5;
+			int classId = m_dnnConfig.classId;
+			if (classId < 0 || classId >= classNum) classId = (int)(std::max_element(classScores, classScores + classNum) - classScores);
+			float score = objectness * classScores[classId];
+			if (score < m_dnnConfig.scoreThreshold) continue;
+			float width = candidate[2] * scaleX;
+			float height = candidate[3] * scaleY;
+			int x0 = (int)(candidate[0] * scaleX - width / 2);
+			int y0 = (int)(candidate[1] * scaleY - height / 2);
+			boxes[b].push_back(cv::Rect(x0, y0, (int)width, (int)height));
+			scores[b].push_back(score);
+		}
+	}
+}
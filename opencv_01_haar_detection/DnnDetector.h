@@ -0,0 +1,53 @@
+#ifndef DNN_DETECTOR_H
+#define DNN_DETECTOR_H
+
+#include <vector>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+#include "Detector.h"
+
+/* Layout of the network output */
+typedef enum {
+	DNN_OUTPUT_SSD,    /* [1, 1, N, 7]: image index, class, score, x0, y0, x1, y1 (0.0 - 1.0) */
+	DNN_OUTPUT_YOLO,   /* [batch, N, 5 + classes]: cx, cy, w, h (input pixels), objectness, class scores */
+} DnnOutputLayout;
+
+typedef struct {
+	const char *modelPath;     /* ONNX, from the resource pack if it is there. Required: no model is shipped (NULL by default) */
+	int inputWidth;
+	int inputHeight;
+	int inputChannels;         /* 1, or 3 (the gray detection image is replicated) */
+	float inputScale;          /* blob = (pixel - inputMean) * inputScale */
+	float inputMean;
+	DnnOutputLayout outputLayout;
+	int classId;               /* class to report, -1: any */
+	float scoreThreshold;
+	float nmsThreshold;
+} DnnDetectorConfig;
+
+void DnnDetector_getDefaultConfig(DnnDetectorConfig *config);
+
+/* OpenCV DNN backend (CPU). One network per worker; a batch is one forward call */
+class DnnDetector : public Detector
+{
+public:
+	DnnDetector(const DnnDetectorConfig &dnnConfig, const DetectorConfig &config);
+	~DnnDetector();
+	std::string GetName() const { return "dnn"; }
+
+protected:
+	bool CreateWorker(int workerIndex);
+	void DetectBatch(int workerIndex, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &results);
+
+private:
+	void ParseSsd(const cv::Mat &output, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &boxes, std::vector<std::vector<float> > &scores) const;
+	void ParseYolo(const cv::Mat &output, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &boxes, std::vector<std::vector<float> > &scores) const;
+
+private:
+	DnnDetectorConfig m_dnnConfig;
+	std::vector<cv::dnn::Net> m_nets;
+};
+
+#endif
@@ -0,0 +1,273 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "RingQueue.h"
+#include "Profiler.h"
+#include "DetectionFrontEnd.h"
+#include "FramePipeline.h"
+
+/*** Macro ***/
+#define IDLE_SPIN_NUM  16     /* yields before an idle worker starts sleeping */
+#define IDLE_SLEEP_US 500
+
+/*** Functions ***/
+double FramePipeline_getTime()
+{
+	return Profiler_getTime();
+}
+
+static void waitIdle(int &idleNum)
+{
+	if (idleNum++ < IDLE_SPIN_NUM) {
+		std::this_thread::yield();
+	} else {
+		std::this_thread::sleep_for(std::chrono::microseconds(IDLE_SLEEP_US));
+	}
+}
+
+FramePipeline::FramePipeline(int queueDepth)
+	: m_source(NULL), m_isLossless(false), m_queueDepth(queueDepth), m_lastReturnedFrameId(0), m_isRunning(false), m_isSourceFinished(false), m_busyDetectorNum(0), m_droppedNum(0), m_detectSkippedNum(0), m_detectInterval(1), m_detectWidth(-1)
+{
+	m_latestResult.frameId = 0;
+}
+
+FramePipeline::~FramePipeline()
+{
+	Stop();
+}
+
+bool FramePipeline::Start(FrameSource *source, const std::vector<DetectFunc> &detectFuncs, const DetectionFrontEndConfig &frontEndConfig, bool isLossless,
+	const RegionFunc &regionFunc)
+{
+	if (m_isRunning || source == NULL || detectFuncs.empty()) return false;
+	m_source = source;
+	m_isLossless = isLossless;
+	m_regionFunc = regionFunc;
+	m_frontEnd.reset(new DetectionFrontEnd(frontEndConfig));
+	if (m_detectWidth >= 0) m_frontEnd->SetTargetWidth(m_detectWidth);
+
+	/* Enough frames that every queue slot, every worker, the capture and the render thread can hold one at once */
+	int frameNum = 2 * m_queueDepth + (int)detectFuncs.size() + 2;
+	m_frames.clear();
+	m_freeFrames.reset(new RingQueue<Frame*>(frameNum));
+	m_detectQueue.reset(new RingQueue<Frame*>(m_queueDepth));
+	m_displayQueue.reset(new RingQueue<Frame*>(m_queueDepth));
+	m_resultQueue.reset(new RingQueue<DetectionResult>(m_queueDepth));
+	for (int i = 0; i < frameNum; i++) {
+		m_frames.push_back(std::unique_ptr<Frame>(new Frame()));
+		m_frames[i]->refCount = 0;
+		m_freeFrames->TryPush(m_frames[i].get());
+	}
+	m_latestResult = DetectionResult();
+	m_latestResult.frameId = 0;
+	m_lastReturnedFrameId = 0;
+	m_droppedNum = 0;
+	m_detectSkippedNum = 0;
+	m_isSourceFinished = false;
+	m_busyDetectorNum = 0;
+
+	m_isRunning = true;
+	m_captureThread = std::thread(&FramePipeline::CaptureLoop, this);
+	for (size_t i = 0; i < detectFuncs.size(); i++) {
+		m_detectionThreads.push_back(std::thread(&FramePipeline::DetectionLoop, this, detectFuncs[i]));
+	}
+	return true;
+}
+
+void FramePipeline::Stop()
+{
+	if (!m_isRunning) return;
+	m_isRunning = false;
+	m_captureThread.join();
+	for (size_t i = 0; i < m_detectionThreads.size(); i++) m_detectionThreads[i].join();
+	m_detectionThreads.clear();
+	/* frames still queued are simply dropped with the pool (after a zero copy source got their memory back) */
+	for (size_t i = 0; i < m_frames.size(); i++) {
+		if (m_frames[i]->refCount > 0) m_source->ReleaseFrame(m_frames[i]->image);
+	}
+	m_detectQueue.reset();
+	m_displayQueue.reset();
+	m_resultQueue.reset();
+	m_freeFrames.reset();
+	m_frames.clear();
+}
+
+void FramePipeline::ReleaseFrame(Frame *frame)
+{
+	if (--frame->refCount == 0) {
+		/* a zero copy source gets its memory back */
+		m_source->ReleaseFrame(frame->image);
+		m_freeFrames->TryPush(frame);
+	}
+}
+
+/* Latest wins: make room by dropping the oldest entry (counted in evictedNum). Lossless: wait for the consumer */
+void FramePipeline::PushLatest(RingQueue<Frame*> &queue, Frame *frame, std::atomic<uint64_t> &evictedNum)
+{
+	int idleNum = 0;
+	while (!queue.TryPush(frame)) {
+		if (m_isLossless) {
+			if (!m_isRunning) {
+				ReleaseFrame(frame);
+				return;
+			}
+			waitIdle(idleNum);
+			continue;
+		}
+		Frame *oldest;
+		if (queue.TryPop(oldest)) {
+			/* the region decided for a frame never detected still has to be detected: carry it over to the newer one */
+			if (&queue == m_detectQueue.get() && oldest->detectRegion.area() > 0) {
+				cv::Rect whole(0, 0, frame->detectImage.cols, frame->detectImage.rows);
+				bool isSameSize = oldest->detectImage.cols == frame->detectImage.cols && oldest->detectImage.rows == frame->detectImage.rows;
+				frame->detectRegion = isSameSize ? ((frame->detectRegion | oldest->detectRegion) & whole) : whole;
+			}
+			ReleaseFrame(oldest);
+			evictedNum++;
+		}
+	}
+}
+
+void FramePipeline::SetDetectWidth(int width)
+{
+	m_detectWidth = width;
+	if (m_frontEnd) m_frontEnd->SetTargetWidth(width);
+}
+
+bool FramePipeline::IsFinished() const
+{
+	/* queue before busy count: a worker marks itself busy before it pops, so a popped frame is always seen */
+	if (!m_isSourceFinished || !m_detectQueue->IsEmpty()) return false;
+	return m_busyDetectorNum == 0 && m_displayQueue->IsEmpty() && m_resultQueue->IsEmpty();
+}
+
+void FramePipeline::CaptureLoop()
+{
+	uint64_t frameId = 0;
+	int idleNum = 0;
+	Profiler_setThreadName("capture");
+	while (m_isRunning) {
+		Frame *frame;
+		if (!m_freeFrames->TryPop(frame)) {
+			/* every frame is in use: the render thread is behind, drop its oldest pending frame */
+			Frame *oldest;
+			if (!m_isLossless && m_displayQueue->TryPop(oldest)) {
+				ReleaseFrame(oldest);
+				m_droppedNum++;
+			} else {
+				waitIdle(idleNum);
+			}
+			continue;
+		}
+		idleNum = 0;
+
+		/* cv::Mat keeps its buffer when the size doesn't change, so the pool never reallocates */
+		double captureStartTime = FramePipeline_getTime();
+		if (!m_source->Read(frame->image) || frame->image.empty()) {
+			m_freeFrames->TryPush(frame);
+			if (!m_source->IsLive()) break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+		frame->captureTime = FramePipeline_getTime();
+		frame->format = m_source->GetFormat();
+		frame->frameId = ++frameId;
+		Profiler_record("capture", frameId, captureStartTime, frame->captureTime);
+		if (frameId % m_detectInterval != 0) {
+			frame->refCount = 1;
+			PushLatest(*m_displayQueue, frame, m_droppedNum);
+			continue;
+		}
+		/* Gray (and smaller) image for detection, made once here. The render thread then owns the frame image */
+		{
+			ScopedTimer timer("preprocess", frameId);
+			frame->detectScale = m_frontEnd->Process(frame->image, frame->format, frame->detectImage);
+		}
+		frame->detectRegion = m_regionFunc ? m_regionFunc(frame->detectImage) : cv::Rect(0, 0, frame->detectImage.cols, frame->detectImage.rows);
+
+		frame->refCount = 2;
+		PushLatest(*m_detectQueue, frame, m_detectSkippedNum);
+		PushLatest(*m_displayQueue, frame, m_droppedNum);
+	}
+	m_isSourceFinished = true;
+}
+
+void FramePipeline::DetectionLoop(DetectFunc detectFunc)
+{
+	int idleNum = 0;
+	Profiler_setThreadName("detection");
+	while (m_isRunning) {
+		Frame *frame;
+		m_busyDetectorNum++;
+		if (!m_detectQueue->TryPop(frame)) {
+			m_busyDetectorNum--;
+			waitIdle(idleNum);
+			continue;
+		}
+		idleNum = 0;
+
+		DetectionResult result;
+		result.frameId = frame->frameId;
+		cv::Size imageSize = FrameFormat_getSize(frame->image, frame->format);
+		result.imageWidth = imageSize.width;
+		result.imageHeight = imageSize.height;
+		result.captureTime = frame->captureTime;
+		result.detectStartTime = FramePipeline_getTime();
+		detectFunc(*frame, result.listDet);
+		DetectionFrontEnd::MapToSource(frame->detectScale, result.listDet);
+		result.detectEndTime = FramePipeline_getTime();
+		Profiler_record("detect", result.frameId, result.detectStartTime, result.detectEndTime);
+		ReleaseFrame(frame);
+
+		int waitNum = 0;
+		while (!m_resultQueue->TryPush(std::move(result))) {
+			if (m_isLossless) {
+				if (!m_isRunning) break;
+				waitIdle(waitNum);
+				continue;
+			}
+			DetectionResult oldest;
+			m_resultQueue->TryPop(oldest);
+		}
+		m_busyDetectorNum--;
+	}
+}
+
+Frame *FramePipeline::AcquireDisplayFrame()
+{
+	Frame *latest = NULL;
+	Frame *frame;
+	if (m_isLossless) return m_displayQueue->TryPop(frame) ? frame : NULL;
+	while (m_displayQueue->TryPop(frame)) {
+		if (latest) {
+			ReleaseFrame(latest);
+			m_droppedNum++;
+		}
+		latest = frame;
+	}
+	return latest;
+}
+
+bool FramePipeline::GetLatestDetection(DetectionResult *result, std::vector<DetectionResult> *received)
+{
+	/* workers may finish out of order: keep the result of the newest frame */
+	if (received) received->clear();
+	DetectionResult newResult;
+	while (m_resultQueue->TryPop(newResult)) {
+		if (received) received->push_back(newResult);
+		if (newResult.frameId > m_latestResult.frameId) m_latestResult = std::move(newResult);
+	}
+	if (m_latestResult.frameId == 0) return false;
+	*result = m_latestResult;
+	bool isNew = m_latestResult.frameId != m_lastReturnedFrameId;
+	m_lastReturnedFrameId = m_latestResult.frameId;
+	return isNew;
+}
@@ -0,0 +1,114 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+#include <opencv2/opencv.hpp>
+
+#include "RingQueue.h"
+#include "FrameSource.h"
+#include "DetectionFrontEnd.h"
+
+/* Pooled frame shared by the display and detection stages (released by both) */
+typedef struct {
+	cv::Mat image;           /* in format: written by the render thread only (e.g. debug boxes) once handed over */
+	FrameFormat format;
+	cv::Mat detectImage;     /* gray, downscaled by DetectionFrontEnd: read only after capture */
+	float detectScale;       /* detectImage size / image size */
+	cv::Rect detectRegion;   /* part of detectImage to detect (RegionFunc): empty if nothing changed since the last detected frame */
+	uint64_t frameId;
+	double captureTime;      /* frame available (stage timings go to the Profiler) */
+	std::atomic<int> refCount;
+} Frame;
+
+typedef struct {
+	uint64_t frameId;
+	int imageWidth;          /* size of the frame the boxes refer to */
+	int imageHeight;
+	double captureTime;
+	double detectStartTime;
+	double detectEndTime;
+	std::vector<cv::Rect> listDet;   /* in image coordinates */
+} DetectionResult;
+
+/* Runs in a detection worker on frame.detectImage (boxes in its coordinates). Must only read the frame */
+typedef std::function<void(const Frame &frame, std::vector<cv::Rect> &listDet)> DetectFunc;
+/* Runs in the capture thread on every frame to be detected, in frame order. Returns its detectRegion */
+typedef std::function<cv::Rect(const cv::Mat &detectImage)> RegionFunc;
+
+/*
+ * capture thread --(latest wins)--> detection workers --> results
+ *                \--(latest wins)--> render thread (AcquireDisplayFrame)
+ * Queues are bounded and lock-free; when one is full the oldest frame is dropped, so no stage ever waits for a slower one.
+ * In lossless mode (benchmarking offline sources) every stage instead waits for room, and every frame is detected and shown.
+ */
+class FramePipeline
+{
+public:
+	explicit FramePipeline(int queueDepth = 2);
+	~FramePipeline();
+	/* One worker per detect function (each should own its classifier). No regionFunc: every detectRegion is the whole image */
+	bool Start(FrameSource *source, const std::vector<DetectFunc> &detectFuncs, const DetectionFrontEndConfig &frontEndConfig, bool isLossless = false,
+		const RegionFunc &regionFunc = RegionFunc());
+	void Stop();
+	/* The source has ended, every frame has been handed to the render thread and every detection result taken */
+	bool IsFinished() const;
+
+	/* Newest captured frame not shown yet (older ones are dropped; oldest first in lossless mode), NULL if none.
+	 * Give it back with ReleaseFrame */
+	Frame *AcquireDisplayFrame();
+	void ReleaseFrame(Frame *frame);
+	/* Most recent completed detection. Returns true if it is newer than the last one returned.
+	 * received (optional) gets every result that arrived since the last call, e.g. for statistics */
+	bool GetLatestDetection(DetectionResult *result, std::vector<DetectionResult> *received = NULL);
+
+	/* Frames never shown */
+	uint64_t GetDroppedNum() const { return m_droppedNum; }
+	/* Frames shown without being detected (evicted from a full detection queue) */
+	uint64_t GetDetectSkippedNum() const { return m_detectSkippedNum; }
+
+	/* Quality knobs, can be changed while running (applied from the next captured frame) */
+	void SetDetectWidth(int width);
+	/* Only every interval-th frame is detected (the others are just displayed) */
+	void SetDetectInterval(int interval) { m_detectInterval = (interval < 1) ? 1 : interval; }
+
+private:
+	FramePipeline(const FramePipeline&);
+	FramePipeline& operator=(const FramePipeline&);
+	void CaptureLoop();
+	void DetectionLoop(DetectFunc detectFunc);
+	void PushLatest(RingQueue<Frame*> &queue, Frame *frame, std::atomic<uint64_t> &evictedNum);
+
+private:
+	FrameSource *m_source;
+	bool m_isLossless;
+	std::unique_ptr<DetectionFrontEnd> m_frontEnd;   /* used by the capture thread only */
+	RegionFunc m_regionFunc;
+	int m_queueDepth;
+	std::vector<std::unique_ptr<Frame> > m_frames;
+	std::unique_ptr<RingQueue<Frame*> > m_freeFrames;
+	std::unique_ptr<RingQueue<Frame*> > m_detectQueue;
+	std::unique_ptr<RingQueue<Frame*> > m_displayQueue;
+	std::unique_ptr<RingQueue<DetectionResult> > m_resultQueue;
+	DetectionResult m_latestResult;
+	uint64_t m_lastReturnedFrameId;
+	std::thread m_captureThread;
+	std::vector<std::thread> m_detectionThreads;
+	std::atomic<bool> m_isRunning;
+	std::atomic<bool> m_isSourceFinished;
+	std::atomic<int> m_busyDetectorNum;
+	std::atomic<uint64_t> m_droppedNum;
+	std::atomic<uint64_t> m_detectSkippedNum;
+	std::atomic<int> m_detectInterval;
+	int m_detectWidth;       /* kept for a front end made by a later Start */
+};
+
+/* Seconds on the steady clock, the time base of all pipeline timestamps (same as Profiler_getTime) */
+double FramePipeline_getTime();
+
+#endif
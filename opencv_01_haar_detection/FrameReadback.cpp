@@ -0,0 +1,121 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/* for GLFW */
+#include <GL/glew.h>
+
+#include "FrameReadback.h"
+
+/*** Macro ***/
+/* Settings */
+#define FENCE_TIMEOUT_NS 100000000   /* 100 msec */
+
+/*** Functions ***/
+FrameReadback::FrameReadback(int depth)
+	: m_entries(depth < 1 ? 1 : depth), m_head(0), m_pendingNum(0), m_isMapped(false), m_width(0), m_height(0), m_droppedNum(0)
+{
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		m_entries[i].pbo = 0;
+		m_entries[i].fence = 0;
+	}
+}
+
+FrameReadback::~FrameReadback()
+{
+	Finalize();
+}
+
+bool FrameReadback::Initialize(int width, int height)
+{
+	Finalize();
+	if (width <= 0 || height <= 0) return false;
+	m_width = width;
+	m_height = height;
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		glGenBuffers(1, &m_entries[i].pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_entries[i].pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_droppedNum = 0;
+	return glGetError() == GL_NO_ERROR;
+}
+
+void FrameReadback::Finalize()
+{
+	if (m_isMapped) Release();
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		if (m_entries[i].fence) glDeleteSync(m_entries[i].fence);
+		if (m_entries[i].pbo) glDeleteBuffers(1, &m_entries[i].pbo);
+		m_entries[i].fence = 0;
+		m_entries[i].pbo = 0;
+	}
+	m_head = 0;
+	m_pendingNum = 0;
+}
+
+bool FrameReadback::Read(uint64_t frameId, double time)
+{
+	if (!IsInitialized()) return false;
+	if (m_pendingNum == (int)m_entries.size()) {
+		m_droppedNum++;
+		return false;
+	}
+	Entry &entry = m_entries[(m_head + m_pendingNum) % m_entries.size()];
+	/* BGRA is the layout drivers keep the color buffer in, so the copy needs no conversion pass */
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, entry.pbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, m_width, m_height, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	entry.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	entry.frameId = frameId;
+	entry.time = time;
+	m_pendingNum++;
+	return true;
+}
+
+bool FrameReadback::Acquire(ReadbackFrame *frame, bool isWait)
+{
+	if (m_pendingNum == 0 || m_isMapped) return false;
+	Entry &entry = m_entries[m_head];
+	GLenum status = glClientWaitSync(entry.fence, isWait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, isWait ? FENCE_TIMEOUT_NS : 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, entry.pbo);
+	const uint8_t *data = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)m_width * m_height * 4, GL_MAP_READ_BIT);
+	if (data == NULL) {
+		/* nothing to deliver for this one, but the buffer goes back to the ring */
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glDeleteSync(entry.fence);
+		entry.fence = 0;
+		m_head = (m_head + 1) % m_entries.size();
+		m_pendingNum--;
+		m_droppedNum++;
+		return false;
+	}
+	frame->data = data;
+	frame->width = m_width;
+	frame->height = m_height;
+	frame->stride = m_width * 4;
+	frame->frameId = entry.frameId;
+	frame->time = entry.time;
+	m_isMapped = true;
+	return true;
+}
+
+void FrameReadback::Release()
+{
+	if (!m_isMapped) return;
+	Entry &entry = m_entries[m_head];
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, entry.pbo);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glDeleteSync(entry.fence);
+	entry.fence = 0;
+	m_head = (m_head + 1) % m_entries.size();
+	m_pendingNum--;
+	m_isMapped = false;
+}
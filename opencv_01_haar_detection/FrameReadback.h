@@ -0,0 +1,65 @@
+#ifndef FRAME_READBACK_H
+#define FRAME_READBACK_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+/* A rendered frame in a mapped pack buffer. Valid until FrameReadback::Release */
+typedef struct {
+	const uint8_t *data;     /* BGRA, bottom row first (GL order) */
+	int width;
+	int height;
+	int stride;              /* in bytes */
+	uint64_t frameId;
+	double time;             /* given to Read */
+} ReadbackFrame;
+
+/*
+ * Asynchronous glReadPixels. Read copies the current read framebuffer into the next of a ring of pixel pack buffers
+ * and puts a fence behind it; the frame is mapped by Acquire once the fence has signaled, normally one or two frames later,
+ * so the render loop never waits for the GPU. GL context thread only
+ */
+class FrameReadback
+{
+public:
+	explicit FrameReadback(int depth = 3);
+	~FrameReadback();
+	bool Initialize(int width, int height);
+	void Finalize();
+	bool IsInitialized() const { return !m_entries.empty() && m_entries[0].pbo != 0; }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+
+	/* Call after drawing, before SwapBuffers. Skipped (returns false, counted as dropped) if every buffer is still pending */
+	bool Read(uint64_t frameId, double time);
+	/* Every buffer is pending: Read would drop the frame (Acquire with isWait first not to lose any) */
+	bool IsFull() const { return m_pendingNum == (int)m_entries.size(); }
+	/* Oldest read that has completed, mapped until Release. false if none yet (isWait: wait for it, e.g. when stopping) */
+	bool Acquire(ReadbackFrame *frame, bool isWait = false);
+	void Release();
+	uint64_t GetDroppedNum() const { return m_droppedNum; }
+
+private:
+	FrameReadback(const FrameReadback&);
+	FrameReadback& operator=(const FrameReadback&);
+
+	typedef struct {
+		GLuint pbo;
+		GLsync fence;
+		uint64_t frameId;
+		double time;
+	} Entry;
+
+private:
+	std::vector<Entry> m_entries;
+	int m_head;          /* oldest pending */
+	int m_pendingNum;
+	bool m_isMapped;
+	int m_width;
+	int m_height;
+	uint64_t m_droppedNum;
+};
+
+#endif
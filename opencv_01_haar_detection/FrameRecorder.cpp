@@ -0,0 +1,196 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "RingQueue.h"
+#include "Profiler.h"
+#include "FrameRecorder.h"
+
+/*** Macro ***/
+#define IDLE_SPIN_NUM  16     /* yields before a waiting thread (idle encoder, lossless Push) starts sleeping */
+#define IDLE_SLEEP_US 1000
+
+/*** Functions ***/
+void FrameRecorderConfig_getDefaultConfig(FrameRecorderConfig *config)
+{
+	config->fps = 30;
+	config->queueSize = 8;
+	config->fourcc = NULL;
+	config->isLossless = false;
+}
+
+static bool hasExtension(const std::string &path, const char *extension)
+{
+	size_t length = strlen(extension);
+	if (path.size() < length) return false;
+	for (size_t i = 0; i < length; i++) {
+		if (tolower((unsigned char)path[path.size() - length + i]) != extension[i]) return false;
+	}
+	return true;
+}
+
+FrameRecorder::FrameRecorder()
+	: m_output(RECORDER_OUTPUT_VIDEO), m_width(0), m_height(0), m_isRunning(false), m_recordedNum(0), m_droppedNum(0), m_y4mFile(NULL)
+{
+	FrameRecorderConfig_getDefaultConfig(&m_config);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	Stop();
+}
+
+bool FrameRecorder::Start(const char *path, int width, int height, const FrameRecorderConfig &config)
+{
+	if (m_isRunning || path == NULL || width <= 0 || height <= 0) return false;
+	m_path = path;
+	m_config = config;
+	m_width = width;
+	m_height = height;
+	if (hasExtension(m_path, ".y4m")) {
+		m_output = RECORDER_OUTPUT_Y4M;
+	} else if (hasExtension(m_path, ".png")) {
+		m_output = RECORDER_OUTPUT_PNG;
+	} else {
+		m_output = RECORDER_OUTPUT_VIDEO;
+	}
+	if (!OpenOutput()) return false;
+
+	/* Every slot is allocated here, so recording never allocates per frame */
+	int slotNum = (m_config.queueSize < 1) ? 1 : m_config.queueSize;
+	m_slots.assign(slotNum, Slot());
+	m_freeSlots.reset(new RingQueue<int>(slotNum));
+	m_readySlots.reset(new RingQueue<int>(slotNum));
+	for (int i = 0; i < slotNum; i++) {
+		m_slots[i].image.create(height, width, CV_8UC4);
+		m_freeSlots->TryPush(i);
+	}
+	m_recordedNum = 0;
+	m_droppedNum = 0;
+	m_isRunning = true;
+	m_encodeThread = std::thread(&FrameRecorder::EncodeLoop, this);
+	return true;
+}
+
+void FrameRecorder::Stop()
+{
+	if (!m_isRunning) return;
+	m_isRunning = false;
+	if (m_encodeThread.joinable()) m_encodeThread.join();
+	CloseOutput();
+	m_slots.clear();
+}
+
+bool FrameRecorder::Push(const ReadbackFrame &frame)
+{
+	int index = -1;
+	if (m_isRunning && frame.width == m_width && frame.height == m_height) {
+		int idleNum = 0;
+		while (!m_freeSlots->TryPop(index)) {
+			if (!m_config.isLossless) break;
+			if (idleNum++ < IDLE_SPIN_NUM) {
+				std::this_thread::yield();
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(IDLE_SLEEP_US));
+			}
+		}
+	}
+	if (index < 0) {
+		m_droppedNum++;
+		return false;
+	}
+	Slot &slot = m_slots[index];
+	cv::Mat(frame.height, frame.width, CV_8UC4, (void*)frame.data, frame.stride).copyTo(slot.image);
+	slot.frameId = frame.frameId;
+	slot.time = frame.time;
+	m_readySlots->TryPush(index);   /* never full: there are only as many slots as cells */
+	return true;
+}
+
+bool FrameRecorder::OpenOutput()
+{
+	if (m_output == RECORDER_OUTPUT_VIDEO) {
+		const char *fourcc = m_config.fourcc ? m_config.fourcc : (hasExtension(m_path, ".mp4") ? "mp4v" : "MJPG");
+		if (strlen(fourcc) != 4 || !m_writer.open(m_path, cv::VideoWriter::fourcc(fourcc[0], fourcc[1], fourcc[2], fourcc[3]), m_config.fps, cv::Size(m_width, m_height))) {
+			printf("Impossible to open %s for recording\n", m_path.c_str());
+			return false;
+		}
+	} else if (m_output == RECORDER_OUTPUT_Y4M) {
+		m_y4mFile = fopen(m_path.c_str(), "wb");
+		if (m_y4mFile == NULL) {
+			printf("Impossible to open %s for recording\n", m_path.c_str());
+			return false;
+		}
+		/* I420 needs even sizes: an odd last row / column is cut */
+		fprintf(m_y4mFile, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg\n", m_width & ~1, m_height & ~1, (int)std::lround(m_config.fps * 1000));
+	}
+	return true;
+}
+
+void FrameRecorder::CloseOutput()
+{
+	if (m_writer.isOpened()) m_writer.release();
+	if (m_y4mFile) fclose(m_y4mFile);
+	m_y4mFile = NULL;
+}
+
+void FrameRecorder::EncodeLoop()
+{
+	Profiler_setThreadName("recorder");
+	int idleNum = 0;
+	while (true) {
+		/* checked before popping: everything pushed before Stop is visible once it reads false */
+		bool isStopping = !m_isRunning;
+		int index;
+		if (!m_readySlots->TryPop(index)) {
+			if (isStopping) break;
+			if (idleNum++ < IDLE_SPIN_NUM) {
+				std::this_thread::yield();
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(IDLE_SLEEP_US));
+			}
+			continue;
+		}
+		idleNum = 0;
+		double encodeStartTime = Profiler_getTime();
+		if (WriteFrame(m_slots[index])) m_recordedNum++;
+		Profiler_record("encode", m_slots[index].frameId, encodeStartTime, Profiler_getTime());
+		m_freeSlots->TryPush(index);
+	}
+}
+
+bool FrameRecorder::WriteFrame(const Slot &slot)
+{
+	/* GL rows are bottom up */
+	if (m_output == RECORDER_OUTPUT_Y4M) {
+		cv::Mat image = slot.image(cv::Rect(0, 0, m_width & ~1, m_height & ~1));
+		cv::flip(image, m_bgr, 0);
+		cv::cvtColor(m_bgr, m_yuv, cv::COLOR_BGRA2YUV_I420);
+		fputs("FRAME\n", m_y4mFile);
+		return fwrite(m_yuv.data, 1, m_yuv.total(), m_y4mFile) == m_yuv.total();
+	}
+
+	/* the alpha of the color buffer isn't meaningful (cleared to 0), so the output is BGR */
+	cv::cvtColor(slot.image, m_bgr, cv::COLOR_BGRA2BGR);
+	cv::flip(m_bgr, m_bgr, 0);
+	if (m_output == RECORDER_OUTPUT_PNG) {
+		char number[16];
+		snprintf(number, sizeof(number), "_%06d", (int)m_recordedNum);
+		std::string path = m_path;
+		path.insert(path.size() - 4, number);
+		return cv::imwrite(path, m_bgr);
+	}
+	m_writer.write(m_bgr);
+	return true;
+}
@@ -0,0 +1,87 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+#include <opencv2/opencv.hpp>
+
+#include "RingQueue.h"
+#include "FrameReadback.h"
+
+/* Output by the file extension of the path */
+typedef enum {
+	RECORDER_OUTPUT_VIDEO,   /* cv::VideoWriter (.avi: MJPG, .mp4: mp4v, others: MJPG) */
+	RECORDER_OUTPUT_Y4M,     /* raw I420 YUV4MPEG2 (.y4m) */
+	RECORDER_OUTPUT_PNG,     /* numbered images, xxx.png -> xxx_000000.png, xxx_000001.png, ... */
+} RecorderOutput;
+
+typedef struct {
+	double fps;              /* frame rate written into the video / Y4M header */
+	int queueSize;           /* frames waiting for the encoder. A frame is dropped when it is full */
+	const char *fourcc;      /* VideoWriter codec (NULL: by extension) */
+	bool isLossless;         /* Push waits for a free slot instead of dropping the frame (offline rendering) */
+} FrameRecorderConfig;
+
+void FrameRecorderConfig_getDefaultConfig(FrameRecorderConfig *config);
+
+/*
+ * Writes read back frames on its own encoder thread. Push only copies the frame into a free slot of a bounded pool
+ * and queues it, so a slow encoder costs dropped recorded frames (counted), never the interactive frame rate
+ */
+class FrameRecorder
+{
+public:
+	FrameRecorder();
+	~FrameRecorder();
+	bool Start(const char *path, int width, int height, const FrameRecorderConfig &config);
+	/* Encodes every queued frame, then closes the output */
+	void Stop();
+	bool IsRecording() const { return m_isRunning; }
+	/* Render thread. false (dropped) if no slot is free (lossless: waits for one) */
+	bool Push(const ReadbackFrame &frame);
+	uint64_t GetRecordedNum() const { return m_recordedNum; }
+	uint64_t GetDroppedNum() const { return m_droppedNum; }
+
+private:
+	FrameRecorder(const FrameRecorder&);
+	FrameRecorder& operator=(const FrameRecorder&);
+
+	typedef struct {
+		cv::Mat image;       /* BGRA, bottom row first */
+		uint64_t frameId;
+		double time;
+	} Slot;
+
+	bool OpenOutput();
+	void CloseOutput();
+	void EncodeLoop();
+	bool WriteFrame(const Slot &slot);
+
+private:
+	std::string m_path;
+	RecorderOutput m_output;
+	FrameRecorderConfig m_config;
+	int m_width;
+	int m_height;
+	std::vector<Slot> m_slots;
+	std::unique_ptr<RingQueue<int> > m_freeSlots;
+	std::unique_ptr<RingQueue<int> > m_readySlots;
+	std::thread m_encodeThread;
+	std::atomic<bool> m_isRunning;
+	std::atomic<uint64_t> m_recordedNum;
+	std::atomic<uint64_t> m_droppedNum;
+
+	/* encoder thread only */
+	cv::VideoWriter m_writer;
+	FILE *m_y4mFile;
+	cv::Mat m_bgr;
+	cv::Mat m_yuv;
+};
+
+#endif
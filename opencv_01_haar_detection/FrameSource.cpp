@@ -0,0 +1,296 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "FrameSource.h"
+#include "SharedFrameReader.h"
+
+/*** Macro ***/
+#define SHARED_FRAME_WAIT_NUM 100   /* x 1 ms for a new frame in Read, then the capture loop retries */
+
+/*** Class ***/
+class CameraSource : public FrameSource
+{
+public:
+	CameraSource(int index, int width, int height, FrameFormat format) : m_index(index), m_format(format)
+	{
+		m_cap.open(index);
+		m_cap.set(cv::CAP_PROP_FRAME_WIDTH, width);
+		m_cap.set(cv::CAP_PROP_FRAME_HEIGHT, height);
+		m_cap.set(cv::CAP_PROP_BUFFERSIZE, 1);
+		if (m_format != FRAME_FORMAT_BGR) {
+			static const char *FOURCCS[] = { "BGR3", "YUYV", "NV12", "YU12" };
+			const char *fourcc = FOURCCS[m_format];
+			m_cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc(fourcc[0], fourcc[1], fourcc[2], fourcc[3]));
+			m_cap.set(cv::CAP_PROP_CONVERT_RGB, 0);
+		}
+		m_width = (int)m_cap.get(cv::CAP_PROP_FRAME_WIDTH);
+		m_height = (int)m_cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+	}
+	bool IsOpened() const { return m_cap.isOpened(); }
+	virtual bool Read(cv::Mat &image)
+	{
+		if (!m_cap.read(image) || image.empty()) return false;
+		if (m_format == FRAME_FORMAT_BGR) return true;
+
+		/* Backends hand raw buffers over in different shapes (e.g. 1 x N bytes): give them the documented one */
+		int rows = (m_format == FRAME_FORMAT_YUYV) ? m_height : m_height * 3 / 2;
+		int channels = (m_format == FRAME_FORMAT_YUYV) ? 2 : 1;
+		if (image.depth() == CV_8U && image.channels() != 3 && image.isContinuous() && image.total() * image.elemSize() == (size_t)rows * m_width * channels) {
+			image = image.reshape(channels, rows);
+			return true;
+		}
+		printf("%s doesn't deliver raw frames in the requested format. Use BGR\n", GetName().c_str());
+		m_cap.set(cv::CAP_PROP_CONVERT_RGB, 1);
+		m_format = FRAME_FORMAT_BGR;
+		return image.channels() == 3;
+	}
+	virtual FrameFormat GetFormat() const { return m_format; }
+	virtual bool IsLive() const { return true; }
+	virtual std::string GetName() const { return "camera:" + std::to_string(m_index); }
+
+private:
+	cv::VideoCapture m_cap;
+	int m_index;
+	FrameFormat m_format;
+	int m_width;
+	int m_height;
+};
+
+class VideoFileSource : public FrameSource
+{
+public:
+	explicit VideoFileSource(const std::string &path) : m_path(path) { m_cap.open(path); }
+	bool IsOpened() const { return m_cap.isOpened(); }
+	virtual bool Read(cv::Mat &image) { return m_cap.read(image) && !image.empty(); }
+	virtual bool IsLive() const { return false; }
+	virtual std::string GetName() const { return "video:" + m_path; }
+
+private:
+	cv::VideoCapture m_cap;
+	std::string m_path;
+};
+
+class ImageDirectorySource : public FrameSource
+{
+public:
+	explicit ImageDirectorySource(const std::string &dir) : m_dir(dir), m_index(0)
+	{
+		static const char *EXTENSIONS[] = { ".png", ".jpg", ".jpeg", ".bmp", ".ppm", ".pgm", ".tif", ".tiff" };
+		std::vector<cv::String> files;
+		cv::glob(dir + "/*", files, false);
+		for (size_t i = 0; i < files.size(); i++) {
+			std::string name = files[i];
+			std::string extension = name.substr((std::min)(name.size(), name.find_last_of('.')));
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			for (size_t j = 0; j < sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]); j++) {
+				if (extension == EXTENSIONS[j]) m_files.push_back(name);
+			}
+		}
+		std::sort(m_files.begin(), m_files.end());
+	}
+	bool IsOpened() const { return !m_files.empty(); }
+	virtual bool Read(cv::Mat &image)
+	{
+		while (m_index < m_files.size()) {
+			image = cv::imread(m_files[m_index++], cv::IMREAD_COLOR);
+			if (!image.empty()) return true;
+			printf("Impossible to read %s\n", m_files[m_index - 1].c_str());
+		}
+		return false;
+	}
+	virtual bool IsLive() const { return false; }
+	virtual std::string GetName() const { return "images:" + m_dir; }
+
+private:
+	std::string m_dir;
+	std::vector<std::string> m_files;
+	size_t m_index;
+};
+
+/* A bright blob moving on a Lissajous path over a gradient: exercises capture, detection and upload without a camera */
+class SyntheticSource : public FrameSource
+{
+public:
+	SyntheticSource(int width, int height, int frameNum) : m_width(width), m_height(height), m_frameNum(frameNum), m_index(0)
+	{
+		m_background.create(height, width, CV_8UC3);
+		for (int y = 0; y < height; y++) {
+			uint8_t *p = m_background.ptr(y);
+			for (int x = 0; x < width; x++) {
+				p[3 * x + 0] = (uint8_t)(64 + 128 * x / width);
+				p[3 * x + 1] = (uint8_t)(64 + 128 * y / height);
+				p[3 * x + 2] = 96;
+			}
+		}
+	}
+	virtual bool Read(cv::Mat &image)
+	{
+		if (m_frameNum > 0 && m_index >= m_frameNum) return false;
+		/* copyTo keeps the buffer of a pooled frame */
+		m_background.copyTo(image);
+		double t = m_index++ * 0.05;
+		int size = m_height / 4;
+		int x = (int)((m_width - size) * (0.5 + 0.45 * sin(t)));
+		int y = (int)((m_height - size) * (0.5 + 0.45 * sin(t * 1.3)));
+		cv::circle(image, cv::Point(x + size / 2, y + size / 2), size / 2, cv::Scalar(200, 220, 240), -1);
+		return true;
+	}
+	virtual bool IsLive() const { return false; }
+	virtual std::string GetName() const { return "synthetic:" + std::to_string(m_width) + "x" + std::to_string(m_height); }
+
+private:
+	int m_width;
+	int m_height;
+	int m_frameNum;
+	int m_index;
+	cv::Mat m_background;
+};
+
+/* Frames of a shared memory ring, held in their slot (the writer skips it) until the pipeline releases them.
+ * Follows a writer that starts later or restarts, once every frame of the previous ring is released */
+class SharedMemorySource : public FrameSource
+{
+public:
+	explicit SharedMemorySource(const std::string &name) : m_name(name), m_lastSequence(0), m_format(FRAME_FORMAT_BGR) {}
+	virtual ~SharedMemorySource()
+	{
+		/* holds still open are released by Detach */
+		m_reader.Detach();
+	}
+	virtual bool Read(cv::Mat &image)
+	{
+		if (m_reader.IsWriterClosed()) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_heldViews.empty() || !m_reader.Attach(m_name.c_str(), true)) return false;
+			m_lastSequence = 0;
+		}
+		SharedFrameView view;
+		for (int i = 0; !m_reader.HoldLatest(m_lastSequence, &view); i++) {
+			if (i >= SHARED_FRAME_WAIT_NUM || m_reader.IsWriterClosed()) return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		m_lastSequence = view.sequence;
+
+		void *data = const_cast<uint8_t*>(view.data);
+		switch (view.format) {
+		case SHARED_FRAME_FORMAT_BGRA:
+			/* no such frame format: converted, and the slot given back right away */
+			cv::cvtColor(cv::Mat(view.height, view.width, CV_8UC4, data, view.stride), image, cv::COLOR_BGRA2BGR);
+			m_reader.Release(view);
+			m_format = FRAME_FORMAT_BGR;
+			return true;
+		case SHARED_FRAME_FORMAT_BGR:
+			image = cv::Mat(view.height, view.width, CV_8UC3, data, view.stride);
+			m_format = FRAME_FORMAT_BGR;
+			break;
+		case SHARED_FRAME_FORMAT_YUYV:
+			image = cv::Mat(view.height, view.width, CV_8UC2, data, view.stride);
+			m_format = FRAME_FORMAT_YUYV;
+			break;
+		case SHARED_FRAME_FORMAT_NV12:
+		case SHARED_FRAME_FORMAT_I420:
+			image = cv::Mat(view.height * 3 / 2, view.width, CV_8UC1, data, view.stride);
+			m_format = (view.format == SHARED_FRAME_FORMAT_NV12) ? FRAME_FORMAT_NV12 : FRAME_FORMAT_I420;
+			break;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_heldViews.push_back(view);
+		return true;
+	}
+	virtual void ReleaseFrame(cv::Mat &image)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < m_heldViews.size(); i++) {
+			if (m_heldViews[i].data == image.data) {
+				m_reader.Release(m_heldViews[i]);
+				m_heldViews.erase(m_heldViews.begin() + i);
+				/* no view of the slot is left behind in the pool */
+				image.release();
+				return;
+			}
+		}
+	}
+	virtual FrameFormat GetFormat() const { return m_format; }
+	virtual bool IsLive() const { return true; }
+	virtual bool IsZeroCopy() const { return true; }
+	virtual std::string GetName() const { return "shm:" + m_name; }
+
+private:
+	std::string m_name;
+	SharedFrameReader m_reader;
+	uint64_t m_lastSequence;
+	FrameFormat m_format;
+	std::mutex m_mutex;
+	std::vector<SharedFrameView> m_heldViews;
+};
+
+/*** Functions ***/
+cv::Size FrameFormat_getSize(const cv::Mat &image, FrameFormat format)
+{
+	if (format == FRAME_FORMAT_NV12 || format == FRAME_FORMAT_I420) return cv::Size(image.cols, image.rows * 2 / 3);
+	return cv::Size(image.cols, image.rows);
+}
+
+cv::Mat FrameFormat_getLumaPlane(const cv::Mat &image, FrameFormat format)
+{
+	if (format == FRAME_FORMAT_NV12 || format == FRAME_FORMAT_I420) return image.rowRange(0, image.rows * 2 / 3);
+	return cv::Mat();
+}
+
+std::unique_ptr<FrameSource> FrameSource_create(const std::string &spec, int width, int height)
+{
+	size_t colon = spec.find(':');
+	std::string type = spec.substr(0, colon);
+	std::string arg = (colon == std::string::npos) ? "" : spec.substr(colon + 1);
+
+	if (type == "camera") {
+		std::string formatName = (arg.find(':') == std::string::npos) ? "bgr" : arg.substr(arg.find(':') + 1);
+		FrameFormat format = FRAME_FORMAT_BGR;
+		if (formatName == "yuyv") {
+			format = FRAME_FORMAT_YUYV;
+		} else if (formatName == "nv12") {
+			format = FRAME_FORMAT_NV12;
+		} else if (formatName == "i420") {
+			format = FRAME_FORMAT_I420;
+		} else if (formatName != "bgr") {
+			printf("Unknown camera format %s\n", formatName.c_str());
+			return std::unique_ptr<FrameSource>();
+		}
+		std::unique_ptr<CameraSource> source(new CameraSource(arg.empty() ? 0 : atoi(arg.c_str()), width, height, format));
+		if (source->IsOpened()) return std::move(source);
+	} else if (type == "video") {
+		std::unique_ptr<VideoFileSource> source(new VideoFileSource(arg));
+		if (source->IsOpened()) return std::move(source);
+	} else if (type == "images") {
+		std::unique_ptr<ImageDirectorySource> source(new ImageDirectorySource(arg));
+		if (source->IsOpened()) return std::move(source);
+	} else if (type == "shm") {
+		if (!arg.empty()) return std::unique_ptr<FrameSource>(new SharedMemorySource(arg));
+	} else if (type == "synthetic") {
+		/* the capture size is for cameras: a synthetic source is 1280x720 unless the spec sizes it */
+		int frameNum = 0;
+		width = 1280;
+		height = 720;
+		if (!arg.empty()) sscanf(arg.c_str(), "%dx%d:%d", &width, &height, &frameNum);
+		if (width > 0 && height > 0) return std::unique_ptr<FrameSource>(new SyntheticSource(width, height, frameNum));
+	} else {
+		printf("Unknown frame source %s\n", spec.c_str());
+		return std::unique_ptr<FrameSource>();
+	}
+	printf("Impossible to open frame source %s\n", spec.c_str());
+	return std::unique_ptr<FrameSource>();
+}
@@ -0,0 +1,53 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <string>
+#include <memory>
+
+#include <opencv2/opencv.hpp>
+
+/* Pixel layout of the frames of a source. YUV frames are kept as the camera delivers them, in one cv::Mat:
+ * YUYV: height x width CV_8UC2 (Y0 U Y1 V), NV12 / I420: height * 3 / 2 x width CV_8UC1 (the Y plane, then the chroma planes) */
+typedef enum {
+	FRAME_FORMAT_BGR,
+	FRAME_FORMAT_YUYV,
+	FRAME_FORMAT_NV12,
+	FRAME_FORMAT_I420,
+} FrameFormat;
+
+/* Picture size of a frame (not the size of the Mat) */
+cv::Size FrameFormat_getSize(const cv::Mat &image, FrameFormat format);
+/* Y plane of a planar YUV frame, as a view into it (no copy). Empty for the other formats */
+cv::Mat FrameFormat_getLumaPlane(const cv::Mat &image, FrameFormat format);
+
+/* Where frames come from. Read is called from the capture thread only */
+class FrameSource
+{
+public:
+	virtual ~FrameSource() {}
+	/* Frame in GetFormat() layout. false at the end of the stream (or on a camera error) */
+	virtual bool Read(cv::Mat &image) = 0;
+	/* Can change after the first Read (e.g. a camera that doesn't deliver the requested raw format) */
+	virtual FrameFormat GetFormat() const { return FRAME_FORMAT_BGR; }
+	/* Live sources produce frames in real time; offline ones as fast as they are read */
+	virtual bool IsLive() const = 0;
+	virtual std::string GetName() const = 0;
+	/* Frames are views of memory the source owns (no copy): read only, and given back with ReleaseFrame */
+	virtual bool IsZeroCopy() const { return false; }
+	/* The pipeline is done with a frame of Read (from any thread). Zero copy sources take their memory back here */
+	virtual void ReleaseFrame(cv::Mat &image) { (void)image; }
+};
+
+/*
+ * "camera[:index[:format]]"      cv::VideoCapture on a device (default 0). format yuyv, nv12 or i420 grabs the raw frames
+ *                                (no BGR conversion on the CPU), bgr by default
+ * "video:<path>"                 video file
+ * "images:<directory>"           image files of a directory in name order
+ * "synthetic[:WxH[:frames]]"     generated moving blob, deterministic (default 1280x720, endless)
+ * "shm:<name>"                   shared memory frame ring (SharedFrame.h, e.g. written by shm_frame_producer): the newest frame
+ *                                each time, used in place. Formats as written (BGRA is converted to BGR)
+ * width / height are the requested capture size for cameras
+ */
+std::unique_ptr<FrameSource> FrameSource_create(const std::string &spec, int width, int height);
+
+#endif
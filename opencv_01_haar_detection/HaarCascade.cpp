@@ -0,0 +1,507 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "ResourcePack.h"
+#include "HaarCascade.h"
+
+/*** Macro ***/
+/* Settings */
+#define STAGE_THRESHOLD_EPS 1e-5f   /* same margin as cv::CascadeClassifier */
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+/* Tables in a binary: 9 stage / weak / node / leaf tables, 5 per rectangle and featureTilted */
+#define BINARY_SECTION_NUM (9 + HAAR_RECT_NUM * 5 + 1)
+
+/*** Global variables ***/
+
+/*** Functions ***/
+static uint32_t readU32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void writeU32(std::vector<uint8_t> &buffer, size_t pos, uint32_t value)
+{
+	for (int i = 0; i < 4; i++) buffer[pos + i] = (uint8_t)(value >> (8 * i));
+}
+
+/* FNV-1a */
+static uint64_t hashBytes(const uint8_t *data, size_t size)
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+/* In the pack or a loose file (without Resource_read complaining when it is not there) */
+static bool isAvailable(const char *path)
+{
+	if (Resource_isInPack(path)) return true;
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL) return false;
+	fclose(fp);
+	return true;
+}
+
+/* Every table of the data in file order with its size in bytes. The tables themselves are stored in host order (little endian on every target) */
+static void getSections(const HaarCascadeData &data, const void *tables[BINARY_SECTION_NUM], size_t sizes[BINARY_SECTION_NUM])
+{
+	int s = 0;
+	tables[s] = data.stageWeakBegin; sizes[s++] = sizeof(int32_t) * (data.stageNum + 1);
+	tables[s] = data.stageThreshold; sizes[s++] = sizeof(float) * data.stageNum;
+	tables[s] = data.weakNodeBegin;  sizes[s++] = sizeof(int32_t) * data.weakNum;
+	tables[s] = data.weakLeafBegin;  sizes[s++] = sizeof(int32_t) * data.weakNum;
+	tables[s] = data.nodeFeature;    sizes[s++] = sizeof(int32_t) * data.nodeNum;
+	tables[s] = data.nodeThreshold;  sizes[s++] = sizeof(float) * data.nodeNum;
+	tables[s] = data.nodeLeft;       sizes[s++] = sizeof(int32_t) * data.nodeNum;
+	tables[s] = data.nodeRight;      sizes[s++] = sizeof(int32_t) * data.nodeNum;
+	tables[s] = data.leafValue;      sizes[s++] = sizeof(float) * data.leafNum;
+	for (int r = 0; r < HAAR_RECT_NUM; r++) {
+		tables[s] = data.rectX[r];      sizes[s++] = sizeof(int16_t) * data.featureNum;
+		tables[s] = data.rectY[r];      sizes[s++] = sizeof(int16_t) * data.featureNum;
+		tables[s] = data.rectWidth[r];  sizes[s++] = sizeof(int16_t) * data.featureNum;
+		tables[s] = data.rectHeight[r]; sizes[s++] = sizeof(int16_t) * data.featureNum;
+		tables[s] = data.rectWeight[r]; sizes[s++] = sizeof(float) * data.featureNum;
+	}
+	tables[s] = data.featureTilted;  sizes[s++] = sizeof(uint8_t) * data.featureNum;
+}
+
+/* Same order as getSections */
+static void setSections(HaarCascadeData &data, const uint8_t *tables[BINARY_SECTION_NUM])
+{
+	int s = 0;
+	data.stageWeakBegin = (const int32_t*)tables[s++];
+	data.stageThreshold = (const float*)tables[s++];
+	data.weakNodeBegin = (const int32_t*)tables[s++];
+	data.weakLeafBegin = (const int32_t*)tables[s++];
+	data.nodeFeature = (const int32_t*)tables[s++];
+	data.nodeThreshold = (const float*)tables[s++];
+	data.nodeLeft = (const int32_t*)tables[s++];
+	data.nodeRight = (const int32_t*)tables[s++];
+	data.leafValue = (const float*)tables[s++];
+	for (int r = 0; r < HAAR_RECT_NUM; r++) {
+		data.rectX[r] = (const int16_t*)tables[s++];
+		data.rectY[r] = (const int16_t*)tables[s++];
+		data.rectWidth[r] = (const int16_t*)tables[s++];
+		data.rectHeight[r] = (const int16_t*)tables[s++];
+		data.rectWeight[r] = (const float*)tables[s++];
+	}
+	data.featureTilted = (const uint8_t*)tables[s++];
+}
+
+static void computeFlags(HaarCascadeData &data)
+{
+	data.isStumpOnly = 1;
+	for (int w = 0; w < data.weakNum; w++) {
+		int nodeEnd = (w + 1 < data.weakNum) ? data.weakNodeBegin[w + 1] : data.nodeNum;
+		int node = data.weakNodeBegin[w];
+		if (nodeEnd - node != 1 || data.nodeLeft[node] != 0 || data.nodeRight[node] != -1) data.isStumpOnly = 0;
+	}
+	data.hasTilted = 0;
+	for (int f = 0; f < data.featureNum; f++) data.hasTilted |= data.featureTilted[f];
+}
+
+/* A binary is used in place, so every index the evaluator follows and every rectangle it reads is checked once here */
+static bool isValidData(const HaarCascadeData &data)
+{
+	if (data.windowWidth <= 0 || data.windowHeight <= 0 || data.stageNum <= 0 || data.weakNum <= 0 || data.nodeNum <= 0 || data.leafNum <= 0 || data.featureNum <= 0) return false;
+	if (data.stageWeakBegin[0] != 0 || data.stageWeakBegin[data.stageNum] != data.weakNum) return false;
+	for (int s = 0; s < data.stageNum; s++) {
+		if (data.stageWeakBegin[s] > data.stageWeakBegin[s + 1]) return false;
+	}
+	for (int w = 0; w < data.weakNum; w++) {
+		int nodeBegin = data.weakNodeBegin[w];
+		int nodeEnd = (w + 1 < data.weakNum) ? data.weakNodeBegin[w + 1] : data.nodeNum;
+		int leafBegin = data.weakLeafBegin[w];
+		int leafEnd = (w + 1 < data.weakNum) ? data.weakLeafBegin[w + 1] : data.leafNum;
+		if (nodeBegin < 0 || nodeBegin >= nodeEnd || nodeEnd > data.nodeNum) return false;
+		if (leafBegin < 0 || leafBegin >= leafEnd || leafEnd > data.leafNum) return false;
+		for (int n = nodeBegin; n < nodeEnd; n++) {
+			if (data.nodeFeature[n] < 0 || data.nodeFeature[n] >= data.featureNum) return false;
+			/* children are further down the tree, so walking it always ends on a leaf */
+			const int32_t child[2] = { data.nodeLeft[n], data.nodeRight[n] };
+			for (int i = 0; i < 2; i++) {
+				if (child[i] > 0 && (child[i] <= n - nodeBegin || child[i] >= nodeEnd - nodeBegin)) return false;
+				if (child[i] <= 0 && -child[i] >= leafEnd - leafBegin) return false;
+			}
+		}
+	}
+	for (int f = 0; f < data.featureNum; f++) {
+		for (int r = 0; r < HAAR_RECT_NUM; r++) {
+			int x = data.rectX[r][f], y = data.rectY[r][f], width = data.rectWidth[r][f], height = data.rectHeight[r][f];
+			if (width < 0 || height < 0 || y < 0) return false;
+			if (data.featureTilted[f]) {
+				if (x - height < 0 || x + width > data.windowWidth || y + width + height > data.windowHeight) return false;
+			} else {
+				if (x < 0 || x + width > data.windowWidth || y + height > data.windowHeight) return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void readRects(const cv::FileNode &rectsNode, int rect[HAAR_RECT_NUM][4], float weight[HAAR_RECT_NUM])
+{
+	memset(rect, 0, sizeof(int) * HAAR_RECT_NUM * 4);
+	for (int r = 0; r < HAAR_RECT_NUM; r++) weight[r] = 0.0f;
+	for (int r = 0; r < (int)rectsNode.size() && r < HAAR_RECT_NUM; r++) {
+		cv::FileNode rectNode = rectsNode[r];
+		for (int i = 0; i < 4; i++) rect[r][i] = (int)rectNode[i];
+		weight[r] = (float)rectNode[4];
+	}
+}
+
+/* Current format (opencv_traincascade, or converted): features in one table, weak classifiers referring to them */
+static bool readCascade(const cv::FileNode &root, HaarCascade &cascade)
+{
+	if ((std::string)root["featureType"] != "HAAR") {
+		printf("only HAAR cascades are supported\n");
+		return false;
+	}
+	cv::FileNode featuresNode = root["features"];
+	for (int f = 0; f < (int)featuresNode.size(); f++) {
+		int rect[HAAR_RECT_NUM][4];
+		float weight[HAAR_RECT_NUM];
+		readRects(featuresNode[f]["rects"], rect, weight);
+		cv::FileNode tiltedNode = featuresNode[f]["tilted"];
+		cascade.AddFeature(rect, weight, !tiltedNode.empty() && (int)tiltedNode != 0);
+	}
+	cv::FileNode stagesNode = root["stages"];
+	for (int s = 0; s < (int)stagesNode.size(); s++) {
+		cv::FileNode stageNode = stagesNode[s];
+		cv::FileNode weaksNode = stageNode["weakClassifiers"];
+		cascade.BeginStage();
+		for (int w = 0; w < (int)weaksNode.size(); w++) {
+			cv::FileNode internalNodes = weaksNode[w]["internalNodes"];
+			cv::FileNode leafValues = weaksNode[w]["leafValues"];
+			std::vector<int32_t> nodeFeature, nodeLeft, nodeRight;
+			std::vector<float> nodeThreshold, leafValue;
+			for (int n = 0; n + 3 < (int)internalNodes.size(); n += 4) {
+				nodeLeft.push_back((int)internalNodes[n]);
+				nodeRight.push_back((int)internalNodes[n + 1]);
+				nodeFeature.push_back((int)internalNodes[n + 2]);
+				nodeThreshold.push_back((float)internalNodes[n + 3]);
+			}
+			for (int l = 0; l < (int)leafValues.size(); l++) leafValue.push_back((float)leafValues[l]);
+			cascade.AddWeak(nodeFeature, nodeThreshold, nodeLeft, nodeRight, leafValue);
+		}
+		cascade.EndStage((float)stageNode["stageThreshold"] - STAGE_THRESHOLD_EPS);
+	}
+	cascade.Finish((int)root["width"], (int)root["height"]);
+	return true;
+}
+
+/* Old haartraining format: every tree node carries its feature, children are node indices or leaf values */
+static bool readOldCascade(const cv::FileNode &root, HaarCascade &cascade)
+{
+	cv::FileNode sizeNode = root["size"];
+	if (sizeNode.size() < 2) return false;
+	cv::FileNode stagesNode = root["stages"];
+	for (int s = 0; s < (int)stagesNode.size(); s++) {
+		cv::FileNode stageNode = stagesNode[s];
+		cv::FileNode treesNode = stageNode["trees"];
+		cascade.BeginStage();
+		for (int t = 0; t < (int)treesNode.size(); t++) {
+			cv::FileNode treeNode = treesNode[t];
+			std::vector<int32_t> nodeFeature, nodeLeft, nodeRight;
+			std::vector<float> nodeThreshold, leafValue;
+			for (int n = 0; n < (int)treeNode.size(); n++) {
+				cv::FileNode node = treeNode[n];
+				int rect[HAAR_RECT_NUM][4];
+				float weight[HAAR_RECT_NUM];
+				readRects(node["feature"]["rects"], rect, weight);
+				cv::FileNode tiltedNode = node["feature"]["tilted"];
+				nodeFeature.push_back(cascade.AddFeature(rect, weight, !tiltedNode.empty() && (int)tiltedNode != 0));
+				nodeThreshold.push_back((float)node["threshold"]);
+				if (!node["left_val"].empty()) {
+					nodeLeft.push_back(-(int32_t)leafValue.size());
+					leafValue.push_back((float)node["left_val"]);
+				} else {
+					nodeLeft.push_back((int)node["left_node"]);
+				}
+				if (!node["right_val"].empty()) {
+					nodeRight.push_back(-(int32_t)leafValue.size());
+					leafValue.push_back((float)node["right_val"]);
+				} else {
+					nodeRight.push_back((int)node["right_node"]);
+				}
+			}
+			cascade.AddWeak(nodeFeature, nodeThreshold, nodeLeft, nodeRight, leafValue);
+		}
+		cascade.EndStage((float)stageNode["stage_threshold"] - STAGE_THRESHOLD_EPS);
+	}
+	cascade.Finish((int)sizeNode[0], (int)sizeNode[1]);
+	return true;
+}
+
+HaarCascade::HaarCascade()
+{
+	Clear();
+}
+
+bool HaarCascade::Load(const char *path)
+{
+	/* The binary written by cascade_compiler (or put into the pack by pack_builder) is mapped and used as is,
+	 * unless it is left over from an older XML: it has to be compiled from the XML that is there now */
+	ResourceView view;
+	std::string binaryPath = HaarCascade_getBinaryPath(path);
+	if (binaryPath != path && isAvailable(binaryPath.c_str()) && Resource_read(binaryPath.c_str(), &view)) {
+		if (!LoadFromBinary(view.data, view.size, view.holder)) {
+			printf("%s is not a valid cascade binary. %s is read instead\n", binaryPath.c_str(), path);
+		} else {
+			if (!isAvailable(path)) return true;   /* only the binary is shipped */
+			ResourceView source;
+			if (Resource_read(path, &source) && IsBuiltFrom(source.data, source.size)) return true;
+			printf("%s was not compiled from the current %s. %s is read instead\n", binaryPath.c_str(), path, path);
+		}
+	}
+
+	if (!Resource_read(path, &view)) return false;
+	if (HaarCascade_isBinary(view.data, view.size)) return LoadFromBinary(view.data, view.size, view.holder);
+	return view.size > 0 && LoadFromMemory((const char*)view.data, view.size);
+}
+
+bool HaarCascade::LoadFromMemory(const char *xml, size_t size)
+{
+	Clear();
+	bool isLoaded = false;
+	try {
+		cv::FileStorage fs(std::string(xml, size), cv::FileStorage::READ | cv::FileStorage::MEMORY);
+		if (!fs.isOpened()) return false;
+		cv::FileNode root = fs.getFirstTopLevelNode();
+		isLoaded = root["features"].empty() ? readOldCascade(root, *this) : readCascade(root, *this);
+	} catch (const cv::Exception &e) {
+		printf("failed to read the cascade: %s\n", e.what());
+		isLoaded = false;
+	}
+	if (!isLoaded) {
+		Clear();
+		return false;
+	}
+	m_sourceSize = (uint32_t)size;
+	m_sourceHash = hashBytes((const uint8_t*)xml, size);
+	return !IsEmpty();
+}
+
+bool HaarCascade::LoadFromBinary(const uint8_t *data, size_t size, std::shared_ptr<const void> holder)
+{
+	Clear();
+	if (!HaarCascade_isBinary(data, size) || size < HAAR_BINARY_HEADER_SIZE + BINARY_SECTION_NUM * 4) return false;
+	if (readU32(data + 4) != HAAR_BINARY_VERSION || readU32(data + 40) != BINARY_SECTION_NUM || readU32(data + 44) > size) return false;
+	if (!holder || ((uintptr_t)data & 3) != 0) {
+		std::shared_ptr<std::vector<uint32_t> > copy = std::make_shared<std::vector<uint32_t> >((size + 3) / 4);
+		memcpy(&(*copy)[0], data, size);
+		data = (const uint8_t*)&(*copy)[0];
+		holder = copy;
+	}
+
+	HaarCascadeData &header = m_data;
+	header.windowWidth = (int32_t)readU32(data + 8);
+	header.windowHeight = (int32_t)readU32(data + 12);
+	header.stageNum = (int32_t)readU32(data + 16);
+	header.weakNum = (int32_t)readU32(data + 20);
+	header.nodeNum = (int32_t)readU32(data + 24);
+	header.leafNum = (int32_t)readU32(data + 28);
+	header.featureNum = (int32_t)readU32(data + 32);
+	uint32_t flags = readU32(data + 36);
+	m_sourceSize = readU32(data + 48);
+	m_sourceHash = (uint64_t)readU32(data + 56) | ((uint64_t)readU32(data + 60) << 32);
+	if (header.stageNum < 0 || header.weakNum < 0 || header.nodeNum < 0 || header.leafNum < 0 || header.featureNum < 0) {
+		Clear();
+		return false;
+	}
+
+	const void *unused[BINARY_SECTION_NUM];
+	size_t sizes[BINARY_SECTION_NUM];
+	const uint8_t *tables[BINARY_SECTION_NUM];
+	getSections(header, unused, sizes);
+	for (int s = 0; s < BINARY_SECTION_NUM; s++) {
+		uint32_t offset = readU32(data + HAAR_BINARY_HEADER_SIZE + s * 4);
+		if ((offset & 3) != 0 || offset > size || sizes[s] > size - offset) {
+			Clear();
+			return false;
+		}
+		tables[s] = data + offset;
+	}
+	setSections(m_data, tables);
+	if (!isValidData(m_data)) {
+		Clear();
+		return false;
+	}
+	computeFlags(m_data);
+	if (((flags & HAAR_BINARY_FLAG_STUMP_ONLY) != 0) != (m_data.isStumpOnly != 0) || ((flags & HAAR_BINARY_FLAG_TILTED) != 0) != (m_data.hasTilted != 0)) {
+		Clear();
+		return false;
+	}
+	m_binaryHolder = holder;
+	return true;
+}
+
+void HaarCascade::ToBinary(std::vector<uint8_t> &binary) const
+{
+	const void *tables[BINARY_SECTION_NUM];
+	size_t sizes[BINARY_SECTION_NUM];
+	getSections(m_data, tables, sizes);
+	size_t offsets[BINARY_SECTION_NUM];
+	size_t offset = HAAR_BINARY_HEADER_SIZE + BINARY_SECTION_NUM * 4;
+	for (int s = 0; s < BINARY_SECTION_NUM; s++) {
+		offset = (offset + HAAR_BINARY_ALIGNMENT - 1) & ~(size_t)(HAAR_BINARY_ALIGNMENT - 1);
+		offsets[s] = offset;
+		offset += sizes[s];
+	}
+
+	binary.assign(offset, 0);
+	memcpy(&binary[0], HAAR_BINARY_MAGIC, 4);
+	writeU32(binary, 4, HAAR_BINARY_VERSION);
+	writeU32(binary, 8, (uint32_t)m_data.windowWidth);
+	writeU32(binary, 12, (uint32_t)m_data.windowHeight);
+	writeU32(binary, 16, (uint32_t)m_data.stageNum);
+	writeU32(binary, 20, (uint32_t)m_data.weakNum);
+	writeU32(binary, 24, (uint32_t)m_data.nodeNum);
+	writeU32(binary, 28, (uint32_t)m_data.leafNum);
+	writeU32(binary, 32, (uint32_t)m_data.featureNum);
+	writeU32(binary, 36, (m_data.isStumpOnly ? HAAR_BINARY_FLAG_STUMP_ONLY : 0) | (m_data.hasTilted ? HAAR_BINARY_FLAG_TILTED : 0));
+	writeU32(binary, 40, BINARY_SECTION_NUM);
+	writeU32(binary, 44, (uint32_t)binary.size());
+	writeU32(binary, 48, m_sourceSize);
+	writeU32(binary, 56, (uint32_t)m_sourceHash);
+	writeU32(binary, 60, (uint32_t)(m_sourceHash >> 32));
+	for (int s = 0; s < BINARY_SECTION_NUM; s++) {
+		writeU32(binary, HAAR_BINARY_HEADER_SIZE + s * 4, (uint32_t)offsets[s]);
+		if (tables[s] != NULL && sizes[s] > 0) memcpy(&binary[offsets[s]], tables[s], sizes[s]);
+	}
+}
+
+bool HaarCascade::SaveBinary(const char *path) const
+{
+	if (IsEmpty()) return false;
+	std::vector<uint8_t> binary;
+	ToBinary(binary);
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL) {
+		printf("failed to open %s\n", path);
+		return false;
+	}
+	bool isWritten = (fwrite(&binary[0], 1, binary.size(), fp) == binary.size());
+	fclose(fp);
+	return isWritten;
+}
+
+bool HaarCascade::IsBuiltFrom(const uint8_t *xml, size_t size) const
+{
+	return m_sourceSize != 0 && m_sourceSize == size && m_sourceHash == hashBytes(xml, size);
+}
+
+void HaarCascade::Clear()
+{
+	m_stageWeakBegin.assign(1, 0);
+	m_stageThreshold.clear();
+	m_weakNodeBegin.clear();
+	m_weakLeafBegin.clear();
+	m_nodeFeature.clear();
+	m_nodeThreshold.clear();
+	m_nodeLeft.clear();
+	m_nodeRight.clear();
+	m_leafValue.clear();
+	for (int r = 0; r < HAAR_RECT_NUM; r++) {
+		for (int i = 0; i < 4; i++) m_rect[r][i].clear();
+		m_rectWeight[r].clear();
+	}
+	m_featureTilted.clear();
+	m_binaryHolder.reset();
+	m_sourceSize = 0;
+	m_sourceHash = 0;
+	memset(&m_data, 0, sizeof(m_data));
+}
+
+int HaarCascade::AddFeature(const int rect[HAAR_RECT_NUM][4], const float weight[HAAR_RECT_NUM], bool isTilted)
+{
+	for (int r = 0; r < HAAR_RECT_NUM; r++) {
+		for (int i = 0; i < 4; i++) m_rect[r][i].push_back((int16_t)rect[r][i]);
+		m_rectWeight[r].push_back(weight[r]);
+	}
+	m_featureTilted.push_back(isTilted ? 1 : 0);
+	return (int)m_featureTilted.size() - 1;
+}
+
+void HaarCascade::BeginStage()
+{
+	m_stageWeakBegin.back() = (int32_t)m_weakNodeBegin.size();
+}
+
+void HaarCascade::AddWeak(const std::vector<int32_t> &nodeFeature, const std::vector<float> &nodeThreshold,
+	const std::vector<int32_t> &nodeLeft, const std::vector<int32_t> &nodeRight, const std::vector<float> &leafValue)
+{
+	m_weakNodeBegin.push_back((int32_t)m_nodeFeature.size());
+	m_weakLeafBegin.push_back((int32_t)m_leafValue.size());
+	m_nodeFeature.insert(m_nodeFeature.end(), nodeFeature.begin(), nodeFeature.end());
+	m_nodeThreshold.insert(m_nodeThreshold.end(), nodeThreshold.begin(), nodeThreshold.end());
+	m_nodeLeft.insert(m_nodeLeft.end(), nodeLeft.begin(), nodeLeft.end());
+	m_nodeRight.insert(m_nodeRight.end(), nodeRight.begin(), nodeRight.end());
+	m_leafValue.insert(m_leafValue.end(), leafValue.begin(), leafValue.end());
+}
+
+void HaarCascade::EndStage(float threshold)
+{
+	m_stageThreshold.push_back(threshold);
+	m_stageWeakBegin.push_back((int32_t)m_weakNodeBegin.size());
+}
+
+void HaarCascade::Finish(int windowWidth, int windowHeight)
+{
+	HaarCascadeData &data = m_data;
+	data.windowWidth = windowWidth;
+	data.windowHeight = windowHeight;
+	data.stageNum = (int)m_stageThreshold.size();
+	data.weakNum = (int)m_weakNodeBegin.size();
+	data.nodeNum = (int)m_nodeFeature.size();
+	data.leafNum = (int)m_leafValue.size();
+	data.featureNum = (int)m_featureTilted.size();
+	data.stageWeakBegin = m_stageWeakBegin.empty() ? NULL : &m_stageWeakBegin[0];
+	data.stageThreshold = m_stageThreshold.empty() ? NULL : &m_stageThreshold[0];
+	data.weakNodeBegin = m_weakNodeBegin.empty() ? NULL : &m_weakNodeBegin[0];
+	data.weakLeafBegin = m_weakLeafBegin.empty() ? NULL : &m_weakLeafBegin[0];
+	data.nodeFeature = m_nodeFeature.empty() ? NULL : &m_nodeFeature[0];
+	data.nodeThreshold = m_nodeThreshold.empty() ? NULL : &m_nodeThreshold[0];
+	data.nodeLeft = m_nodeLeft.empty() ? NULL : &m_nodeLeft[0];
+	data.nodeRight = m_nodeRight.empty() ? NULL : &m_nodeRight[0];
+	data.leafValue = m_leafValue.empty() ? NULL : &m_leafValue[0];
+	for (int r = 0; r < HAAR_RECT_NUM; r++) {
+		if (data.featureNum == 0) break;
+		data.rectX[r] = &m_rect[r][0][0];
+		data.rectY[r] = &m_rect[r][1][0];
+		data.rectWidth[r] = &m_rect[r][2][0];
+		data.rectHeight[r] = &m_rect[r][3][0];
+		data.rectWeight[r] = &m_rectWeight[r][0];
+	}
+	data.featureTilted = m_featureTilted.empty() ? NULL : &m_featureTilted[0];
+	computeFlags(data);
+}
+
+bool HaarCascade_isBinary(const uint8_t *data, size_t size)
+{
+	return data != NULL && size >= HAAR_BINARY_HEADER_SIZE && memcmp(data, HAAR_BINARY_MAGIC, 4) == 0;
+}
+
+std::string HaarCascade_getBinaryPath(const char *path)
+{
+	std::string binaryPath = path;
+	size_t dot = binaryPath.find_last_of('.');
+	size_t slash = binaryPath.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) binaryPath.erase(dot);
+	return binaryPath + HAAR_BINARY_EXTENSION;
+}
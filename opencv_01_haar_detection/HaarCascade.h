@@ -0,0 +1,119 @@
+#ifndef HAAR_CASCADE_H
+#define HAAR_CASCADE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+enum { HAAR_RECT_NUM = 3 };   /* rectangles per feature (unused ones have weight 0) */
+
+/*
+ * Precompiled cascade file (.hcb, little endian), mapped and read in place without parsing
+ *   header   : "HCB1", version, windowWidth, windowHeight, stageNum, weakNum, nodeNum, leafNum, featureNum, flags, sectionNum, fileSize,
+ *              sourceSize, reserved, sourceHash (u64, FNV-1a of the XML it was compiled from)
+ *   sections : offset (u32) of every table, in HaarCascadeData order (stageWeakBegin ... featureTilted)
+ *   tables   : each aligned to HAAR_BINARY_ALIGNMENT
+ */
+#define HAAR_BINARY_MAGIC           "HCB1"
+#define HAAR_BINARY_VERSION         2
+#define HAAR_BINARY_HEADER_SIZE     64
+#define HAAR_BINARY_ALIGNMENT       64
+#define HAAR_BINARY_FLAG_STUMP_ONLY 0x1
+#define HAAR_BINARY_FLAG_TILTED     0x2
+#define HAAR_BINARY_EXTENSION       ".hcb"
+
+/*
+ * Boosted Haar cascade as flat tables (structure of arrays), the layout the evaluator reads.
+ * Weak classifiers are trees like OpenCV's: node children > 0 are node indices within the classifier, <= 0 are -(leaf index)
+ */
+typedef struct {
+	int windowWidth;
+	int windowHeight;
+	int stageNum;
+	int weakNum;
+	int nodeNum;
+	int leafNum;
+	int featureNum;
+	int isStumpOnly;                 /* every weak classifier is a single node with two leaves */
+	int hasTilted;
+	/* stages */
+	const int32_t *stageWeakBegin;   /* stageNum + 1 */
+	const float *stageThreshold;
+	/* weak classifiers */
+	const int32_t *weakNodeBegin;    /* weakNum */
+	const int32_t *weakLeafBegin;    /* weakNum */
+	/* nodes */
+	const int32_t *nodeFeature;
+	const float *nodeThreshold;
+	const int32_t *nodeLeft;
+	const int32_t *nodeRight;
+	const float *leafValue;
+	/* features: rectangle r of feature f is rectX[r][f] ... */
+	const int16_t *rectX[HAAR_RECT_NUM];
+	const int16_t *rectY[HAAR_RECT_NUM];
+	const int16_t *rectWidth[HAAR_RECT_NUM];
+	const int16_t *rectHeight[HAAR_RECT_NUM];
+	const float *rectWeight[HAAR_RECT_NUM];
+	const uint8_t *featureTilted;
+} HaarCascadeData;
+
+/*
+ * Owns the tables of a cascade read from OpenCV XML (the current format and the old haartraining one),
+ * or refers to the tables of a precompiled binary kept alive by its holder (the file / pack mapping)
+ */
+class HaarCascade
+{
+public:
+	HaarCascade();
+	/* From the resource pack if it is there. The precompiled "xxx.hcb" is used instead of "xxx.xml" when it exists
+	 * and was compiled from the current "xxx.xml" (or the XML is not there at all) */
+	bool Load(const char *path);
+	bool LoadFromMemory(const char *xml, size_t size);
+	/* Zero copy when holder keeps data alive and data is 4 byte aligned, otherwise the binary is copied */
+	bool LoadFromBinary(const uint8_t *data, size_t size, std::shared_ptr<const void> holder = std::shared_ptr<const void>());
+	bool IsEmpty() const { return m_data.stageNum == 0; }
+	const HaarCascadeData &GetData() const { return m_data; }
+	void ToBinary(std::vector<uint8_t> &binary) const;
+	bool SaveBinary(const char *path) const;
+	/* The XML this cascade was read (or its binary was compiled) from is exactly this one */
+	bool IsBuiltFrom(const uint8_t *xml, size_t size) const;
+
+	/* Building (used by the loaders). Finish fills the data view */
+	void Clear();
+	int AddFeature(const int rect[HAAR_RECT_NUM][4], const float weight[HAAR_RECT_NUM], bool isTilted);
+	void BeginStage();
+	void AddWeak(const std::vector<int32_t> &nodeFeature, const std::vector<float> &nodeThreshold,
+		const std::vector<int32_t> &nodeLeft, const std::vector<int32_t> &nodeRight, const std::vector<float> &leafValue);
+	void EndStage(float threshold);
+	void Finish(int windowWidth, int windowHeight);
+
+private:
+	HaarCascade(const HaarCascade&);
+	HaarCascade& operator=(const HaarCascade&);
+
+private:
+	HaarCascadeData m_data;
+	std::vector<int32_t> m_stageWeakBegin;
+	std::vector<float> m_stageThreshold;
+	std::vector<int32_t> m_weakNodeBegin;
+	std::vector<int32_t> m_weakLeafBegin;
+	std::vector<int32_t> m_nodeFeature;
+	std::vector<float> m_nodeThreshold;
+	std::vector<int32_t> m_nodeLeft;
+	std::vector<int32_t> m_nodeRight;
+	std::vector<float> m_leafValue;
+	std::vector<int16_t> m_rect[HAAR_RECT_NUM][4];
+	std::vector<float> m_rectWeight[HAAR_RECT_NUM];
+	std::vector<uint8_t> m_featureTilted;
+	std::shared_ptr<const void> m_binaryHolder;   /* the tables are in here when loaded from a binary */
+	uint32_t m_sourceSize;                        /* size and hash of the source XML (0 if unknown) */
+	uint64_t m_sourceHash;
+};
+
+bool HaarCascade_isBinary(const uint8_t *data, size_t size);
+/* "xxx.xml" -> "xxx.hcb" */
+std::string HaarCascade_getBinaryPath(const char *path);
+
+#endif
@@ -0,0 +1,63 @@
+/*** Include ***/
+/* for general */
+#include <stdio.h>
+#include <vector>
+#include <string>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "ResourcePack.h"
+#include "HaarDetector.h"
+
+/*** Macro ***/
+
+/*** Global variables ***/
+
+/*** Functions ***/
+void HaarDetector_getDefaultConfig(HaarDetectorConfig *config)
+{
+	config->cascadePath = "resource/rpalm.xml";
+	config->scaleFactor = 1.1f;
+	config->minNeighbors = 8;
+	config->minSize = 30;
+}
+
+bool HaarDetector_loadCascade(cv::CascadeClassifier &cascade, const char *path)
+{
+	ResourceView view;
+	if (Resource_isInPack(path) && Resource_read(path, &view)) {
+		cv::FileStorage fs(std::string((const char*)view.data, view.size), cv::FileStorage::READ | cv::FileStorage::MEMORY);
+		if (fs.isOpened() && cascade.read(fs.getFirstTopLevelNode())) return true;
+	}
+	return cascade.load(path);
+}
+
+HaarDetector::HaarDetector(const HaarDetectorConfig &haarConfig, const DetectorConfig &config)
+	: Detector(config), m_haarConfig(haarConfig), m_scaleFactor(haarConfig.scaleFactor)
+{
+	m_cascades.resize(GetConfig().workerNum);
+}
+
+HaarDetector::~HaarDetector()
+{
+	Stop();
+}
+
+bool HaarDetector::CreateWorker(int workerIndex)
+{
+	if (!HaarDetector_loadCascade(m_cascades[workerIndex], m_haarConfig.cascadePath)) {
+		printf("failed to load %s\n", m_haarConfig.cascadePath);
+		return false;
+	}
+	return true;
+}
+
+void HaarDetector::DetectBatch(int workerIndex, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &results)
+{
+	cv::CascadeClassifier &cascade = m_cascades[workerIndex];
+	cv::Size minSize(m_haarConfig.minSize, m_haarConfig.minSize);
+	for (size_t i = 0; i < images.size(); i++) {
+		cascade.detectMultiScale(images[i], results[i], m_scaleFactor, m_haarConfig.minNeighbors, cv::CASCADE_SCALE_IMAGE, minSize);
+	}
+}
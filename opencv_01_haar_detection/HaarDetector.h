@@ -0,0 +1,43 @@
+#ifndef HAAR_DETECTOR_H
+#define HAAR_DETECTOR_H
+
+#include <vector>
+#include <string>
+#include <atomic>
+
+#include <opencv2/opencv.hpp>
+
+#include "Detector.h"
+
+typedef struct {
+	const char *cascadePath;   /* from the resource pack if it is there */
+	float scaleFactor;
+	int minNeighbors;
+	int minSize;               /* in detection image pixels */
+} HaarDetectorConfig;
+
+void HaarDetector_getDefaultConfig(HaarDetectorConfig *config);
+/* Packed cascades are already converted to the new format, so they are parsed from memory */
+bool HaarDetector_loadCascade(cv::CascadeClassifier &cascade, const char *path);
+
+/* OpenCV cascade classifier backend. One classifier per worker (they are not shared safely across threads); a batch is run image by image */
+class HaarDetector : public Detector
+{
+public:
+	HaarDetector(const HaarDetectorConfig &haarConfig, const DetectorConfig &config);
+	~HaarDetector();
+	std::string GetName() const { return "haar"; }
+	/* can be changed while running */
+	void SetScaleFactor(float scaleFactor) { m_scaleFactor = scaleFactor; }
+
+protected:
+	bool CreateWorker(int workerIndex);
+	void DetectBatch(int workerIndex, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &results);
+
+private:
+	HaarDetectorConfig m_haarConfig;
+	std::vector<cv::CascadeClassifier> m_cascades;
+	std::atomic<float> m_scaleFactor;
+};
+
+#endif
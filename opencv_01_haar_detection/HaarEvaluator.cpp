@@ -0,0 +1,382 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+#include "WorkStealingPool.h"
+#include "HaarEvaluator.h"
+
+/*** Macro ***/
+/* Settings */
+#define MIN_NORM_STDDEV_RATIO 0.1   /* windows flatter than this are rejected before the first stage (as cv::CascadeClassifier) */
+#define LANE_NUM 4
+
+enum {
+	WINDOW_PASSED,
+	WINDOW_REJECTED_FIRST,   /* by the first stage */
+	WINDOW_REJECTED,
+};
+
+/*** Global variables ***/
+
+/*** Functions ***/
+HaarPyramid::HaarPyramid()
+	: m_levelNum(0), m_stride(0)
+{
+}
+
+void HaarPyramid::Build(const cv::Mat &gray, float scaleFactor, cv::Size minWindow, bool isTilted, WorkStealingPool *pool)
+{
+	m_imageSize = cv::Size(gray.cols, gray.rows);
+	m_stride = gray.cols + 1;
+	m_levelNum = 0;
+	if (scaleFactor <= 1.0f) scaleFactor = 1.1f;
+
+	/* Sizes first (the same rounding as cv::CascadeClassifier), then the buffers, then the contents */
+	std::vector<float> factors;
+	for (double factor = 1.0; ; factor *= scaleFactor) {
+		float levelFactor = (float)factor;
+		cv::Size size(cvRound(gray.cols / (double)levelFactor), cvRound(gray.rows / (double)levelFactor));
+		if (size.width < minWindow.width || size.height < minWindow.height) break;
+		factors.push_back(levelFactor);
+	}
+	m_levelNum = (int)factors.size();
+	if ((int)m_levels.size() < m_levelNum) {
+		m_levels.resize(m_levelNum);
+		m_sumBuffers.resize(m_levelNum);
+		m_sqsumBuffers.resize(m_levelNum);
+		m_tiltedBuffers.resize(m_levelNum);
+	}
+	for (int i = 0; i < m_levelNum; i++) {
+		HaarLevel &level = m_levels[i];
+		level.factor = factors[i];
+		cv::Size size(cvRound(gray.cols / (double)factors[i]), cvRound(gray.rows / (double)factors[i]));
+		/* same stride for every level: buffers are (height + 1) x stride, the integral images are ROIs of them */
+		if (m_sumBuffers[i].cols != m_stride || m_sumBuffers[i].rows < size.height + 1) {
+			m_sumBuffers[i].create(size.height + 1, m_stride, CV_32S);
+			m_sqsumBuffers[i].create(size.height + 1, m_stride, CV_64F);
+		}
+		if (isTilted && (m_tiltedBuffers[i].cols != m_stride || m_tiltedBuffers[i].rows < size.height + 1)) {
+			m_tiltedBuffers[i].create(size.height + 1, m_stride, CV_32S);
+		}
+		cv::Rect roi(0, 0, size.width + 1, size.height + 1);
+		level.sum = m_sumBuffers[i](roi);
+		level.sqsum = m_sqsumBuffers[i](roi);
+		level.tilted = isTilted ? m_tiltedBuffers[i](roi) : cv::Mat();
+	}
+
+	std::function<void(int)> buildLevel = [this, &gray, isTilted](int i) {
+		HaarLevel &level = m_levels[i];
+		cv::Size size(level.sum.cols - 1, level.sum.rows - 1);
+		if (i == 0) {
+			level.image = gray;
+		} else {
+			cv::resize(gray, level.image, size, 0, 0, cv::INTER_LINEAR_EXACT);
+		}
+		/* sizes and types match, so the integral images are written in place (keeping the common stride) */
+		if (isTilted) {
+			cv::integral(level.image, level.sum, level.sqsum, level.tilted, CV_32S, CV_64F);
+		} else {
+			cv::integral(level.image, level.sum, level.sqsum, CV_32S, CV_64F);
+		}
+	};
+	if (pool) {
+		pool->ParallelFor(m_levelNum, buildLevel);
+	} else {
+		for (int i = 0; i < m_levelNum; i++) buildLevel(i);
+	}
+}
+
+HaarEvaluator::HaarEvaluator(const HaarCascadeData *cascade)
+	: m_cascade(NULL), m_stride(0), m_normArea(1)
+{
+	SetCascade(cascade);
+}
+
+void HaarEvaluator::SetCascade(const HaarCascadeData *cascade)
+{
+	m_cascade = cascade;
+	m_stride = 0;
+	m_features.clear();
+	m_stumps.clear();
+	if (cascade == NULL) return;
+	m_normArea = (double)(cascade->windowWidth - 2) * (cascade->windowHeight - 2);
+	if (cascade->isStumpOnly) {
+		/* node i belongs to weak classifier i, leaves 2i and 2i + 1 */
+		m_stumps.resize(cascade->weakNum);
+		for (int w = 0; w < cascade->weakNum; w++) {
+			int node = cascade->weakNodeBegin[w];
+			int leaf = cascade->weakLeafBegin[w];
+			m_stumps[w].feature = cascade->nodeFeature[node];
+			m_stumps[w].threshold = cascade->nodeThreshold[node];
+			m_stumps[w].leaf[0] = cascade->leafValue[leaf];
+			m_stumps[w].leaf[1] = cascade->leafValue[leaf + 1];
+		}
+	}
+}
+
+cv::Size HaarEvaluator::GetWindowSize() const
+{
+	return m_cascade ? cv::Size(m_cascade->windowWidth, m_cascade->windowHeight) : cv::Size();
+}
+
+void HaarEvaluator::Prepare(const HaarPyramid &pyramid)
+{
+	int stride = pyramid.GetStride();
+	if (m_cascade == NULL || stride == m_stride) return;
+	m_stride = stride;
+	const HaarCascadeData &cascade = *m_cascade;
+	m_features.resize(cascade.featureNum);
+	for (int f = 0; f < cascade.featureNum; f++) {
+		Feature &feature = m_features[f];
+		feature.isTilted = cascade.featureTilted[f];
+		for (int r = 0; r < HAAR_RECT_NUM; r++) {
+			int x = cascade.rectX[r][f];
+			int y = cascade.rectY[r][f];
+			int w = cascade.rectWidth[r][f];
+			int h = cascade.rectHeight[r][f];
+			feature.weight[r] = cascade.rectWeight[r][f];
+			if (feature.weight[r] == 0.0f) {
+				for (int i = 0; i < 4; i++) feature.offset[r][i] = 0;
+			} else if (feature.isTilted) {
+				/* (x, y), (x - h, y + h), (x + w, y + w), (x + w - h, y + w + h) of the tilted sums */
+				feature.offset[r][0] = x + stride * y;
+				feature.offset[r][1] = x - h + stride * (y + h);
+				feature.offset[r][2] = x + w + stride * (y + w);
+				feature.offset[r][3] = x + w - h + stride * (y + w + h);
+			} else {
+				feature.offset[r][0] = x + stride * y;
+				feature.offset[r][1] = x + w + stride * y;
+				feature.offset[r][2] = x + stride * (y + h);
+				feature.offset[r][3] = x + w + stride * (y + h);
+			}
+		}
+	}
+	/* variance is taken inside a one pixel border */
+	int normWidth = cascade.windowWidth - 2;
+	int normHeight = cascade.windowHeight - 2;
+	m_normOffset[0] = 1 + stride * 1;
+	m_normOffset[1] = 1 + normWidth + stride * 1;
+	m_normOffset[2] = 1 + stride * (1 + normHeight);
+	m_normOffset[3] = 1 + normWidth + stride * (1 + normHeight);
+}
+
+bool HaarEvaluator::IsInSizeRange(const HaarLevel &level, cv::Size minSize, cv::Size maxSize) const
+{
+	cv::Size windowSize(cvRound(m_cascade->windowWidth * level.factor), cvRound(m_cascade->windowHeight * level.factor));
+	if (windowSize.width < minSize.width || windowSize.height < minSize.height) return false;
+	if (maxSize.width > 0 && maxSize.height > 0 && (windowSize.width > maxSize.width || windowSize.height > maxSize.height)) return false;
+	return true;
+}
+
+int HaarEvaluator::GetScanHeight(const HaarPyramid &pyramid, int levelIndex, cv::Size minSize, cv::Size maxSize) const
+{
+	if (m_cascade == NULL) return 0;
+	const HaarLevel &level = pyramid.GetLevel(levelIndex);
+	if (!IsInSizeRange(level, minSize, maxSize)) return 0;
+	int scanWidth = level.sum.cols - m_cascade->windowWidth;
+	int scanHeight = level.sum.rows - m_cascade->windowHeight;
+	if (scanWidth <= 0 || scanHeight <= 0) return 0;
+
+	/* cv::CascadeClassifier cuts every level into as many stripes as the first level has 32 pixel columns and rounds
+	 * the rows per stripe down, which sometimes leaves out the last row. Done the same to give identical results */
+	int stripeNum = 1;
+	for (int l = 0; l <= levelIndex; l++) {
+		if (!IsInSizeRange(pyramid.GetLevel(l), minSize, maxSize)) continue;
+		stripeNum = std::max((pyramid.GetLevel(l).sum.cols - m_cascade->windowWidth + 31) / 32, 1);
+		break;
+	}
+	int step = GetScanStep(pyramid, levelIndex);
+	int stripeHeight = std::max((scanHeight / step + stripeNum - 1) / stripeNum, 1) * step;
+	return std::min(scanHeight, stripeHeight * stripeNum);
+}
+
+int HaarEvaluator::GetScanStep(const HaarPyramid &pyramid, int levelIndex) const
+{
+	return (pyramid.GetLevel(levelIndex).factor >= 2.0f) ? 1 : 2;
+}
+
+bool HaarEvaluator::GetVarianceNormFactor(const int *sum, const double *sqsum, float *varianceNormFactor) const
+{
+	const int32_t *n = m_normOffset;
+	int valueSum = sum[n[0]] - sum[n[1]] - sum[n[2]] + sum[n[3]];
+	double valueSqsum = sqsum[n[0]] - sqsum[n[1]] - sqsum[n[2]] + sqsum[n[3]];
+	double normFactor = m_normArea * valueSqsum - (double)valueSum * valueSum;
+	if (normFactor <= 0.0) return false;
+	*varianceNormFactor = (float)(1.0 / sqrt(normFactor));
+	return m_normArea * *varianceNormFactor < MIN_NORM_STDDEV_RATIO;
+}
+
+static inline float calcFeature(const int *sum, const int *tilted, const int32_t offset[HAAR_RECT_NUM][4], const float weight[HAAR_RECT_NUM], int isTilted)
+{
+	const int *p = isTilted ? tilted : sum;
+	float value = weight[0] * (p[offset[0][0]] - p[offset[0][1]] - p[offset[0][2]] + p[offset[0][3]])
+		+ weight[1] * (p[offset[1][0]] - p[offset[1][1]] - p[offset[1][2]] + p[offset[1][3]]);
+	if (weight[2] != 0.0f) value += weight[2] * (p[offset[2][0]] - p[offset[2][1]] - p[offset[2][2]] + p[offset[2][3]]);
+	return value;
+}
+
+int HaarEvaluator::EvaluateWindow(const HaarLevel &level, int x, int y) const
+{
+	size_t windowOffset = (size_t)y * m_stride + x;
+	const int *sum = (const int*)level.sum.data + windowOffset;
+	const double *sqsum = (const double*)level.sqsum.data + windowOffset;
+	const int *tilted = level.tilted.empty() ? NULL : (const int*)level.tilted.data + windowOffset;
+	float varianceNormFactor;
+	if (!GetVarianceNormFactor(sum, sqsum, &varianceNormFactor)) return WINDOW_REJECTED;
+
+	const HaarCascadeData &cascade = *m_cascade;
+	for (int s = 0; s < cascade.stageNum; s++) {
+		float stageSum = 0.0f;
+		if (cascade.isStumpOnly) {
+			for (int w = cascade.stageWeakBegin[s]; w < cascade.stageWeakBegin[s + 1]; w++) {
+				const Stump &stump = m_stumps[w];
+				const Feature &feature = m_features[stump.feature];
+				float value = calcFeature(sum, tilted, feature.offset, feature.weight, feature.isTilted) * varianceNormFactor;
+				stageSum += stump.leaf[value < stump.threshold ? 0 : 1];
+			}
+		} else {
+			for (int w = cascade.stageWeakBegin[s]; w < cascade.stageWeakBegin[s + 1]; w++) {
+				const int nodeBegin = cascade.weakNodeBegin[w];
+				int index = 0;
+				do {
+					int node = nodeBegin + index;
+					const Feature &feature = m_features[cascade.nodeFeature[node]];
+					float value = calcFeature(sum, tilted, feature.offset, feature.weight, feature.isTilted) * varianceNormFactor;
+					index = (value < cascade.nodeThreshold[node]) ? cascade.nodeLeft[node] : cascade.nodeRight[node];
+				} while (index > 0);
+				stageSum += cascade.leafValue[cascade.weakLeafBegin[w] - index];
+			}
+		}
+		if (stageSum < cascade.stageThreshold[s]) return (s == 0) ? WINDOW_REJECTED_FIRST : WINDOW_REJECTED;
+	}
+	return WINDOW_PASSED;
+}
+
+#ifdef USE_SSE2
+/* Values at p, p + step, p + 2 step, p + 3 step (step 1 or 2) */
+static inline __m128i load4(const int *p, int step)
+{
+	if (step == 1) return _mm_loadu_si128((const __m128i*)p);
+	/* p[0..3] and p[3..6]: nothing past the last window is read (it may be the end of the buffer) */
+	__m128 low = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)p));
+	__m128 high = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(p + 3)));
+	return _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+static inline __m128 calcRect4(const int *p, const int32_t offset[4], int step)
+{
+	/* integer arithmetic wraps like the scalar one, then to float */
+	__m128i value = _mm_sub_epi32(load4(p + offset[0], step), load4(p + offset[1], step));
+	value = _mm_sub_epi32(value, load4(p + offset[2], step));
+	value = _mm_add_epi32(value, load4(p + offset[3], step));
+	return _mm_cvtepi32_ps(value);
+}
+#endif
+
+void HaarEvaluator::ScanRow(const HaarLevel &level, int y, int width, int step, std::vector<int> &hits) const
+{
+	/* as cv::CascadeClassifier, the window after one rejected by the first stage is not evaluated */
+	bool isSkipped = false;
+	int x = 0;
+#ifdef USE_SSE2
+	if (m_cascade->isStumpOnly) {
+		const HaarCascadeData &cascade = *m_cascade;
+		for (; x + (LANE_NUM - 1) * step < width; x += LANE_NUM * step) {
+			size_t windowOffset = (size_t)y * m_stride + x;
+			const int *sum = (const int*)level.sum.data + windowOffset;
+			const double *sqsum = (const double*)level.sqsum.data + windowOffset;
+			const int *tilted = level.tilted.empty() ? NULL : (const int*)level.tilted.data + windowOffset;
+
+			/* normalization per lane (rejected lanes keep a factor of 0) */
+			float normFactors[LANE_NUM];
+			int laneMask = 0;
+			for (int i = 0; i < LANE_NUM; i++) {
+				normFactors[i] = 0.0f;
+				if (GetVarianceNormFactor(sum + i * step, sqsum + i * step, &normFactors[i])) laneMask |= 1 << i;
+			}
+			if (laneMask == 0) {
+				isSkipped = false;
+				continue;
+			}
+			int firstRejectedMask = 0;
+			__m128 normFactor = _mm_loadu_ps(normFactors);
+			__m128 active = _mm_castsi128_ps(_mm_setr_epi32((laneMask & 1) ? -1 : 0, (laneMask & 2) ? -1 : 0, (laneMask & 4) ? -1 : 0, (laneMask & 8) ? -1 : 0));
+
+			for (int s = 0; s < cascade.stageNum && laneMask; s++) {
+				__m128 stageSum = _mm_setzero_ps();
+				for (int w = cascade.stageWeakBegin[s]; w < cascade.stageWeakBegin[s + 1]; w++) {
+					const Stump &stump = m_stumps[w];
+					const Feature &feature = m_features[stump.feature];
+					const int *p = feature.isTilted ? tilted : sum;
+					__m128 value = _mm_mul_ps(_mm_set1_ps(feature.weight[0]), calcRect4(p, feature.offset[0], step));
+					value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(feature.weight[1]), calcRect4(p, feature.offset[1], step)));
+					if (feature.weight[2] != 0.0f) value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(feature.weight[2]), calcRect4(p, feature.offset[2], step)));
+					value = _mm_mul_ps(value, normFactor);
+					__m128 isLeft = _mm_cmplt_ps(value, _mm_set1_ps(stump.threshold));
+					__m128 leaf = _mm_or_ps(_mm_and_ps(isLeft, _mm_set1_ps(stump.leaf[0])), _mm_andnot_ps(isLeft, _mm_set1_ps(stump.leaf[1])));
+					stageSum = _mm_add_ps(stageSum, leaf);
+				}
+				active = _mm_and_ps(active, _mm_cmpge_ps(stageSum, _mm_set1_ps(cascade.stageThreshold[s])));
+				int passedMask = _mm_movemask_ps(active);
+				if (s == 0) firstRejectedMask = laneMask & ~passedMask;
+				laneMask = passedMask;
+			}
+			/* all four lanes were evaluated; the skip is applied afterwards, in window order */
+			for (int i = 0; i < LANE_NUM; i++) {
+				if (isSkipped) {
+					isSkipped = false;
+					continue;
+				}
+				if (laneMask & (1 << i)) hits.push_back(x + i * step);
+				isSkipped = (firstRejectedMask & (1 << i)) != 0;
+			}
+		}
+	}
+#endif
+	for (; x < width; x += step) {
+		if (isSkipped) {
+			isSkipped = false;
+			continue;
+		}
+		int result = EvaluateWindow(level, x, y);
+		if (result == WINDOW_PASSED) hits.push_back(x);
+		isSkipped = (result == WINDOW_REJECTED_FIRST);
+	}
+}
+
+void HaarEvaluator::Scan(const HaarPyramid &pyramid, int levelIndex, int yBegin, int yEnd, std::vector<cv::Rect> &objects) const
+{
+	if (m_cascade == NULL || m_stride != pyramid.GetStride()) return;
+	const HaarLevel &level = pyramid.GetLevel(levelIndex);
+	int scanWidth = level.sum.cols - m_cascade->windowWidth;
+	int scanHeight = level.sum.rows - m_cascade->windowHeight;
+	if (scanWidth <= 0 || scanHeight <= 0) return;
+	int step = GetScanStep(pyramid, levelIndex);
+	cv::Size windowSize(cvRound(m_cascade->windowWidth * level.factor), cvRound(m_cascade->windowHeight * level.factor));
+	cv::Size imageSize = pyramid.GetImageSize();
+	yEnd = std::min(yEnd, scanHeight);
+	std::vector<int> hits;
+	for (int y = (yBegin + step - 1) / step * step; y < yEnd; y += step) {
+		hits.clear();
+		ScanRow(level, y, scanWidth, step, hits);
+		for (size_t i = 0; i < hits.size(); i++) {
+			/* clipped to the image like cv::CascadeClassifier (the scaled window may stick out by rounding) */
+			cv::Rect object(cvRound(hits[i] * level.factor), cvRound(y * level.factor), windowSize.width, windowSize.height);
+			object.width = std::min(object.width, imageSize.width - object.x);
+			object.height = std::min(object.height, imageSize.height - object.y);
+			objects.push_back(object);
+		}
+	}
+}
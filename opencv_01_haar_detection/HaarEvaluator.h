@@ -0,0 +1,93 @@
+#ifndef HAAR_EVALUATOR_H
+#define HAAR_EVALUATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "HaarCascade.h"
+
+class WorkStealingPool;
+
+/* One scale of the pyramid: the downscaled image and its integral images */
+typedef struct {
+	float factor;            /* source size / level size */
+	cv::Mat image;
+	cv::Mat sum;             /* CV_32S, (height + 1) x (width + 1) */
+	cv::Mat sqsum;           /* CV_64F */
+	cv::Mat tilted;          /* CV_32S, 45 degree rotated sums. Empty unless built with tilted */
+} HaarLevel;
+
+/*
+ * Scale pyramid with integral / squared integral (/ tilted) images, built once per frame and scanned by any number of cascades.
+ * Every level's integral images share one row stride, so feature offsets are computed once per image size
+ */
+class HaarPyramid
+{
+public:
+	HaarPyramid();
+	/* Levels from factor 1 while the level still holds minWindow. pool (optional) builds levels in parallel */
+	void Build(const cv::Mat &gray, float scaleFactor, cv::Size minWindow, bool isTilted, WorkStealingPool *pool = NULL);
+	int GetLevelNum() const { return m_levelNum; }
+	const HaarLevel &GetLevel(int index) const { return m_levels[index]; }
+	cv::Size GetImageSize() const { return m_imageSize; }
+	int GetStride() const { return m_stride; }   /* in elements, of every integral image */
+
+private:
+	std::vector<HaarLevel> m_levels;   /* buffers are kept for the next frame */
+	std::vector<cv::Mat> m_sumBuffers;
+	std::vector<cv::Mat> m_sqsumBuffers;
+	std::vector<cv::Mat> m_tiltedBuffers;
+	int m_levelNum;
+	cv::Size m_imageSize;
+	int m_stride;
+};
+
+/*
+ * Runs one cascade over pyramid levels, like cv::CascadeClassifier (same window steps, variance normalization and rejection).
+ * Stump cascades are evaluated on 4 neighbouring windows at once with SSE2 (all four leave a stage only when every lane is rejected).
+ * Read only while scanning, so one evaluator per cascade can serve every thread
+ */
+class HaarEvaluator
+{
+public:
+	explicit HaarEvaluator(const HaarCascadeData *cascade = NULL);
+	void SetCascade(const HaarCascadeData *cascade);
+	cv::Size GetWindowSize() const;
+	/* Window rows to scan on a level (0 if the window doesn't fit or is outside the object size range) */
+	int GetScanHeight(const HaarPyramid &pyramid, int levelIndex, cv::Size minSize, cv::Size maxSize) const;
+	int GetScanStep(const HaarPyramid &pyramid, int levelIndex) const;
+	/* Feature offsets for the pyramid's stride. Call before scanning a new image size, then Scan may run from several threads */
+	void Prepare(const HaarPyramid &pyramid);
+	/* Windows whose top is in [yBegin, yEnd) of the level. Hits are appended in source image coordinates */
+	void Scan(const HaarPyramid &pyramid, int levelIndex, int yBegin, int yEnd, std::vector<cv::Rect> &objects) const;
+
+private:
+	typedef struct {
+		int32_t offset[HAAR_RECT_NUM][4];   /* corners in the sum (or tilted) image, relative to the window */
+		float weight[HAAR_RECT_NUM];
+		int isTilted;
+	} Feature;
+
+	typedef struct {
+		int32_t feature;
+		float threshold;
+		float leaf[2];
+	} Stump;
+
+	bool IsInSizeRange(const HaarLevel &level, cv::Size minSize, cv::Size maxSize) const;
+	int EvaluateWindow(const HaarLevel &level, int x, int y) const;
+	bool GetVarianceNormFactor(const int *sum, const double *sqsum, float *varianceNormFactor) const;
+	void ScanRow(const HaarLevel &level, int y, int width, int step, std::vector<int> &hits) const;
+
+private:
+	const HaarCascadeData *m_cascade;
+	int m_stride;
+	std::vector<Feature> m_features;
+	std::vector<Stump> m_stumps;
+	int32_t m_normOffset[4];
+	double m_normArea;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/* for GL */
+#include <GL/glew.h>
+#ifdef HEADLESS_USE_OSMESA
+#include <GL/osmesa.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "HeadlessContext.h"
+
+/*** Macro ***/
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+/*** Functions ***/
+HeadlessContext::HeadlessContext()
+	: m_display(NULL), m_context(NULL), m_isDisplayOwner(false)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	Finalize();
+}
+
+#ifdef HEADLESS_USE_OSMESA
+bool HeadlessContext::Initialize(const HeadlessContext *shareContext)
+{
+	Finalize();
+	const int attributes[] = {
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_DEPTH_BITS, 24,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 3,
+		OSMESA_CONTEXT_MINOR_VERSION, 3,
+		0
+	};
+	OSMesaContext context = OSMesaCreateContextAttribs(attributes, shareContext ? (OSMesaContext)shareContext->m_context : NULL);
+	if (context == NULL) {
+		printf("Impossible to create an OSMesa context\n");
+		return false;
+	}
+	m_context = context;
+	m_buffer.resize(4);
+	return true;
+}
+
+void HeadlessContext::Finalize()
+{
+	if (m_context) OSMesaDestroyContext((OSMesaContext)m_context);
+	m_context = NULL;
+	m_buffer.clear();
+}
+
+bool HeadlessContext::MakeCurrent()
+{
+	return m_context && OSMesaMakeCurrent((OSMesaContext)m_context, &m_buffer[0], GL_UNSIGNED_BYTE, 1, 1);
+}
+
+void HeadlessContext::ReleaseCurrent()
+{
+	OSMesaMakeCurrent(NULL, NULL, GL_UNSIGNED_BYTE, 0, 0);
+}
+
+#else
+bool HeadlessContext::Initialize(const HeadlessContext *shareContext)
+{
+	Finalize();
+	EGLDisplay display = EGL_NO_DISPLAY;
+	if (shareContext) {
+		display = shareContext->m_display;
+	} else {
+		/* surfaceless: no X, Wayland or GBM device. eglGetDisplay picks a platform itself otherwise */
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+			printf("Impossible to initialize EGL\n");
+			return false;
+		}
+		m_isDisplayOwner = true;
+	}
+	m_display = display;
+
+	const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (extensions == NULL || strstr(extensions, "EGL_KHR_surfaceless_context") == NULL) {
+		printf("EGL_KHR_surfaceless_context is not supported\n");
+		Finalize();
+		return false;
+	}
+	/* no surface is ever made: any config that renders desktop GL, or none at all if the driver allows it */
+	const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = NULL;
+	EGLint configNum = 0;
+	if ((!eglChooseConfig(display, configAttributes, &config, 1, &configNum) || configNum == 0) && strstr(extensions, "EGL_KHR_no_config_context") == NULL) {
+		printf("No EGL config for OpenGL\n");
+		Finalize();
+		return false;
+	}
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	eglBindAPI(EGL_OPENGL_API);
+	EGLContext context = eglCreateContext(display, configNum > 0 ? config : (EGLConfig)0, shareContext ? (EGLContext)shareContext->m_context : EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT) {
+		printf("Impossible to create an OpenGL 3.3 context (EGL error 0x%04X)\n", eglGetError());
+		Finalize();
+		return false;
+	}
+	m_context = context;
+	return true;
+}
+
+void HeadlessContext::Finalize()
+{
+	/* contexts sharing with this one are finalized first (the display goes with the first context) */
+	if (m_context) eglDestroyContext((EGLDisplay)m_display, (EGLContext)m_context);
+	if (m_isDisplayOwner) eglTerminate((EGLDisplay)m_display);
+	m_context = NULL;
+	m_display = NULL;
+	m_isDisplayOwner = false;
+}
+
+bool HeadlessContext::MakeCurrent()
+{
+	/* the API is per thread */
+	eglBindAPI(EGL_OPENGL_API);
+	return m_context && eglMakeCurrent((EGLDisplay)m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)m_context);
+}
+
+void HeadlessContext::ReleaseCurrent()
+{
+	if (m_display) eglMakeCurrent((EGLDisplay)m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+#endif
+
+bool HeadlessContext::InitializeGl()
+{
+	glewExperimental = true;
+	GLenum result = glewInit();
+	/* A GLEW built for GLX loads the GL entry points, then finds no GLX display, which isn't needed here */
+	if (result != GLEW_OK && result != GLEW_ERROR_NO_GLX_DISPLAY) {
+		printf("Impossible to initialize GLEW: %s\n", (const char*)glewGetErrorString(result));
+		return false;
+	}
+	/* glewInit may leave an error of the core profile behind */
+	while (glGetError() != GL_NO_ERROR) {}
+	printf("OpenGL %s (%s)\n", (const char*)glGetString(GL_VERSION), (const char*)glGetString(GL_RENDERER));
+	return true;
+}
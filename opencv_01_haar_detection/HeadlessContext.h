@@ -0,0 +1,40 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * OpenGL 3.3 core context without a window or a display server, to render into framebuffer objects.
+ * EGL on Mesa's surfaceless platform (llvmpipe on a machine without GPU, the GPU's render node otherwise),
+ * or OSMesa when built with HEADLESS_USE_OSMESA.
+ * A context created with a share context sees its buffers, textures and programs (not its VAOs and FBOs).
+ * Current on one thread at a time
+ */
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+	bool Initialize(const HeadlessContext *shareContext = NULL);
+	void Finalize();
+	/* Calling thread */
+	bool MakeCurrent();
+	void ReleaseCurrent();
+	/* Once per process, with a context current: GL entry points (GLEW) */
+	static bool InitializeGl();
+
+private:
+	HeadlessContext(const HeadlessContext&);
+	HeadlessContext& operator=(const HeadlessContext&);
+
+private:
+	void *m_display;         /* EGLDisplay (shared by every context) */
+	void *m_context;         /* EGLContext / OSMesaContext */
+	bool m_isDisplayOwner;   /* the first context initialized the display and terminates it */
+#ifdef HEADLESS_USE_OSMESA
+	std::vector<uint8_t> m_buffer;   /* OSMesa needs a color buffer to make a context current. Unused: FBOs are drawn */
+#endif
+};
+
+#endif
@@ -0,0 +1,291 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "ResourcePack.h"
+#include "ImageDecoder.h"
+
+/*** Macro ***/
+#define BMP_FILE_HEADER_SIZE 14
+#define BMP_INFO_HEADER_SIZE 40
+#define BI_RGB            0
+#define BI_RLE8           1
+#define BI_RLE4           2
+#define BI_BITFIELDS      3
+#define BI_ALPHABITFIELDS 6
+
+/*** Functions ***/
+static inline uint32_t readU32(const uint8_t *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint16_t readU16(const uint8_t *p)
+{
+	uint16_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/* Channel described by a bit mask, scaled to 8 bits */
+typedef struct {
+	uint32_t mask;
+	int shift;
+	int bits;
+} BitField;
+
+static BitField makeBitField(uint32_t mask)
+{
+	BitField field = { mask, 0, 0 };
+	if (mask == 0) return field;
+	while (((mask >> field.shift) & 1) == 0) field.shift++;
+	while (field.shift + field.bits < 32 && ((mask >> (field.shift + field.bits)) & 1)) field.bits++;
+	return field;
+}
+
+static inline uint8_t extractBitField(const BitField &field, uint32_t pixel, uint8_t defaultValue)
+{
+	if (field.bits == 0) return defaultValue;
+	uint32_t value = (pixel & field.mask) >> field.shift;
+	if (field.bits >= 8) return (uint8_t)(value >> (field.bits - 8));
+	return (uint8_t)(value * 255 / ((1u << field.bits) - 1));
+}
+
+static inline void setPalettePixel(uint8_t *dst, const uint8_t *palette, int paletteNum, int index)
+{
+	if (index >= paletteNum) index = 0;
+	dst[0] = palette[index * 4 + 2];
+	dst[1] = palette[index * 4 + 1];
+	dst[2] = palette[index * 4 + 0];
+	dst[3] = 255;
+}
+
+/* RLE4 / RLE8 (always bottom-up). Returns false on a malformed stream */
+static bool decodeRLE(const uint8_t *src, const uint8_t *end, bool isRle4, const uint8_t *palette, int paletteNum, Image *image)
+{
+	int x = 0;
+	int y = 0;
+	while (src + 2 <= end) {
+		int count = src[0];
+		int value = src[1];
+		src += 2;
+		if (count > 0) {
+			/* encoded run */
+			for (int i = 0; i < count && x < image->width; i++, x++) {
+				int index = isRle4 ? ((i & 1) ? (value & 0x0F) : (value >> 4)) : value;
+				if (y < image->height) setPalettePixel(&image->rgba[((size_t)y * image->width + x) * 4], palette, paletteNum, index);
+			}
+		} else if (value == 0) {
+			/* end of line */
+			x = 0;
+			y++;
+		} else if (value == 1) {
+			/* end of bitmap */
+			return true;
+		} else if (value == 2) {
+			/* delta */
+			if (src + 2 > end) return false;
+			x += src[0];
+			y += src[1];
+			src += 2;
+		} else {
+			/* absolute run of value pixels, padded to 16 bits */
+			int byteNum = isRle4 ? (value + 1) / 2 : value;
+			if (src + byteNum > end) return false;
+			for (int i = 0; i < value; i++, x++) {
+				int index = isRle4 ? ((i & 1) ? (src[i / 2] & 0x0F) : (src[i / 2] >> 4)) : src[i];
+				if (x < image->width && y < image->height) setPalettePixel(&image->rgba[((size_t)y * image->width + x) * 4], palette, paletteNum, index);
+			}
+			src += (byteNum + 1) & ~1;
+		}
+	}
+	/* Some encoders omit the end of bitmap marker */
+	return true;
+}
+
+bool ImageDecoder_decodeBMP(const uint8_t *data, size_t size, Image *image)
+{
+	if (size < BMP_FILE_HEADER_SIZE + BMP_INFO_HEADER_SIZE || data[0] != 'B' || data[1] != 'M') {
+		printf("Not a correct BMP file\n");
+		return false;
+	}
+	const uint8_t *info = data + BMP_FILE_HEADER_SIZE;
+	uint32_t dataPos = readU32(data + 0x0A);
+	uint32_t infoSize = readU32(info + 0);
+	int32_t width = (int32_t)readU32(info + 4);
+	int32_t height = (int32_t)readU32(info + 8);
+	int bitCount = readU16(info + 14);
+	uint32_t compression = readU32(info + 16);
+	uint32_t colorsUsed = readU32(info + 32);
+	bool isTopDown = height < 0;
+	if (isTopDown) height = -height;
+	if (infoSize < BMP_INFO_HEADER_SIZE || BMP_FILE_HEADER_SIZE + (size_t)infoSize > size || width <= 0 || height <= 0) {
+		printf("Not a correct BMP file\n");
+		return false;
+	}
+
+	/* Bit masks follow a plain BITMAPINFOHEADER, and are part of V4 / V5 headers */
+	const uint8_t *next = info + infoSize;
+	uint32_t masks[4] = { 0, 0, 0, 0 };
+	if (compression == BI_BITFIELDS || compression == BI_ALPHABITFIELDS) {
+		int maskNum = (compression == BI_ALPHABITFIELDS) ? 4 : 3;
+		const uint8_t *maskPos = (infoSize >= BMP_INFO_HEADER_SIZE + 16) ? info + BMP_INFO_HEADER_SIZE : next;
+		if (maskPos + maskNum * 4 > data + size) {
+			printf("BMP file is truncated\n");
+			return false;
+		}
+		for (int i = 0; i < maskNum; i++) masks[i] = readU32(maskPos + i * 4);
+		if (infoSize >= BMP_INFO_HEADER_SIZE + 16) masks[3] = readU32(info + BMP_INFO_HEADER_SIZE + 12);
+		if (maskPos == next) next += maskNum * 4;
+	} else if (bitCount == 16) {
+		masks[0] = 0x7C00; masks[1] = 0x03E0; masks[2] = 0x001F;
+	} else if (bitCount == 32) {
+		/* the fourth byte of BI_RGB 32bpp is unused */
+		masks[0] = 0x00FF0000; masks[1] = 0x0000FF00; masks[2] = 0x000000FF;
+	}
+
+	/* Palette */
+	const uint8_t *palette = next;
+	int paletteNum = 0;
+	if (bitCount <= 8) {
+		paletteNum = colorsUsed ? (int)colorsUsed : (1 << bitCount);
+		if (paletteNum > 256 || palette + paletteNum * 4 > data + size) {
+			printf("BMP file has an invalid palette\n");
+			return false;
+		}
+	}
+
+	if (dataPos == 0) dataPos = (uint32_t)(next - data) + paletteNum * 4;
+	if (dataPos >= size) {
+		printf("BMP file is truncated\n");
+		return false;
+	}
+
+	image->width = width;
+	image->height = height;
+	image->rgba.assign((size_t)width * height * 4, 0);
+
+	if (compression == BI_RLE8 || compression == BI_RLE4) {
+		if (isTopDown || bitCount != (compression == BI_RLE8 ? 8 : 4)) {
+			printf("BMP file has an invalid RLE header\n");
+			return false;
+		}
+		for (size_t i = 0; i < image->rgba.size(); i += 4) image->rgba[i + 3] = 255;
+		if (!decodeRLE(data + dataPos, data + size, compression == BI_RLE4, palette, paletteNum, image)) {
+			printf("BMP file has a corrupted RLE stream\n");
+			return false;
+		}
+		return true;
+	}
+	if (compression != BI_RGB && compression != BI_BITFIELDS && compression != BI_ALPHABITFIELDS) {
+		printf("BMP compression %u is not supported\n", compression);
+		return false;
+	}
+	if (bitCount != 1 && bitCount != 4 && bitCount != 8 && bitCount != 16 && bitCount != 24 && bitCount != 32) {
+		printf("BMP %dbpp is not supported\n", bitCount);
+		return false;
+	}
+
+	/* Rows are padded to 4 bytes */
+	size_t stride = (((size_t)width * bitCount + 31) / 32) * 4;
+	if (stride * height > size - dataPos) {
+		printf("BMP file is truncated\n");
+		return false;
+	}
+
+	BitField fields[4] = { makeBitField(masks[0]), makeBitField(masks[1]), makeBitField(masks[2]), makeBitField(masks[3]) };
+	for (int row = 0; row < height; row++) {
+		const uint8_t *src = data + dataPos + stride * row;
+		int y = isTopDown ? height - 1 - row : row;
+		uint8_t *dst = &image->rgba[(size_t)y * width * 4];
+		switch (bitCount) {
+		case 1:
+		case 4:
+		case 8:
+			for (int x = 0; x < width; x++) {
+				int bitPos = x * bitCount;
+				int index = (src[bitPos / 8] >> (8 - bitCount - bitPos % 8)) & ((1 << bitCount) - 1);
+				setPalettePixel(&dst[x * 4], palette, paletteNum, index);
+			}
+			break;
+		case 24:
+			for (int x = 0; x < width; x++) {
+				dst[x * 4 + 0] = src[x * 3 + 2];
+				dst[x * 4 + 1] = src[x * 3 + 1];
+				dst[x * 4 + 2] = src[x * 3 + 0];
+				dst[x * 4 + 3] = 255;
+			}
+			break;
+		case 16:
+		case 32:
+			for (int x = 0; x < width; x++) {
+				uint32_t pixel = (bitCount == 16) ? readU16(src + x * 2) : readU32(src + x * 4);
+				dst[x * 4 + 0] = extractBitField(fields[0], pixel, 0);
+				dst[x * 4 + 1] = extractBitField(fields[1], pixel, 0);
+				dst[x * 4 + 2] = extractBitField(fields[2], pixel, 0);
+				dst[x * 4 + 3] = extractBitField(fields[3], pixel, 255);
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+bool ImageDecoder_decodeCompressed(const uint8_t *data, size_t size, Image *image)
+{
+	cv::Mat encoded(1, (int)size, CV_8UC1, const_cast<uint8_t*>(data));
+	cv::Mat decoded = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+	if (decoded.empty()) {
+		printf("Image could not be decoded\n");
+		return false;
+	}
+	if (decoded.depth() == CV_16U) decoded.convertTo(decoded, CV_8U, 1.0 / 257);
+
+	cv::Mat rgba;
+	switch (decoded.channels()) {
+	case 1: cv::cvtColor(decoded, rgba, cv::COLOR_GRAY2RGBA); break;
+	case 3: cv::cvtColor(decoded, rgba, cv::COLOR_BGR2RGBA); break;
+	case 4: cv::cvtColor(decoded, rgba, cv::COLOR_BGRA2RGBA); break;
+	default:
+		printf("Image has unsupported channel number %d\n", decoded.channels());
+		return false;
+	}
+
+	/* PNG and JPEG are stored top row first */
+	image->width = rgba.cols;
+	image->height = rgba.rows;
+	image->rgba.resize((size_t)rgba.cols * rgba.rows * 4);
+	cv::Mat dst(rgba.rows, rgba.cols, CV_8UC4, &image->rgba[0]);
+	cv::flip(rgba, dst, 0);
+	return true;
+}
+
+bool ImageDecoder_decode(const uint8_t *data, size_t size, Image *image)
+{
+	static const uint8_t PNG_SIGNATURE[4] = { 0x89, 'P', 'N', 'G' };
+	static const uint8_t JPEG_SIGNATURE[3] = { 0xFF, 0xD8, 0xFF };
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M') {
+		return ImageDecoder_decodeBMP(data, size, image);
+	}
+	if ((size >= 4 && memcmp(data, PNG_SIGNATURE, 4) == 0) || (size >= 3 && memcmp(data, JPEG_SIGNATURE, 3) == 0)) {
+		return ImageDecoder_decodeCompressed(data, size, image);
+	}
+	printf("Unknown image format\n");
+	return false;
+}
+
+bool ImageDecoder_load(const char *path, Image *image)
+{
+	ResourceView file;
+	if (!Resource_read(path, &file)) return false;
+	printf("Reading image %s\n", path);
+	return ImageDecoder_decode(file.data, file.size, image);
+}
@@ -0,0 +1,25 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/* Decoded image: RGBA8, tightly packed, bottom row first (OpenGL order) */
+typedef struct {
+	int width;
+	int height;
+	std::vector<uint8_t> rgba;
+} Image;
+
+/* BMP: 1/4/8bpp palette (incl. RLE4 / RLE8), 16/24/32bpp (incl. bitfields), bottom-up and top-down */
+bool ImageDecoder_decodeBMP(const uint8_t *data, size_t size, Image *image);
+
+/* PNG / JPEG (decoded with the codecs bundled in OpenCV) */
+bool ImageDecoder_decodeCompressed(const uint8_t *data, size_t size, Image *image);
+
+/* Decode by file signature */
+bool ImageDecoder_decode(const uint8_t *data, size_t size, Image *image);
+bool ImageDecoder_load(const char *path, Image *image);
+
+#endif
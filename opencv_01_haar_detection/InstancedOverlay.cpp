@@ -0,0 +1,144 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+
+/* for GLFW */
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "InstancedOverlay.h"
+
+/*** Macro ***/
+/* Settings */
+#define INITIAL_INSTANCE_CAPACITY 64
+#define INSTANCE_ATTRIBUTE 2
+
+/*** Global variables ***/
+
+/*** Functions ***/
+InstancedOverlay::InstancedOverlay()
+	: m_programId(0), m_viewProjectionUniformId(-1), m_textureUniformId(-1), m_meshPack(NULL), m_vao(0), m_instanceBuffer(0), m_instanceCapacity(0), m_instanceNum(0)
+{
+}
+
+InstancedOverlay::~InstancedOverlay()
+{
+	Finalize();
+}
+
+bool InstancedOverlay::Initialize(GLuint programId, const MeshPack *meshPack)
+{
+	m_programId = programId;
+	m_viewProjectionUniformId = glGetUniformLocation(programId, "VP");
+	m_textureUniformId = glGetUniformLocation(programId, "myTextureSampler");
+	if (m_viewProjectionUniformId < 0) {
+		printf("VP is not found in the overlay program\n");
+		return false;
+	}
+	if (meshPack == NULL || meshPack->GetVertexBuffer() == 0) {
+		printf("No overlay model\n");
+		return false;
+	}
+	m_meshPack = meshPack;
+
+	/* Re-specified every frame (orphaned, so a draw still reading the previous contents never blocks the update) */
+	glGenBuffers(1, &m_instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	m_instanceCapacity = INITIAL_INSTANCE_CAPACITY;
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(OverlayInstance), NULL, GL_STREAM_DRAW);
+
+	/* Attributes once for all models: the interleaved pack and the instances. VAOs are per context */
+	GLint previousVao = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, meshPack->GetVertexBuffer());
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, x));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, u));
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glEnableVertexAttribArray(INSTANCE_ATTRIBUTE);
+	glVertexAttribPointer(INSTANCE_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(OverlayInstance), (void*)0);
+	glVertexAttribDivisor(INSTANCE_ATTRIBUTE, 1);
+	glBindVertexArray((GLuint)previousVao);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+}
+
+void InstancedOverlay::Finalize()
+{
+	if (m_vao) glDeleteVertexArrays(1, &m_vao);
+	m_vao = 0;
+	if (m_instanceBuffer) glDeleteBuffers(1, &m_instanceBuffer);
+	m_instanceBuffer = 0;
+	m_instanceCapacity = 0;
+	m_meshPack = NULL;
+	m_programId = 0;
+}
+
+void InstancedOverlay::Clear()
+{
+	for (size_t i = 0; i < m_instances.size(); i++) m_instances[i].clear();
+	m_instanceNum = 0;
+}
+
+void InstancedOverlay::Add(int modelIndex, const OverlayInstance &instance)
+{
+	if (modelIndex < 0) return;
+	if ((size_t)modelIndex >= m_instances.size()) m_instances.resize(modelIndex + 1);
+	m_instances[modelIndex].push_back(instance);
+	m_instanceNum++;
+}
+
+void InstancedOverlay::Draw(const glm::mat4 &viewProjection, const TextureAsset *texture)
+{
+	if (m_instanceNum == 0 || m_vao == 0) return;
+
+	/* One upload for every model */
+	m_uploadInstances.clear();
+	for (size_t i = 0; i < m_instances.size(); i++) {
+		m_uploadInstances.insert(m_uploadInstances.end(), m_instances[i].begin(), m_instances[i].end());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	while (m_instanceCapacity < m_uploadInstances.size()) m_instanceCapacity *= 2;
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(OverlayInstance), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_uploadInstances.size() * sizeof(OverlayInstance), &m_uploadInstances[0]);
+
+	glUseProgram(m_programId);
+	glUniformMatrix4fv(m_viewProjectionUniformId, 1, GL_FALSE, &viewProjection[0][0]);
+	if (texture) {
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(texture->target, texture->id);
+		glUniform1i(m_textureUniformId, 0);
+	}
+
+	GLint previousVao = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+	glBindVertexArray(m_vao);
+	/* the instances of a model start at offset: a base instance (GL 4.2), or the instance attribute moved there */
+	bool hasBaseInstance = GLEW_ARB_base_instance || GLEW_VERSION_4_2;
+	int modelNum = m_meshPack->GetModelNum();
+	size_t offset = 0;
+	for (size_t i = 0; i < m_instances.size(); i++) {
+		size_t instanceNum = m_instances[i].size();
+		if (instanceNum == 0 || (int)i >= modelNum) {
+			offset += instanceNum;
+			continue;
+		}
+		const PackedModel &model = m_meshPack->GetModel((int)i);
+		if (hasBaseInstance) {
+			glDrawArraysInstancedBaseInstance(GL_LINE_LOOP, model.firstVertex, model.vertexNum, (GLsizei)instanceNum, (GLuint)offset);
+		} else {
+			glVertexAttribPointer(INSTANCE_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(OverlayInstance), (void*)(offset * sizeof(OverlayInstance)));
+			glDrawArraysInstanced(GL_LINE_LOOP, model.firstVertex, model.vertexNum, (GLsizei)instanceNum);
+		}
+		offset += instanceNum;
+	}
+	glBindVertexArray((GLuint)previousVao);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+}
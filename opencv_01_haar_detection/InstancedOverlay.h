@@ -0,0 +1,58 @@
+#ifndef INSTANCED_OVERLAY_H
+#define INSTANCED_OVERLAY_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "AssetManager.h"
+#include "MeshPack.h"
+
+/* Per instance attribute (location 2 of InstancedVertexShader) */
+typedef struct {
+	float x;          /* center in normalized device coordinates of the window */
+	float y;
+	float scale;
+	float rotation;   /* around Y, in radians */
+} OverlayInstance;
+
+/*
+ * Overlay models put on detections. Instances of a frame are grouped by model into one buffer, and each model is drawn
+ * with one instanced call however many detections there are. The models come from one MeshPack, specified once in
+ * the overlay's own VAO: a model is a draw range. GL context thread only
+ */
+class InstancedOverlay
+{
+public:
+	InstancedOverlay();
+	~InstancedOverlay();
+	/* program: InstancedVertexShader + a fragment shader with myTextureSampler. meshPack must outlive the overlay */
+	bool Initialize(GLuint programId, const MeshPack *meshPack);
+	void Finalize();
+	/* Per frame: Clear, Add every detection, then Draw */
+	void Clear();
+	void Add(int modelIndex, const OverlayInstance &instance);
+	/* Restores the caller's VAO binding */
+	void Draw(const glm::mat4 &viewProjection, const TextureAsset *texture);
+	int GetInstanceNum() const { return m_instanceNum; }
+
+private:
+	InstancedOverlay(const InstancedOverlay&);
+	InstancedOverlay& operator=(const InstancedOverlay&);
+
+private:
+	GLuint m_programId;
+	GLint m_viewProjectionUniformId;
+	GLint m_textureUniformId;
+	const MeshPack *m_meshPack;
+	GLuint m_vao;
+	GLuint m_instanceBuffer;
+	size_t m_instanceCapacity;          /* in instances */
+	int m_instanceNum;
+	std::vector<std::vector<OverlayInstance> > m_instances;   /* per model */
+	std::vector<OverlayInstance> m_uploadInstances;          /* m_instances concatenated */
+};
+
+#endif
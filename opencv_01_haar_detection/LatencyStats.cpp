@@ -0,0 +1,60 @@
+/*** Include ***/
+/* for general */
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "LatencyStats.h"
+
+/*** Functions ***/
+/* nearest rank on sorted samples */
+static double percentile(const std::vector<double> &sorted, double p)
+{
+	size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+	if (rank > 0) rank--;
+	return sorted[(std::min)(rank, sorted.size() - 1)];
+}
+
+LatencyStats::LatencyStats(size_t windowSize)
+	: m_windowSize(windowSize)
+{
+}
+
+void LatencyStats::Add(const std::string &stage, double seconds)
+{
+	for (size_t i = 0; i < m_stages.size(); i++) {
+		Stage &s = m_stages[i];
+		if (s.name != stage) continue;
+		if (m_windowSize == 0 || s.samples.size() < m_windowSize) {
+			s.samples.push_back(seconds);
+		} else {
+			s.samples[s.next] = seconds;
+			s.next = (s.next + 1) % m_windowSize;
+		}
+		return;
+	}
+	Stage s;
+	s.name = stage;
+	s.samples.push_back(seconds);
+	s.next = 0;
+	m_stages.push_back(s);
+}
+
+void LatencyStats::Clear()
+{
+	m_stages.clear();
+}
+
+void LatencyStats::Print() const
+{
+	printf("%-20s %8s %9s %9s %9s %9s %9s\n", "stage [msec]", "count", "mean", "p50", "p95", "p99", "max");
+	for (size_t i = 0; i < m_stages.size(); i++) {
+		std::vector<double> sorted = m_stages[i].samples;
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0;
+		for (size_t j = 0; j < sorted.size(); j++) sum += sorted[j];
+		printf("%-20s %8d %9.2f %9.2f %9.2f %9.2f %9.2f\n", m_stages[i].name.c_str(), (int)sorted.size(),
+			sum * 1000 / sorted.size(), percentile(sorted, 50) * 1000, percentile(sorted, 95) * 1000, percentile(sorted, 99) * 1000, sorted.back() * 1000);
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/* Collects latency samples per stage and prints percentiles. Not thread safe (feed it from one thread).
+ * With a window size, only the newest windowSize samples of each stage are kept (rolling report) */
+class LatencyStats
+{
+public:
+	explicit LatencyStats(size_t windowSize = 0);
+	void Add(const std::string &stage, double seconds);
+	void Clear();
+	/* count, mean, p50 / p95 / p99 / max in msec, stages in the order they were first added */
+	void Print() const;
+
+private:
+	typedef struct {
+		std::string name;
+		std::vector<double> samples;
+		size_t next;     /* oldest sample once the window is full */
+	} Stage;
+
+private:
+	size_t m_windowSize;
+	std::vector<Stage> m_stages;
+};
+
+#endif
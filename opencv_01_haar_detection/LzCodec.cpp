@@ -0,0 +1,123 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "LzCodec.h"
+
+/*** Macro ***/
+#define MIN_MATCH     4
+#define MAX_OFFSET    65535
+#define HASH_BITS     16
+#define TOKEN_MAX     15
+
+/*** Functions ***/
+static inline uint32_t read32(const uint8_t *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint32_t hashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* length >= 15 continues in 255-valued bytes */
+static void writeLength(std::vector<uint8_t> &dst, size_t length)
+{
+	length -= TOKEN_MAX;
+	while (length >= 255) {
+		dst.push_back(255);
+		length -= 255;
+	}
+	dst.push_back((uint8_t)length);
+}
+
+static void writeSequence(std::vector<uint8_t> &dst, const uint8_t *literal, size_t literalLength, size_t offset, size_t matchLength)
+{
+	size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+	uint8_t token = (uint8_t)(((literalLength < TOKEN_MAX ? literalLength : TOKEN_MAX) << 4) | (matchCode < TOKEN_MAX ? matchCode : TOKEN_MAX));
+	dst.push_back(token);
+	if (literalLength >= TOKEN_MAX) writeLength(dst, literalLength);
+	dst.insert(dst.end(), literal, literal + literalLength);
+	if (matchLength == 0) return;   /* last sequence has literals only */
+	dst.push_back((uint8_t)(offset & 0xFF));
+	dst.push_back((uint8_t)(offset >> 8));
+	if (matchCode >= TOKEN_MAX) writeLength(dst, matchCode);
+}
+
+void LzCodec_compress(const uint8_t *src, size_t srcSize, std::vector<uint8_t> &dst)
+{
+	dst.clear();
+	dst.reserve(srcSize / 2 + 16);
+	/* position + 1 of the last occurrence of each hashed 4-byte sequence (0: none) */
+	std::vector<uint32_t> table((size_t)1 << HASH_BITS, 0);
+	size_t anchor = 0;
+	size_t pos = 0;
+	while (pos + MIN_MATCH <= srcSize) {
+		uint32_t sequence = read32(src + pos);
+		uint32_t &slot = table[hashSequence(sequence)];
+		size_t candidate = slot;
+		slot = (uint32_t)(pos + 1);
+		if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != sequence) {
+			pos++;
+			continue;
+		}
+		candidate--;
+		size_t matchLength = MIN_MATCH;
+		while (pos + matchLength < srcSize && src[candidate + matchLength] == src[pos + matchLength]) matchLength++;
+		writeSequence(dst, src + anchor, pos - anchor, pos - candidate, matchLength);
+		pos += matchLength;
+		anchor = pos;
+	}
+	writeSequence(dst, src + anchor, srcSize - anchor, 0, 0);
+}
+
+static bool readLength(const uint8_t *&src, const uint8_t *srcEnd, size_t &length)
+{
+	uint8_t value;
+	do {
+		if (src >= srcEnd) return false;
+		value = *src++;
+		length += value;
+	} while (value == 255);
+	return true;
+}
+
+uint64_t LzCodec_getMaxDecompressedSize(uint64_t srcSize)
+{
+	/* the densest input is a run of 255-valued length bytes, each adding 255 bytes of match */
+	return srcSize * 255;
+}
+
+bool LzCodec_decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize)
+{
+	const uint8_t *srcEnd = src + srcSize;
+	size_t out = 0;
+	while (src < srcEnd) {
+		uint8_t token = *src++;
+		size_t literalLength = token >> 4;
+		if (literalLength == TOKEN_MAX && !readLength(src, srcEnd, literalLength)) return false;
+		if (literalLength > (size_t)(srcEnd - src) || literalLength > dstSize - out) return false;
+		memcpy(dst + out, src, literalLength);
+		src += literalLength;
+		out += literalLength;
+		if (src == srcEnd) break;
+
+		if (srcEnd - src < 2) return false;
+		size_t offset = src[0] | (src[1] << 8);
+		src += 2;
+		size_t matchLength = token & 0x0F;
+		if (matchLength == TOKEN_MAX && !readLength(src, srcEnd, matchLength)) return false;
+		matchLength += MIN_MATCH;
+		if (offset == 0 || offset > out || matchLength > dstSize - out) return false;
+		/* the match may overlap the bytes being written */
+		const uint8_t *match = dst + out - offset;
+		for (size_t i = 0; i < matchLength; i++) dst[out + i] = match[i];
+		out += matchLength;
+	}
+	return out == dstSize;
+}
@@ -0,0 +1,17 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/* Byte oriented LZ77 (LZ4-like sequences: token, literals, 16-bit offset, match length) */
+void LzCodec_compress(const uint8_t *src, size_t srcSize, std::vector<uint8_t> &dst);
+
+/* dstSize must be the exact original size. Returns false on malformed input */
+bool LzCodec_decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize);
+
+/* Largest original size srcSize compressed bytes can decode to (to reject a corrupted size before allocating) */
+uint64_t LzCodec_getMaxDecompressedSize(uint64_t srcSize);
+
+#endif
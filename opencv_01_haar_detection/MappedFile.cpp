@@ -0,0 +1,112 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+/*** Functions ***/
+MappedFile::MappedFile()
+	: m_data(NULL)
+	, m_size(0)
+#ifdef _WIN32
+	, m_fileHandle(NULL)
+	, m_mappingHandle(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const char *path)
+{
+	Close();
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		printf("%s could not be opened\n", path);
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		printf("%s is empty\n", path);
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		printf("%s could not be mapped\n", path);
+		CloseHandle(file);
+		return false;
+	}
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		printf("%s could not be mapped\n", path);
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_data = static_cast<const uint8_t*>(view);
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mappingHandle) CloseHandle(m_mappingHandle);
+	if (m_fileHandle) CloseHandle(m_fileHandle);
+	m_data = NULL;
+	m_size = 0;
+	m_mappingHandle = NULL;
+	m_fileHandle = NULL;
+}
+#else
+bool MappedFile::Open(const char *path)
+{
+	Close();
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		printf("%s could not be opened\n", path);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		printf("%s is empty\n", path);
+		close(fd);
+		return false;
+	}
+	void *addr = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	/* the mapping keeps its own reference to the file */
+	close(fd);
+	if (addr == MAP_FAILED) {
+		printf("%s could not be mapped\n", path);
+		return false;
+	}
+	/* texture and mesh data is read front to back exactly once */
+	madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+	m_data = static_cast<const uint8_t*>(addr);
+	m_size = static_cast<size_t>(st.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+	m_data = NULL;
+	m_size = 0;
+}
+#endif
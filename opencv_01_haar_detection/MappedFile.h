@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Read-only memory mapping of a whole file (mmap / MapViewOfFile) */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	bool Open(const char *path);
+	void Close();
+	bool IsOpen() const { return m_data != NULL; }
+	const uint8_t *Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+private:
+	const uint8_t *m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void *m_fileHandle;
+	void *m_mappingHandle;
+#endif
+};
+
+#endif
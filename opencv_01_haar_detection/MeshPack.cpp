@@ -0,0 +1,85 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/* for GLFW */
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "objloader.h"
+#include "ResourcePack.h"
+#include "MeshPack.h"
+
+/*** Macro ***/
+
+/*** Functions ***/
+MeshPack::MeshPack()
+	: m_vertexBuffer(0), m_bytes(0)
+{
+}
+
+MeshPack::~MeshPack()
+{
+	Finalize();
+}
+
+bool MeshPack::Load(const std::vector<std::string> &paths)
+{
+	Finalize();
+	std::vector<PackedVertex> packedVertices;
+	std::vector<PackedModel> models;
+	for (size_t i = 0; i < paths.size(); i++) {
+		const char *path = paths[i].c_str();
+		ResourceView file;
+		std::vector<unsigned short> indices;
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		if (!Resource_read(path, &file) || !loadAssImpFromMemory(file.data, file.size, path, indices, vertices, uvs, normals) || vertices.empty()) {
+			printf("%s could not be loaded\n", path);
+			return false;
+		}
+
+		/* Appended to the pack. Object size (Y only) on the way */
+		PackedModel model;
+		model.firstVertex = (GLint)packedVertices.size();
+		model.vertexNum = (GLsizei)vertices.size();
+		float objectMinY = 999999;
+		float objectMaxY = -999999;
+		packedVertices.reserve(packedVertices.size() + vertices.size());
+		for (size_t j = 0; j < vertices.size(); j++) {
+			PackedVertex vertex;
+			vertex.x = vertices[j].x;
+			vertex.y = vertices[j].y;
+			vertex.z = vertices[j].z;
+			vertex.u = (j < uvs.size()) ? uvs[j].x : 0.0f;
+			vertex.v = (j < uvs.size()) ? uvs[j].y : 0.0f;
+			packedVertices.push_back(vertex);
+			if (vertices[j].y > objectMaxY) objectMaxY = vertices[j].y;
+			if (vertices[j].y < objectMinY) objectMinY = vertices[j].y;
+		}
+		model.sizeY = objectMaxY - objectMinY;
+		models.push_back(model);
+	}
+	if (packedVertices.empty()) return false;
+
+	/* One buffer for every model */
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), &packedVertices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_models.swap(models);
+	m_bytes = packedVertices.size() * sizeof(PackedVertex);
+	return true;
+}
+
+void MeshPack::Finalize()
+{
+	if (m_vertexBuffer) glDeleteBuffers(1, &m_vertexBuffer);
+	m_vertexBuffer = 0;
+	m_models.clear();
+	m_bytes = 0;
+}
@@ -0,0 +1,55 @@
+#ifndef MESH_PACK_H
+#define MESH_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+/* Interleaved vertex of the pack (attribute 0: position, 1: UV) */
+typedef struct {
+	float x;
+	float y;
+	float z;
+	float u;          /* 0 if the model has no UV */
+	float v;
+} PackedVertex;
+
+/* Entry of the model table: where a model is in the pack */
+typedef struct {
+	GLint firstVertex;
+	GLsizei vertexNum;
+	float sizeY;      /* height of the bounding box */
+} PackedModel;
+
+/*
+ * Every overlay model in one vertex buffer, with a table of their ranges. Switching models is a change of draw range:
+ * attributes are specified once (InstancedOverlay's VAO), not per model or per frame.
+ * Loaded once, the buffer can be used by contexts sharing objects with the loading one
+ */
+class MeshPack
+{
+public:
+	MeshPack();
+	~MeshPack();
+	/* All or nothing: false if any model can't be loaded. GL context thread */
+	bool Load(const std::vector<std::string> &paths);
+	void Finalize();
+	GLuint GetVertexBuffer() const { return m_vertexBuffer; }
+	int GetModelNum() const { return (int)m_models.size(); }
+	const PackedModel &GetModel(int index) const { return m_models[index]; }
+	size_t GetBytes() const { return m_bytes; }
+
+private:
+	MeshPack(const MeshPack&);
+	MeshPack& operator=(const MeshPack&);
+
+private:
+	GLuint m_vertexBuffer;
+	std::vector<PackedModel> m_models;
+	size_t m_bytes;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "Profiler.h"
+#include "MotionGate.h"
+
+/*** Macro ***/
+#define TILE_SIZE 16     /* one SSE2 register per tile row */
+
+/*** Functions ***/
+void MotionGate_getDefaultConfig(MotionGateConfig *config)
+{
+	config->width = 160;
+	config->threshold = 8;
+	config->marginTiles = 1;
+	config->minRegionSize = 96;
+	config->maxSkipFrames = 150;
+	config->isRegionDetection = true;
+}
+
+/* SAD of each TILE_SIZE x TILE_SIZE tile (the bottom row of tiles may be shorter). width is a multiple of TILE_SIZE */
+static void computeTileSad(const cv::Mat &a, const cv::Mat &b, int tilesX, int tilesY, uint32_t *tileSad)
+{
+	for (int ty = 0; ty < tilesY; ty++) {
+		int y0 = ty * TILE_SIZE;
+		int y1 = (std::min)(y0 + TILE_SIZE, a.rows);
+		for (int tx = 0; tx < tilesX; tx++) {
+			int x0 = tx * TILE_SIZE;
+#ifdef USE_SSE2
+			__m128i acc = _mm_setzero_si128();
+			for (int y = y0; y < y1; y++) {
+				__m128i va = _mm_loadu_si128((const __m128i*)(a.ptr<uint8_t>(y) + x0));
+				__m128i vb = _mm_loadu_si128((const __m128i*)(b.ptr<uint8_t>(y) + x0));
+				acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+			}
+			/* one partial sum per 64-bit lane */
+			tileSad[ty * tilesX + tx] = (uint32_t)(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#else
+			uint32_t sad = 0;
+			for (int y = y0; y < y1; y++) {
+				const uint8_t *pa = a.ptr<uint8_t>(y) + x0;
+				const uint8_t *pb = b.ptr<uint8_t>(y) + x0;
+				for (int x = 0; x < TILE_SIZE; x++) sad += abs(pa[x] - pb[x]);
+			}
+			tileSad[ty * tilesX + tx] = sad;
+#endif
+		}
+	}
+}
+
+MotionGate::MotionGate(const MotionGateConfig &config)
+	: m_config(config), m_hasReference(false), m_framesSinceDetect(0), m_lastDetFrameId(0), m_frameNum(0), m_skipNum(0)
+{
+}
+
+cv::Rect MotionGate::Update(const cv::Mat &gray)
+{
+	ScopedTimer timer("motion");
+	cv::Rect whole(0, 0, gray.cols, gray.rows);
+	int width = (std::min)(m_config.width, gray.cols) / TILE_SIZE * TILE_SIZE;
+	if (width < TILE_SIZE) return whole;
+	int height = (std::max)(1, (int)((double)gray.rows * width / gray.cols + 0.5));
+	cv::resize(gray, m_small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+	if (!m_hasReference || m_reference.cols != m_small.cols || m_reference.rows != m_small.rows) return whole;
+
+	int tilesX = width / TILE_SIZE;
+	int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_tileSad.resize(tilesX * tilesY);
+	computeTileSad(m_small, m_reference, tilesX, tilesY, &m_tileSad[0]);
+
+	/* bounding box of the changed tiles */
+	int tx0 = tilesX, ty0 = tilesY, tx1 = -1, ty1 = -1;
+	for (int ty = 0; ty < tilesY; ty++) {
+		uint32_t pixelNum = TILE_SIZE * ((std::min)((ty + 1) * TILE_SIZE, height) - ty * TILE_SIZE);
+		for (int tx = 0; tx < tilesX; tx++) {
+			if (m_tileSad[ty * tilesX + tx] <= (uint32_t)m_config.threshold * pixelNum) continue;
+			tx0 = (std::min)(tx0, tx);
+			ty0 = (std::min)(ty0, ty);
+			tx1 = (std::max)(tx1, tx);
+			ty1 = (std::max)(ty1, ty);
+		}
+	}
+	if (tx1 < 0) return cv::Rect();
+
+	tx0 -= m_config.marginTiles;
+	ty0 -= m_config.marginTiles;
+	tx1 += m_config.marginTiles + 1;
+	ty1 += m_config.marginTiles + 1;
+	double scale = (double)gray.cols / width;
+	cv::Rect region((int)(tx0 * TILE_SIZE * scale), (int)(ty0 * TILE_SIZE * scale),
+		(int)((tx1 - tx0) * TILE_SIZE * scale + 0.5), (int)((ty1 - ty0) * TILE_SIZE * scale + 0.5));
+	return region & whole;
+}
+
+void MotionGate::Accept()
+{
+	std::swap(m_reference, m_small);
+	m_hasReference = !m_reference.empty();
+}
+
+bool MotionGate::GetLastDetections(const cv::Size &imageSize, std::vector<cv::Rect> &listDet)
+{
+	std::lock_guard<std::mutex> lock(m_lastDetMutex);
+	if (m_lastDetFrameId == 0 || m_lastDetImageSize.width != imageSize.width || m_lastDetImageSize.height != imageSize.height) return false;
+	listDet = m_lastDet;
+	return true;
+}
+
+cv::Rect MotionGate::Decide(const cv::Mat &gray)
+{
+	m_frameNum++;
+	cv::Rect whole(0, 0, gray.cols, gray.rows);
+	cv::Rect region = Update(gray);
+	bool isForced = m_config.maxSkipFrames > 0 && m_framesSinceDetect >= m_config.maxSkipFrames;
+	if (region.area() == 0 && !isForced) {
+		/* nothing moved: the reference is kept, so small changes add up over the skipped frames */
+		m_framesSinceDetect++;
+		m_skipNum++;
+		return cv::Rect();
+	}
+	m_framesSinceDetect = 0;
+	Accept();
+
+	/* boxes from another detection size can't be kept around a region */
+	std::vector<cv::Rect> lastDet;
+	if (!m_config.isRegionDetection || isForced || region == whole || !GetLastDetections(cv::Size(gray.cols, gray.rows), lastDet)) return whole;
+
+	/* at least minRegionSize around its center, so the cascade window fits */
+	if (region.width < m_config.minRegionSize) {
+		region.x -= (m_config.minRegionSize - region.width) / 2;
+		region.width = m_config.minRegionSize;
+	}
+	if (region.height < m_config.minRegionSize) {
+		region.y -= (m_config.minRegionSize - region.height) / 2;
+		region.height = m_config.minRegionSize;
+	}
+	region &= whole;
+	/* Previous boxes touching the region are detected again, not kept: take them in whole (an object that moved left its old box too) */
+	bool isGrown = true;
+	while (isGrown) {
+		isGrown = false;
+		for (size_t i = 0; i < lastDet.size(); i++) {
+			cv::Rect merged = region | lastDet[i];
+			if ((lastDet[i] & region).area() > 0 && !(merged == region)) {
+				region = merged & whole;
+				isGrown = true;
+			}
+		}
+	}
+	return region;
+}
+
+void MotionGate::Detect(const cv::Mat &gray, uint64_t frameId, const cv::Rect &region, std::vector<cv::Rect> &listDet, const Detector &detector)
+{
+	cv::Rect whole(0, 0, gray.cols, gray.rows);
+	std::vector<cv::Rect> lastDet;
+	bool hasLastDet = GetLastDetections(cv::Size(gray.cols, gray.rows), lastDet);
+	if (region.area() == 0 && hasLastDet) {
+		/* static: the newest boxes (workers may finish out of order, so not necessarily those of the previous frame) */
+		listDet = lastDet;
+		return;
+	}
+	if (region.area() == 0 || region == whole || !hasLastDet) {
+		detector(gray, listDet);
+	} else {
+		std::vector<cv::Rect> listRegionDet;
+		detector(gray(region), listRegionDet);
+		listDet.clear();
+		for (size_t i = 0; i < lastDet.size(); i++) {
+			if ((lastDet[i] & region).area() == 0) listDet.push_back(lastDet[i]);
+		}
+		for (size_t i = 0; i < listRegionDet.size(); i++) {
+			cv::Rect r = listRegionDet[i];
+			r.x += region.x;
+			r.y += region.y;
+			listDet.push_back(r);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_lastDetMutex);
+	if (frameId > m_lastDetFrameId) {
+		m_lastDet = listDet;
+		m_lastDetImageSize = cv::Size(gray.cols, gray.rows);
+		m_lastDetFrameId = frameId;
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+#include <opencv2/opencv.hpp>
+
+typedef struct {
+	int width;               /* the difference runs on a copy this wide (rounded down to the tile size) */
+	int threshold;           /* mean absolute difference per pixel for a tile to count as changed */
+	int marginTiles;         /* tiles added around the changed region */
+	int minRegionSize;       /* the region is grown to at least this (detection image pixels), bigger than the cascade window */
+	int maxSkipFrames;       /* a full detection is forced after this many skipped frames (0: never) */
+	bool isRegionDetection;  /* run the detector on the changed region only. Off for stateful detectors that need whole frames */
+} MotionGateConfig;
+
+void MotionGate_getDefaultConfig(MotionGateConfig *config);
+
+/*
+ * Skips detection when nothing moved. Each frame is reduced to a small gray image and compared with the one of the last detection
+ * (sum of absolute differences per 16x16 tile, SSE2 when available), so slow drifts accumulate until they are noticed.
+ * Static frame: the previous boxes are returned. Motion: the detector runs on the changed region only (if allowed),
+ * and previous boxes outside of it are kept.
+ * One gate per stream: Decide sees every frame in order (capture thread), Detect runs on any detection worker and
+ * merges with the boxes of the newest detected frame
+ */
+class MotionGate
+{
+public:
+	typedef std::function<void(const cv::Mat &gray, std::vector<cv::Rect> &listDet)> Detector;
+
+	explicit MotionGate(const MotionGateConfig &config);
+	/* Capture thread, frames in order. Region of gray to detect: empty if nothing moved, the whole image for a full detection */
+	cv::Rect Decide(const cv::Mat &gray);
+	/* Any thread. Boxes of the frame of id frameId given the region Decide returned for it */
+	void Detect(const cv::Mat &gray, uint64_t frameId, const cv::Rect &region, std::vector<cv::Rect> &listDet, const Detector &detector);
+
+	int GetFrameNum() const { return m_frameNum; }
+	int GetSkipNum() const { return m_skipNum; }
+
+private:
+	MotionGate(const MotionGate&);
+	MotionGate& operator=(const MotionGate&);
+	/* Region of gray that changed since the last accepted frame: empty if none, the whole image on the first frame or a size change */
+	cv::Rect Update(const cv::Mat &gray);
+	/* Make the current frame the reference for the next Update */
+	void Accept();
+	/* Newest detected boxes if they are in the coordinates of imageSize */
+	bool GetLastDetections(const cv::Size &imageSize, std::vector<cv::Rect> &listDet);
+
+private:
+	MotionGateConfig m_config;
+	/* capture thread */
+	cv::Mat m_small;
+	cv::Mat m_reference;
+	bool m_hasReference;
+	std::vector<uint32_t> m_tileSad;
+	int m_framesSinceDetect;
+	/* newest detection, from the workers */
+	std::mutex m_lastDetMutex;
+	std::vector<cv::Rect> m_lastDet;
+	cv::Size m_lastDetImageSize;
+	uint64_t m_lastDetFrameId;
+	std::atomic<int> m_frameNum;
+	std::atomic<int> m_skipNum;
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*** Include ***/
+/* for general */
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "MultiCascadeDetector.h"
+
+/*** Macro ***/
+/* Settings */
+#define GROUP_EPS 0.2   /* same as cv::CascadeClassifier */
+
+/*** Global variables ***/
+
+/*** Functions ***/
+void MultiCascadeConfig_getDefaultConfig(MultiCascadeConfig *config)
+{
+	config->scaleFactor = 1.1f;
+	config->minNeighbors = 8;
+	config->minSize = 30;
+	config->maxSize = 0;
+	config->bandHeight = 16;
+	config->threadNum = 0;
+}
+
+MultiCascadeDetector::MultiCascadeDetector(const std::vector<std::string> &cascadePaths, const MultiCascadeConfig &multiConfig, const DetectorConfig &config)
+	: Detector(config), m_cascadePaths(cascadePaths), m_multiConfig(multiConfig), m_scaleFactor(multiConfig.scaleFactor)
+{
+	/* the cascades are read only while detecting, so every worker shares them */
+	for (size_t i = 0; i < m_cascadePaths.size(); i++) {
+		std::unique_ptr<HaarCascade> cascade(new HaarCascade());
+		if (!cascade->Load(m_cascadePaths[i].c_str())) {
+			printf("failed to load %s\n", m_cascadePaths[i].c_str());
+			continue;
+		}
+		m_cascades.push_back(std::move(cascade));
+	}
+	m_workers.resize(GetConfig().workerNum);
+	m_pool.reset(new WorkStealingPool(m_multiConfig.threadNum));
+}
+
+MultiCascadeDetector::~MultiCascadeDetector()
+{
+	Stop();
+}
+
+bool MultiCascadeDetector::CreateWorker(int workerIndex)
+{
+	if (m_cascades.empty()) return false;
+	Worker *worker = new Worker();
+	for (size_t i = 0; i < m_cascades.size(); i++) worker->evaluators.push_back(HaarEvaluator(&m_cascades[i]->GetData()));
+	m_workers[workerIndex].reset(worker);
+	return true;
+}
+
+void MultiCascadeDetector::DetectEach(int workerIndex, const cv::Mat &gray, std::vector<std::vector<cv::Rect> > &objects)
+{
+	Worker &worker = *m_workers[workerIndex];
+	int cascadeNum = (int)worker.evaluators.size();
+	objects.assign(cascadeNum, std::vector<cv::Rect>());
+	if (cascadeNum == 0 || gray.empty()) return;
+
+	/* one pyramid for every cascade, down to the smallest window */
+	cv::Size minWindow = worker.evaluators[0].GetWindowSize();
+	bool isTilted = false;
+	for (int c = 0; c < cascadeNum; c++) {
+		cv::Size window = worker.evaluators[c].GetWindowSize();
+		minWindow.width = std::min(minWindow.width, window.width);
+		minWindow.height = std::min(minWindow.height, window.height);
+		isTilted |= (m_cascades[c]->GetData().hasTilted != 0);
+	}
+	worker.pyramid.Build(gray, m_scaleFactor, minWindow, isTilted, m_pool.get());
+	for (int c = 0; c < cascadeNum; c++) worker.evaluators[c].Prepare(worker.pyramid);
+
+	/* tasks are bands of window rows, so a large level is shared by several threads */
+	cv::Size minSize(m_multiConfig.minSize, m_multiConfig.minSize);
+	cv::Size maxSize(m_multiConfig.maxSize, m_multiConfig.maxSize);
+	int bandHeight = std::max(m_multiConfig.bandHeight, 2);
+	worker.tasks.clear();
+	for (int c = 0; c < cascadeNum; c++) {
+		for (int l = 0; l < worker.pyramid.GetLevelNum(); l++) {
+			int scanHeight = worker.evaluators[c].GetScanHeight(worker.pyramid, l, minSize, maxSize);
+			for (int y = 0; y < scanHeight; y += bandHeight) {
+				Task task = { c, l, y, std::min(y + bandHeight, scanHeight) };
+				worker.tasks.push_back(task);
+			}
+		}
+	}
+	int taskNum = (int)worker.tasks.size();
+	if ((int)worker.taskObjects.size() < taskNum) worker.taskObjects.resize(taskNum);
+	for (int t = 0; t < taskNum; t++) worker.taskObjects[t].clear();
+	m_pool->ParallelFor(taskNum, [&worker](int t) {
+		const Task &task = worker.tasks[t];
+		worker.evaluators[task.cascadeIndex].Scan(worker.pyramid, task.levelIndex, task.yBegin, task.yEnd, worker.taskObjects[t]);
+	});
+
+	/* merged in task order, so the result doesn't depend on which thread ran what */
+	for (int t = 0; t < taskNum; t++) {
+		std::vector<cv::Rect> &cascadeObjects = objects[worker.tasks[t].cascadeIndex];
+		cascadeObjects.insert(cascadeObjects.end(), worker.taskObjects[t].begin(), worker.taskObjects[t].end());
+	}
+	for (int c = 0; c < cascadeNum; c++) cv::groupRectangles(objects[c], m_multiConfig.minNeighbors, GROUP_EPS);
+}
+
+void MultiCascadeDetector::DetectBatch(int workerIndex, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &results)
+{
+	std::vector<std::vector<cv::Rect> > objects;
+	for (size_t i = 0; i < images.size(); i++) {
+		DetectEach(workerIndex, images[i], objects);
+		results[i].clear();
+		for (size_t c = 0; c < objects.size(); c++) results[i].insert(results[i].end(), objects[c].begin(), objects[c].end());
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef MULTI_CASCADE_DETECTOR_H
+#define MULTI_CASCADE_DETECTOR_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+
+#include <opencv2/opencv.hpp>
+
+#include "Detector.h"
+#include "HaarCascade.h"
+#include "HaarEvaluator.h"
+#include "WorkStealingPool.h"
+
+typedef struct {
+	float scaleFactor;
+	int minNeighbors;
+	int minSize;             /* in detection image pixels */
+	int maxSize;             /* 0: no limit */
+	int bandHeight;          /* window rows of a level per task */
+	int threadNum;           /* pool threads (0: cores - 1) */
+} MultiCascadeConfig;
+
+void MultiCascadeConfig_getDefaultConfig(MultiCascadeConfig *config);
+
+/*
+ * Several Haar cascades on one frame (e.g. palm and face) for the cost of one pyramid: the scaled images and their
+ * integral images are built once, then every cascade scans every level in bands of rows on a work-stealing pool.
+ * Hits are grouped per cascade like cv::CascadeClassifier (minNeighbors), and all cascades' boxes are returned together
+ */
+class MultiCascadeDetector : public Detector
+{
+public:
+	MultiCascadeDetector(const std::vector<std::string> &cascadePaths, const MultiCascadeConfig &multiConfig, const DetectorConfig &config);
+	~MultiCascadeDetector();
+	std::string GetName() const { return "multi cascade"; }
+	int GetCascadeNum() const { return (int)m_cascades.size(); }
+	/* can be changed while running */
+	void SetScaleFactor(float scaleFactor) { m_scaleFactor = scaleFactor; }
+	/* Boxes of each cascade. workerIndex selects the scratch buffers (one caller per index at a time) */
+	void DetectEach(int workerIndex, const cv::Mat &gray, std::vector<std::vector<cv::Rect> > &objects);
+
+protected:
+	bool CreateWorker(int workerIndex);
+	void DetectBatch(int workerIndex, const std::vector<cv::Mat> &images, std::vector<std::vector<cv::Rect> > &results);
+
+private:
+	typedef struct {
+		int cascadeIndex;
+		int levelIndex;
+		int yBegin;
+		int yEnd;
+	} Task;
+
+	typedef struct {
+		HaarPyramid pyramid;
+		std::vector<HaarEvaluator> evaluators;   /* per cascade */
+		std::vector<Task> tasks;
+		std::vector<std::vector<cv::Rect> > taskObjects;
+	} Worker;
+
+private:
+	std::vector<std::string> m_cascadePaths;
+	MultiCascadeConfig m_multiConfig;
+	std::atomic<float> m_scaleFactor;
+	std::vector<std::unique_ptr<HaarCascade> > m_cascades;   /* read only, shared by every worker */
+	std::vector<std::unique_ptr<Worker> > m_workers;
+	std::unique_ptr<WorkStealingPool> m_pool;
+};
+
+#endif
@@ -0,0 +1,234 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "LzCodec.h"
+#include "ResourcePack.h"
+#include "HaarCascade.h"
+
+/*** Macro ***/
+/* keep the compressed payload only if it saves at least 1/4 (otherwise zero-copy wins) */
+#define COMPRESSION_GAIN_NUM 3
+#define COMPRESSION_GAIN_DEN 4
+
+/*** Type ***/
+typedef struct {
+	std::string name;
+	std::vector<uint8_t> stored;
+	uint64_t size;
+	uint32_t flags;
+	uint64_t offset;
+	uint32_t nameOffset;
+} PackEntry;
+
+/*** Functions ***/
+static void writeU32(std::vector<uint8_t> &dst, size_t pos, uint32_t value)
+{
+	for (int i = 0; i < 4; i++) dst[pos + i] = (uint8_t)(value >> (8 * i));
+}
+
+static void writeU64(std::vector<uint8_t> &dst, size_t pos, uint64_t value)
+{
+	writeU32(dst, pos, (uint32_t)value);
+	writeU32(dst, pos + 4, (uint32_t)(value >> 32));
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &data)
+{
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (fp == NULL) return false;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	data.resize(size);
+	bool ret = (size == 0) || (fread(&data[0], 1, size, fp) == (size_t)size);
+	fclose(fp);
+	return ret;
+}
+
+/* Relative paths of all regular files under dir */
+static void listFiles(const std::string &dir, const std::string &prefix, std::vector<std::string> &files)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA findData;
+	HANDLE handle = FindFirstFileA((dir + "\\*").c_str(), &findData);
+	if (handle == INVALID_HANDLE_VALUE) return;
+	do {
+		std::string name = findData.cFileName;
+		if (name == "." || name == "..") continue;
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			listFiles(dir + "/" + name, prefix + name + "/", files);
+		} else {
+			files.push_back(prefix + name);
+		}
+	} while (FindNextFileA(handle, &findData));
+	FindClose(handle);
+#else
+	DIR *dp = opendir(dir.c_str());
+	if (dp == NULL) return;
+	struct dirent *ent;
+	while ((ent = readdir(dp)) != NULL) {
+		std::string name = ent->d_name;
+		if (name == "." || name == "..") continue;
+		struct stat st;
+		if (stat((dir + "/" + name).c_str(), &st) != 0) continue;
+		if (S_ISDIR(st.st_mode)) {
+			listFiles(dir + "/" + name, prefix + name + "/", files);
+		} else if (S_ISREG(st.st_mode)) {
+			files.push_back(prefix + name);
+		}
+	}
+	closedir(dp);
+#endif
+}
+
+/* CascadeClassifier::read(FileNode) only accepts the new cascade format, so convert old (haartraining) cascades
+ * once here. Loading from the pack then skips the conversion that CascadeClassifier::load does on every start */
+static void convertOldCascade(const std::string &path, const std::string &tempPath, std::vector<uint8_t> &data)
+{
+	static const char OLD_CASCADE_TAG[] = "opencv-haar-classifier";
+	if (std::search(data.begin(), data.end(), OLD_CASCADE_TAG, OLD_CASCADE_TAG + sizeof(OLD_CASCADE_TAG) - 1) == data.end()) return;
+	std::vector<uint8_t> converted;
+	if (cv::CascadeClassifier::convert(path, tempPath) && readFile(tempPath, converted)) {
+		printf("  converted %s to the new cascade format\n", path.c_str());
+		data.swap(converted);
+	}
+	remove(tempPath.c_str());
+}
+
+static void addEntry(const std::string &name, std::vector<uint8_t> &data, bool isStoreOnly, std::vector<PackEntry> &entries, std::string &names)
+{
+	PackEntry entry;
+	entry.name = name;
+	entry.size = data.size();
+	entry.flags = 0;
+	std::vector<uint8_t> compressed;
+	if (!isStoreOnly && !data.empty()) LzCodec_compress(&data[0], data.size(), compressed);
+	if (!compressed.empty() && compressed.size() * COMPRESSION_GAIN_DEN <= data.size() * COMPRESSION_GAIN_NUM) {
+		entry.stored.swap(compressed);
+		entry.flags |= RESOURCE_PACK_FLAG_COMPRESSED;
+	} else {
+		entry.stored.swap(data);
+	}
+	entry.offset = 0;
+	entry.nameOffset = (uint32_t)names.size();
+	names += entry.name;
+	printf("%-48s %10d -> %10d%s\n", entry.name.c_str(), (int)entry.size, (int)entry.stored.size(), (entry.flags & RESOURCE_PACK_FLAG_COMPRESSED) ? " (lz)" : "");
+	entries.push_back(entry);
+}
+
+/* pack_builder <output.pack> <input directory> [--store] */
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		printf("usage: %s <output.pack> <input directory> [--store]\n", argv[0]);
+		return 1;
+	}
+	std::string outputPath = argv[1];
+	std::string inputDir = ResourcePack_normalizeName(argv[2]);
+	while (inputDir.size() > 1 && inputDir[inputDir.size() - 1] == '/') inputDir.erase(inputDir.size() - 1);
+	bool isStoreOnly = (argc > 3 && strcmp(argv[3], "--store") == 0);
+
+	/* Entry names keep the directory name, so "resource/xxx" works both packed and loose */
+	size_t slash = inputDir.find_last_of('/');
+	std::string prefix = (slash == std::string::npos ? inputDir : inputDir.substr(slash + 1)) + "/";
+	std::vector<std::string> files;
+	listFiles(inputDir, "", files);
+	std::sort(files.begin(), files.end());
+	if (files.empty()) {
+		printf("no files in %s\n", inputDir.c_str());
+		return 1;
+	}
+
+	std::vector<PackEntry> entries;
+	std::string names;
+	for (size_t i = 0; i < files.size(); i++) {
+		std::string path = inputDir + "/" + files[i];
+		std::vector<uint8_t> data;
+		if (!readFile(path, data)) {
+			printf("Impossible to open %s\n", path.c_str());
+			return 1;
+		}
+		if (path.size() > 4 && path.compare(path.size() - 4, 4, ".xml") == 0) {
+			convertOldCascade(path, outputPath + ".tmp.xml", data);
+			/* The precompiled cascade goes next to the XML, stored so that HaarCascade::Load maps it from the pack */
+			std::string binaryFile = HaarCascade_getBinaryPath(files[i].c_str());
+			HaarCascade cascade;
+			if (!std::binary_search(files.begin(), files.end(), binaryFile) && !data.empty() && cascade.LoadFromMemory((const char*)&data[0], data.size())) {
+				std::vector<uint8_t> binary;
+				cascade.ToBinary(binary);
+				addEntry(prefix + binaryFile, binary, true, entries, names);
+			}
+		}
+		addEntry(prefix + files[i], data, isStoreOnly, entries, names);
+	}
+
+	/* Hash table with load factor <= 0.5 */
+	uint32_t bucketNum = 1;
+	while (bucketNum < entries.size() * 2) bucketNum <<= 1;
+	std::vector<uint32_t> buckets(bucketNum, 0);
+	for (size_t i = 0; i < entries.size(); i++) {
+		uint32_t bucket = (uint32_t)ResourcePack_hashName(entries[i].name) & (bucketNum - 1);
+		while (buckets[bucket] != 0) bucket = (bucket + 1) & (bucketNum - 1);
+		buckets[bucket] = (uint32_t)i + 1;
+	}
+
+	/* Layout */
+	uint64_t entriesOffset = RESOURCE_PACK_HEADER_SIZE;
+	uint64_t bucketsOffset = entriesOffset + (uint64_t)entries.size() * RESOURCE_PACK_ENTRY_SIZE;
+	uint64_t namesOffset = bucketsOffset + (uint64_t)bucketNum * 4;
+	uint64_t offset = namesOffset + names.size();
+	for (size_t i = 0; i < entries.size(); i++) {
+		offset = (offset + RESOURCE_PACK_ALIGNMENT - 1) & ~(uint64_t)(RESOURCE_PACK_ALIGNMENT - 1);
+		entries[i].offset = offset;
+		offset += entries[i].stored.size();
+	}
+
+	std::vector<uint8_t> pack((size_t)offset, 0);
+	memcpy(&pack[0], RESOURCE_PACK_MAGIC, 4);
+	writeU32(pack, 4, RESOURCE_PACK_VERSION);
+	writeU32(pack, 8, (uint32_t)entries.size());
+	writeU32(pack, 12, bucketNum);
+	writeU64(pack, 16, entriesOffset);
+	writeU64(pack, 24, bucketsOffset);
+	writeU64(pack, 32, namesOffset);
+	writeU64(pack, 40, names.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		size_t pos = (size_t)(entriesOffset + i * RESOURCE_PACK_ENTRY_SIZE);
+		writeU64(pack, pos + 0, ResourcePack_hashName(entries[i].name));
+		writeU64(pack, pos + 8, entries[i].offset);
+		writeU64(pack, pos + 16, entries[i].stored.size());
+		writeU64(pack, pos + 24, entries[i].size);
+		writeU32(pack, pos + 32, entries[i].nameOffset);
+		writeU32(pack, pos + 36, (uint32_t)entries[i].name.size());
+		writeU32(pack, pos + 40, entries[i].flags);
+		if (!entries[i].stored.empty()) memcpy(&pack[(size_t)entries[i].offset], &entries[i].stored[0], entries[i].stored.size());
+	}
+	for (uint32_t i = 0; i < bucketNum; i++) writeU32(pack, (size_t)(bucketsOffset + i * 4), buckets[i]);
+	memcpy(&pack[(size_t)namesOffset], names.data(), names.size());
+
+	FILE *fp = fopen(outputPath.c_str(), "wb");
+	if (fp == NULL || fwrite(&pack[0], 1, pack.size(), fp) != pack.size()) {
+		printf("Impossible to write %s\n", outputPath.c_str());
+		if (fp) fclose(fp);
+		return 1;
+	}
+	fclose(fp);
+	printf("%s: %d entries, %d bytes\n", outputPath.c_str(), (int)entries.size(), (int)pack.size());
+	return 0;
+}
@@ -0,0 +1,74 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/* for GLFW */
+#include <GL/glew.h>
+
+#include "Profiler.h"
+#include "PresentTimer.h"
+
+/*** Functions ***/
+PresentTimer::PresentTimer(int depth)
+	: m_entries(depth), m_head(0), m_pendingNum(0), m_gpuToCpuOffset(0), m_scanoutDelay(0)
+{
+	for (size_t i = 0; i < m_entries.size(); i++) m_entries[i].query = 0;
+}
+
+PresentTimer::~PresentTimer()
+{
+	Finalize();
+}
+
+bool PresentTimer::Initialize(double scanoutDelay)
+{
+	Finalize();
+	for (size_t i = 0; i < m_entries.size(); i++) glGenQueries(1, &m_entries[i].query);
+	m_scanoutDelay = scanoutDelay;
+
+	/* GL_TIMESTAMP read back directly is the GPU time of "now" */
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	m_gpuToCpuOffset = Profiler_getTime() - gpuTime * 1e-9;
+	return glGetError() == GL_NO_ERROR;
+}
+
+void PresentTimer::Finalize()
+{
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		if (m_entries[i].query) glDeleteQueries(1, &m_entries[i].query);
+		m_entries[i].query = 0;
+	}
+	m_head = 0;
+	m_pendingNum = 0;
+}
+
+bool PresentTimer::MarkPresent(uint64_t frameId, double captureTime)
+{
+	if (m_entries.empty() || m_entries[0].query == 0 || m_pendingNum == (int)m_entries.size()) return false;
+	Entry &entry = m_entries[(m_head + m_pendingNum) % m_entries.size()];
+	glQueryCounter(entry.query, GL_TIMESTAMP);
+	entry.frameId = frameId;
+	entry.captureTime = captureTime;
+	m_pendingNum++;
+	return true;
+}
+
+bool PresentTimer::Poll(uint64_t *frameId, double *captureTime, double *presentTime)
+{
+	if (m_pendingNum == 0) return false;
+	Entry &entry = m_entries[m_head];
+	GLint isAvailable = 0;
+	glGetQueryObjectiv(entry.query, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+	if (!isAvailable) return false;
+	GLuint64 gpuTime = 0;
+	glGetQueryObjectui64v(entry.query, GL_QUERY_RESULT, &gpuTime);
+	*frameId = entry.frameId;
+	*captureTime = entry.captureTime;
+	*presentTime = gpuTime * 1e-9 + m_gpuToCpuOffset + m_scanoutDelay;
+	m_head = (m_head + 1) % m_entries.size();
+	m_pendingNum--;
+	return true;
+}
@@ -0,0 +1,44 @@
+#ifndef PRESENT_TIMER_H
+#define PRESENT_TIMER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+/*
+ * Capture-to-photon estimate. A GL timestamp query issued right after SwapBuffers completes when the GPU has finished the frame;
+ * its GPU time is mapped onto Profiler_getTime with an offset measured at Initialize, and the scanout delay is added
+ * (e.g. half a refresh period with vsync). Results are polled a few frames later, so the render loop never waits for the GPU.
+ */
+class PresentTimer
+{
+public:
+	explicit PresentTimer(int depth = 4);
+	~PresentTimer();
+	bool Initialize(double scanoutDelay);
+	void Finalize();
+	/* Call right after SwapBuffers. Skipped (returns false) if every query is still pending */
+	bool MarkPresent(uint64_t frameId, double captureTime);
+	/* Oldest marked frame whose present time is known, false if none yet */
+	bool Poll(uint64_t *frameId, double *captureTime, double *presentTime);
+
+private:
+	PresentTimer(const PresentTimer&);
+	PresentTimer& operator=(const PresentTimer&);
+
+	typedef struct {
+		GLuint query;
+		uint64_t frameId;
+		double captureTime;
+	} Entry;
+
+private:
+	std::vector<Entry> m_entries;
+	int m_head;          /* oldest pending */
+	int m_pendingNum;
+	double m_gpuToCpuOffset;
+	double m_scanoutDelay;
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <utility>
+
+#include "RingQueue.h"
+#include "LatencyStats.h"
+#include "Profiler.h"
+
+/*** Global variables ***/
+static std::unique_ptr<RingQueue<ProfileEvent> > s_events;
+static std::atomic<uint64_t> s_droppedNum(0);
+static std::atomic<uint32_t> s_threadNum(0);
+static thread_local uint32_t t_threadId = 0;
+
+/* rarely touched: guarded by a mutex */
+static std::mutex s_threadNameMutex;
+static std::vector<std::pair<uint32_t, std::string> > s_threadNames;
+
+/* used by the collecting thread only */
+static FILE *s_traceFile = NULL;
+static bool s_isFirstTraceEvent = true;
+static double s_traceStartTime = 0;
+
+/*** Functions ***/
+static uint32_t getThreadId()
+{
+	if (t_threadId == 0) t_threadId = ++s_threadNum;
+	return t_threadId;
+}
+
+void Profiler_initialize(size_t capacity)
+{
+	s_events.reset(new RingQueue<ProfileEvent>(capacity));
+	s_droppedNum = 0;
+}
+
+void Profiler_finalize()
+{
+	Profiler_closeTrace();
+	s_events.reset();
+}
+
+double Profiler_getTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler_record(const char *stage, uint64_t frameId, double beginTime, double endTime)
+{
+	if (!s_events) return;
+	ProfileEvent event;
+	event.stage = stage;
+	event.frameId = frameId;
+	event.threadId = getThreadId();
+	event.beginTime = beginTime;
+	event.endTime = endTime;
+	if (!s_events->TryPush(event)) s_droppedNum++;
+}
+
+void Profiler_setThreadName(const char *name)
+{
+	std::lock_guard<std::mutex> lock(s_threadNameMutex);
+	s_threadNames.push_back(std::make_pair(getThreadId(), std::string(name)));
+}
+
+uint64_t Profiler_getDroppedNum()
+{
+	return s_droppedNum;
+}
+
+static void writeTraceEvent(const ProfileEvent &event)
+{
+	/* complete event ("X"), microseconds from the start of the trace */
+	fprintf(s_traceFile, "%s{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.1f,\"dur\":%.1f,\"args\":{\"frame\":%llu}}",
+		s_isFirstTraceEvent ? "\n" : ",\n", event.stage, event.threadId, (event.beginTime - s_traceStartTime) * 1e6,
+		(event.endTime - event.beginTime) * 1e6, (unsigned long long)event.frameId);
+	s_isFirstTraceEvent = false;
+}
+
+size_t Profiler_collect(LatencyStats *stats)
+{
+	if (!s_events) return 0;
+	size_t num = 0;
+	ProfileEvent event;
+	while (s_events->TryPop(event)) {
+		if (stats) stats->Add(event.stage, event.endTime - event.beginTime);
+		if (s_traceFile && event.beginTime >= s_traceStartTime) writeTraceEvent(event);
+		num++;
+	}
+	return num;
+}
+
+bool Profiler_openTrace(const char *path)
+{
+	Profiler_closeTrace();
+	s_traceFile = fopen(path, "w");
+	if (s_traceFile == NULL) {
+		printf("Failed to open %s\n", path);
+		return false;
+	}
+	fprintf(s_traceFile, "[");
+	s_isFirstTraceEvent = true;
+	s_traceStartTime = Profiler_getTime();
+	return true;
+}
+
+void Profiler_closeTrace()
+{
+	if (s_traceFile == NULL) return;
+	Profiler_collect(NULL);
+	std::lock_guard<std::mutex> lock(s_threadNameMutex);
+	for (size_t i = 0; i < s_threadNames.size(); i++) {
+		fprintf(s_traceFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			s_isFirstTraceEvent ? "\n" : ",\n", s_threadNames[i].first, s_threadNames[i].second.c_str());
+		s_isFirstTraceEvent = false;
+	}
+	fprintf(s_traceFile, "\n]\n");
+	fclose(s_traceFile);
+	s_traceFile = NULL;
+}
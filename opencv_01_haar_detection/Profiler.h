@@ -0,0 +1,59 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class LatencyStats;
+
+/*
+ * Stage timing across threads. ScopedTimer (or Profiler_record) stamps an event into a bounded lock-free ring from any thread;
+ * one thread (the render loop) drains it with Profiler_collect into LatencyStats and, optionally, a Chrome trace file
+ * (open it in chrome://tracing or ui.perfetto.dev). Events carry the frame id so a frame can be followed from capture to display.
+ * Recording is a no-op until Profiler_initialize, and an event is dropped (not waited for) when the ring is full.
+ */
+typedef struct {
+	const char *stage;     /* string literal: only the pointer is stored */
+	uint64_t frameId;      /* 0: not tied to a frame */
+	uint32_t threadId;     /* small sequential id per thread */
+	double beginTime;      /* seconds, same clock as Profiler_getTime */
+	double endTime;
+} ProfileEvent;
+
+/* Call while no other thread records (before starting / after joining the workers) */
+void Profiler_initialize(size_t capacity = 4096);
+void Profiler_finalize();
+
+/* Seconds on the steady clock (the same as FramePipeline_getTime) */
+double Profiler_getTime();
+void Profiler_record(const char *stage, uint64_t frameId, double beginTime, double endTime);
+/* Name the calling thread in the trace */
+void Profiler_setThreadName(const char *name);
+/* Events lost because the ring was full */
+uint64_t Profiler_getDroppedNum();
+
+/* Take every event recorded so far. Durations go to stats (if not NULL), events to the trace (if open). Returns the number taken */
+size_t Profiler_collect(LatencyStats *stats);
+
+bool Profiler_openTrace(const char *path);
+void Profiler_closeTrace();
+
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(const char *stage, uint64_t frameId = 0) : m_stage(stage), m_frameId(frameId), m_beginTime(Profiler_getTime()) {}
+	~ScopedTimer() { Profiler_record(m_stage, m_frameId, m_beginTime, Profiler_getTime()); }
+	/* e.g. when the id is known only after the work started */
+	void SetFrameId(uint64_t frameId) { m_frameId = frameId; }
+
+private:
+	ScopedTimer(const ScopedTimer&);
+	ScopedTimer& operator=(const ScopedTimer&);
+
+private:
+	const char *m_stage;
+	uint64_t m_frameId;
+	double m_beginTime;
+};
+
+#endif
@@ -0,0 +1,132 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+
+#include "QualityController.h"
+
+/*** Macro ***/
+#define ARRAY_SIZE(a) ((int)(sizeof(a) / sizeof(a[0])))
+
+/*** Global variables ***/
+/* cheapest last. Width first (the cost is roughly proportional to the pixels), then fewer pyramid levels, then fewer frames */
+static const struct {
+	int width;
+	float scaleFactor;
+	int interval;
+} s_detectLadder[] = {
+	{ 640, 1.1f, 1 },
+	{ 480, 1.1f, 1 },
+	{ 480, 1.2f, 1 },
+	{ 320, 1.2f, 1 },
+	{ 320, 1.2f, 2 },
+	{ 320, 1.3f, 2 },
+	{ 240, 1.3f, 3 },
+};
+static const float s_uploadLadder[] = { 1.0f, 0.75f, 0.5f };
+
+/*** Functions ***/
+void QualityController_getDefaultConfig(QualityControllerConfig *config)
+{
+	config->targetFrameTime = 1.0 / 30;
+	config->detectorNum = 1;
+	config->windowFrames = 30;
+	config->degradeMargin = 0.1;
+	config->upgradeMargin = 0.3;
+	config->upgradeWindows = 5;
+	config->maxUpgradeWindows = 80;
+	config->holdWindows = 2;
+}
+
+QualityController::QualityController(const QualityControllerConfig &config)
+	: m_config(config), m_detectLevel(0), m_renderLevel(0), m_detectTimeSum(0), m_detectNum(0), m_renderTimeSum(0), m_frameNum(0),
+	m_goodWindowNum(0), m_holdWindowNum(0), m_upgradeWindows(config.upgradeWindows), m_windowsSinceUpgrade(-1)
+{
+}
+
+QualityLevel QualityController::GetLevel() const
+{
+	QualityLevel level;
+	level.detectWidth = s_detectLadder[m_detectLevel].width;
+	level.scaleFactor = s_detectLadder[m_detectLevel].scaleFactor;
+	level.detectInterval = s_detectLadder[m_detectLevel].interval;
+	level.uploadScale = s_uploadLadder[m_renderLevel];
+	return level;
+}
+
+void QualityController::AddDetectTime(double seconds)
+{
+	m_detectTimeSum += seconds;
+	m_detectNum++;
+}
+
+bool QualityController::AddRenderTime(double seconds)
+{
+	m_renderTimeSum += seconds;
+	if (++m_frameNum < m_config.windowFrames) return false;
+
+	/* a detection serves interval frames, and the workers run in parallel */
+	double detectCost = 0;
+	if (m_detectNum > 0) detectCost = m_detectTimeSum / m_detectNum / (s_detectLadder[m_detectLevel].interval * m_config.detectorNum);
+	double renderCost = m_renderTimeSum / m_frameNum;
+	m_detectTimeSum = m_renderTimeSum = 0;
+	m_detectNum = m_frameNum = 0;
+
+	int detectLevel = m_detectLevel;
+	int renderLevel = m_renderLevel;
+	Decide(detectCost, renderCost);
+	return detectLevel != m_detectLevel || renderLevel != m_renderLevel;
+}
+
+void QualityController::Decide(double detectCost, double renderCost)
+{
+	if (m_windowsSinceUpgrade >= 0) m_windowsSinceUpgrade++;
+	if (m_holdWindowNum > 0) {
+		m_holdWindowNum--;
+		return;
+	}
+
+	const char *action = NULL;
+	if ((std::max)(detectCost, renderCost) > m_config.targetFrameTime * (1 + m_config.degradeMargin)) {
+		/* the bottleneck first, the other stage if the bottleneck is already at its lowest */
+		bool canDegradeDetect = m_detectLevel < ARRAY_SIZE(s_detectLadder) - 1;
+		bool canDegradeRender = m_renderLevel < ARRAY_SIZE(s_uploadLadder) - 1;
+		if (canDegradeDetect && (detectCost >= renderCost || !canDegradeRender)) {
+			m_detectLevel++;
+			action = "degrade detection";
+		} else if (canDegradeRender) {
+			m_renderLevel++;
+			action = "degrade upload";
+		}
+		if (action && m_windowsSinceUpgrade >= 0 && m_windowsSinceUpgrade <= m_config.holdWindows + m_config.upgradeWindows) {
+			m_upgradeWindows = (std::min)(m_upgradeWindows * 2, m_config.maxUpgradeWindows);
+		}
+		m_windowsSinceUpgrade = -1;
+		m_goodWindowNum = 0;
+	} else if ((std::max)(detectCost, renderCost) < m_config.targetFrameTime * (1 - m_config.upgradeMargin)) {
+		if (++m_goodWindowNum >= m_upgradeWindows) {
+			/* the background resolution is the more visible one, so it comes back first */
+			if (m_renderLevel > 0) {
+				m_renderLevel--;
+				action = "upgrade upload";
+			} else if (m_detectLevel > 0) {
+				m_detectLevel--;
+				action = "upgrade detection";
+			}
+			if (action) m_windowsSinceUpgrade = 0;
+			m_goodWindowNum = 0;
+		}
+	} else {
+		/* within the band: keep the level */
+		m_goodWindowNum = 0;
+	}
+
+	if (action) {
+		m_holdWindowNum = m_config.holdWindows;
+		QualityLevel level = GetLevel();
+		printf("quality: %s (detect %.1f ms, render %.1f ms, target %.1f ms) -> detect width %d, scale factor %.2f, interval %d, upload x%.2f\n",
+			action, detectCost * 1000, renderCost * 1000, m_config.targetFrameTime * 1000,
+			level.detectWidth, level.scaleFactor, level.detectInterval, level.uploadScale);
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+typedef struct {
+	double targetFrameTime;   /* seconds per frame to hold (1 / target fps) */
+	int detectorNum;          /* detection workers sharing the detection load */
+	int windowFrames;         /* displayed frames averaged per decision */
+	double degradeMargin;     /* a stage over target * (1 + margin) steps its quality down */
+	double upgradeMargin;     /* every stage under target * (1 - margin) for upgradeWindows windows steps quality up */
+	int upgradeWindows;       /* doubled each time an upgrade has to be taken back soon after (up to maxUpgradeWindows) */
+	int maxUpgradeWindows;
+	int holdWindows;          /* windows ignored after a change, while the pipeline settles */
+} QualityControllerConfig;
+
+void QualityController_getDefaultConfig(QualityControllerConfig *config);
+
+/* Settings to apply to the pipeline */
+typedef struct {
+	int detectWidth;          /* DetectionFrontEnd target width */
+	int detectInterval;       /* detect every N-th frame */
+	float scaleFactor;        /* cascade scaleFactor */
+	float uploadScale;        /* background texture resolution against the camera frame */
+} QualityLevel;
+
+/*
+ * Feedback control of the per-frame cost. Detection cost (per displayed frame, i.e. detection time / interval / workers) and
+ * render cost are averaged over a window and compared with the target frame time. The more expensive stage over budget walks
+ * its own ladder one step down: detection width, scaleFactor and interval, or the background upload resolution.
+ * Stepping up needs a clear margin for several windows, and every change is followed by a hold. An upgrade that is undone
+ * right away makes the next one wait twice as long, so a level just above the budget is not retried forever.
+ * Decisions are logged. Feed and read it from the render thread.
+ */
+class QualityController
+{
+public:
+	explicit QualityController(const QualityControllerConfig &config);
+	/* per detection result received */
+	void AddDetectTime(double seconds);
+	/* per displayed frame, CPU time of the render loop excluding the swap wait. Returns true if the level changed */
+	bool AddRenderTime(double seconds);
+	QualityLevel GetLevel() const;
+
+private:
+	void Decide(double detectCost, double renderCost);
+
+private:
+	QualityControllerConfig m_config;
+	int m_detectLevel;        /* index into the ladders, 0 = best quality */
+	int m_renderLevel;
+	double m_detectTimeSum;
+	int m_detectNum;
+	double m_renderTimeSum;
+	int m_frameNum;
+	int m_goodWindowNum;
+	int m_holdWindowNum;
+	int m_upgradeWindows;
+	int m_windowsSinceUpgrade;   /* -1: no upgrade yet */
+};
+
+#endif
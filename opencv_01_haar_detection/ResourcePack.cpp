@@ -0,0 +1,224 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "MappedFile.h"
+#include "LzCodec.h"
+#include "ResourcePack.h"
+
+/*** Macro ***/
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+/* offsets in the header */
+#define HEADER_VERSION         4
+#define HEADER_ENTRY_NUM       8
+#define HEADER_BUCKET_NUM     12
+#define HEADER_ENTRIES_OFFSET 16
+#define HEADER_BUCKETS_OFFSET 24
+#define HEADER_NAMES_OFFSET   32
+#define HEADER_NAMES_SIZE     40
+
+/* offsets in an entry */
+#define ENTRY_NAME_HASH    0
+#define ENTRY_OFFSET       8
+#define ENTRY_STORED_SIZE 16
+#define ENTRY_SIZE        24
+#define ENTRY_NAME_OFFSET 32
+#define ENTRY_NAME_LENGTH 36
+#define ENTRY_FLAGS       40
+
+/*** Global variables ***/
+static ResourcePack s_pack;
+
+/*** Functions ***/
+static inline uint32_t readU32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t readU64(const uint8_t *p)
+{
+	return readU32(p) | ((uint64_t)readU32(p + 4) << 32);
+}
+
+/* FNV-1a */
+uint64_t ResourcePack_hashName(const std::string &name)
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < name.size(); i++) {
+		hash ^= (uint8_t)name[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+/* "./resource\\a.xml" -> "resource/a.xml" */
+std::string ResourcePack_normalizeName(const char *name)
+{
+	std::string ret(name);
+	for (size_t i = 0; i < ret.size(); i++) {
+		if (ret[i] == '\\') ret[i] = '/';
+	}
+	while (ret.compare(0, 2, "./") == 0) ret.erase(0, 2);
+	return ret;
+}
+
+ResourcePack::ResourcePack()
+	: m_entryNum(0), m_bucketNum(0), m_entries(NULL), m_buckets(NULL), m_names(NULL), m_namesSize(0)
+{
+}
+
+ResourcePack::~ResourcePack()
+{
+	Close();
+}
+
+bool ResourcePack::Open(const char *path)
+{
+	Close();
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->Open(path)) return false;
+	const uint8_t *data = file->Data();
+	uint64_t size = file->Size();
+	if (size < RESOURCE_PACK_HEADER_SIZE || memcmp(data, RESOURCE_PACK_MAGIC, 4) != 0 || readU32(data + HEADER_VERSION) != RESOURCE_PACK_VERSION) {
+		printf("%s is not a resource pack\n", path);
+		return false;
+	}
+
+	uint32_t entryNum = readU32(data + HEADER_ENTRY_NUM);
+	uint32_t bucketNum = readU32(data + HEADER_BUCKET_NUM);
+	uint64_t entriesOffset = readU64(data + HEADER_ENTRIES_OFFSET);
+	uint64_t bucketsOffset = readU64(data + HEADER_BUCKETS_OFFSET);
+	uint64_t namesOffset = readU64(data + HEADER_NAMES_OFFSET);
+	uint64_t namesSize = readU64(data + HEADER_NAMES_SIZE);
+	if (bucketNum == 0 || (bucketNum & (bucketNum - 1)) != 0 || bucketNum < entryNum
+		|| entriesOffset > size || (uint64_t)entryNum * RESOURCE_PACK_ENTRY_SIZE > size - entriesOffset
+		|| bucketsOffset > size || (uint64_t)bucketNum * 4 > size - bucketsOffset
+		|| namesOffset > size || namesSize > size - namesOffset) {
+		printf("%s has a broken table of contents\n", path);
+		return false;
+	}
+
+	/* Validate every entry once so that lookups don't need to */
+	for (uint32_t i = 0; i < entryNum; i++) {
+		const uint8_t *entry = data + entriesOffset + (uint64_t)i * RESOURCE_PACK_ENTRY_SIZE;
+		uint64_t offset = readU64(entry + ENTRY_OFFSET);
+		uint64_t storedSize = readU64(entry + ENTRY_STORED_SIZE);
+		uint64_t nameOffset = readU32(entry + ENTRY_NAME_OFFSET);
+		uint64_t nameLength = readU32(entry + ENTRY_NAME_LENGTH);
+		/* a compressed entry is allocated at its original size when read: bound it by what its data can decode to */
+		bool isCompressed = (readU32(entry + ENTRY_FLAGS) & RESOURCE_PACK_FLAG_COMPRESSED) != 0;
+		if (offset > size || storedSize > size - offset || nameOffset + nameLength > namesSize
+			|| (isCompressed && readU64(entry + ENTRY_SIZE) > LzCodec_getMaxDecompressedSize(storedSize))) {
+			printf("%s has a broken entry (%u)\n", path, i);
+			return false;
+		}
+	}
+
+	m_file = file;
+	m_entryNum = entryNum;
+	m_bucketNum = bucketNum;
+	m_entries = data + entriesOffset;
+	m_buckets = data + bucketsOffset;
+	m_names = data + namesOffset;
+	m_namesSize = namesSize;
+	return true;
+}
+
+void ResourcePack::Close()
+{
+	/* views still referring to the mapping keep it alive */
+	m_file.reset();
+	m_entryNum = 0;
+	m_bucketNum = 0;
+	m_entries = NULL;
+	m_buckets = NULL;
+	m_names = NULL;
+	m_namesSize = 0;
+}
+
+const uint8_t *ResourcePack::FindEntry(const std::string &name) const
+{
+	if (!m_file) return NULL;
+	uint64_t hash = ResourcePack_hashName(name);
+	uint32_t mask = m_bucketNum - 1;
+	for (uint32_t probe = 0, bucket = (uint32_t)hash & mask; probe < m_bucketNum; probe++, bucket = (bucket + 1) & mask) {
+		uint32_t index = readU32(m_buckets + bucket * 4);
+		if (index == 0 || index > m_entryNum) return NULL;
+		const uint8_t *entry = m_entries + (size_t)(index - 1) * RESOURCE_PACK_ENTRY_SIZE;
+		if (readU64(entry + ENTRY_NAME_HASH) != hash) continue;
+		uint32_t nameLength = readU32(entry + ENTRY_NAME_LENGTH);
+		if (nameLength == name.size() && memcmp(m_names + readU32(entry + ENTRY_NAME_OFFSET), name.data(), nameLength) == 0) return entry;
+	}
+	return NULL;
+}
+
+bool ResourcePack::Contains(const char *name) const
+{
+	return FindEntry(ResourcePack_normalizeName(name)) != NULL;
+}
+
+bool ResourcePack::Read(const char *name, ResourceView *view) const
+{
+	const uint8_t *entry = FindEntry(ResourcePack_normalizeName(name));
+	if (entry == NULL) return false;
+	const uint8_t *stored = m_file->Data() + readU64(entry + ENTRY_OFFSET);
+	size_t storedSize = (size_t)readU64(entry + ENTRY_STORED_SIZE);
+	size_t size = (size_t)readU64(entry + ENTRY_SIZE);
+
+	if ((readU32(entry + ENTRY_FLAGS) & RESOURCE_PACK_FLAG_COMPRESSED) == 0) {
+		view->data = stored;
+		view->size = storedSize;
+		view->holder = m_file;
+	} else {
+		std::shared_ptr<std::vector<uint8_t> > buffer = std::make_shared<std::vector<uint8_t> >(size);
+		if (!LzCodec_decompress(stored, storedSize, buffer->data(), size)) {
+			printf("%s is broken in the resource pack\n", name);
+			return false;
+		}
+		view->data = buffer->data();
+		view->size = size;
+		view->holder = buffer;
+	}
+	view->fromPack = true;
+	return true;
+}
+
+bool Resource_openPack(const char *path)
+{
+	if (!s_pack.Open(path)) return false;
+	printf("Resource pack %s: %d entries\n", path, s_pack.GetEntryNum());
+	return true;
+}
+
+void Resource_closePack()
+{
+	s_pack.Close();
+}
+
+bool Resource_isInPack(const char *name)
+{
+	return s_pack.Contains(name);
+}
+
+bool Resource_read(const char *name, ResourceView *view)
+{
+	if (s_pack.Read(name, view)) return true;
+
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->Open(name)) {
+		printf("Impossible to open %s\n", name);
+		return false;
+	}
+	view->data = file->Data();
+	view->size = file->Size();
+	view->fromPack = false;
+	view->holder = file;
+	return true;
+}
@@ -0,0 +1,72 @@
+#ifndef RESOURCE_PACK_H
+#define RESOURCE_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <memory>
+
+class MappedFile;
+
+/*
+ * Pack file layout (little endian)
+ *   header  : "RPAK", version, entryNum, bucketNum, entriesOffset(u64), bucketsOffset(u64), namesOffset(u64), namesSize(u64)
+ *   entries : nameHash(u64), offset(u64), storedSize(u64), size(u64), nameOffset, nameLength, flags, reserved
+ *   buckets : open addressing table (power of 2, linear probing) of entry index + 1 (0: empty), keyed by FNV-1a of the name
+ *   names   : concatenated entry names ("resource/xxx")
+ *   data    : entry payloads, each aligned to RESOURCE_PACK_ALIGNMENT
+ */
+#define RESOURCE_PACK_MAGIC           "RPAK"
+#define RESOURCE_PACK_VERSION         1
+#define RESOURCE_PACK_HEADER_SIZE     48
+#define RESOURCE_PACK_ENTRY_SIZE      48
+#define RESOURCE_PACK_ALIGNMENT       64
+#define RESOURCE_PACK_FLAG_COMPRESSED 0x1   /* payload is LzCodec compressed */
+
+/* Read-only view of a resource. holder keeps the memory alive (the pack mapping, a decompressed copy or a loose file mapping) */
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+	bool fromPack;
+	std::shared_ptr<const void> holder;
+} ResourceView;
+
+class ResourcePack
+{
+public:
+	ResourcePack();
+	~ResourcePack();
+	bool Open(const char *path);
+	void Close();
+	bool IsOpen() const { return m_file != NULL; }
+	int GetEntryNum() const { return (int)m_entryNum; }
+	bool Contains(const char *name) const;
+	/* Stored entries are served zero-copy from the mapping, compressed entries are decoded into a new buffer */
+	bool Read(const char *name, ResourceView *view) const;
+
+private:
+	ResourcePack(const ResourcePack&);
+	ResourcePack& operator=(const ResourcePack&);
+	const uint8_t *FindEntry(const std::string &name) const;
+
+private:
+	std::shared_ptr<MappedFile> m_file;
+	uint32_t m_entryNum;
+	uint32_t m_bucketNum;
+	const uint8_t *m_entries;
+	const uint8_t *m_buckets;
+	const uint8_t *m_names;
+	uint64_t m_namesSize;
+};
+
+uint64_t ResourcePack_hashName(const std::string &name);
+std::string ResourcePack_normalizeName(const char *name);
+
+/* Process-wide resource access used by the loaders: the opened pack first, then the loose file.
+ * Open / close the pack before / after any loader runs; Resource_read itself is thread safe */
+bool Resource_openPack(const char *path);
+void Resource_closePack();
+bool Resource_isInPack(const char *name);
+bool Resource_read(const char *name, ResourceView *view);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+/* Bounded lock-free queue (Vyukov's MPMC ring). Any number of producers / consumers, never blocks.
+ * T must be default constructible and movable */
+template <typename T>
+class RingQueue
+{
+public:
+	explicit RingQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity) size <<= 1;
+		m_mask = size - 1;
+		m_cells.reset(new Cell[size]);
+		for (size_t i = 0; i < size; i++) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		m_enqueuePos.store(0, std::memory_order_relaxed);
+		m_dequeuePos.store(0, std::memory_order_relaxed);
+	}
+
+	size_t GetCapacity() const { return m_mask + 1; }
+	/* a snapshot: may be stale as soon as it returns */
+	bool IsEmpty() const { return m_enqueuePos.load(std::memory_order_acquire) == m_dequeuePos.load(std::memory_order_acquire); }
+
+	/* false if full (the value is left untouched then) */
+	bool TryPush(const T &value)
+	{
+		Cell *cell = ReserveForPush();
+		if (cell == NULL) return false;
+		cell->data = value;
+		cell->sequence.store(cell->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool TryPush(T &&value)
+	{
+		Cell *cell = ReserveForPush();
+		if (cell == NULL) return false;
+		cell->data = std::move(value);
+		cell->sequence.store(cell->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* false if empty */
+	bool TryPop(T &value)
+	{
+		Cell *cell;
+		size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+		while (true) {
+			cell = &m_cells[pos & m_mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+			if (diff == 0) {
+				if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = m_dequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+		value = std::move(cell->data);
+		cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	RingQueue(const RingQueue&);
+	RingQueue& operator=(const RingQueue&);
+
+	typedef struct {
+		std::atomic<size_t> sequence;
+		T data;
+	} Cell;
+
+	/* Claim the cell at the enqueue position. Its sequence stays at pos until the data is written */
+	Cell *ReserveForPush()
+	{
+		size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+		while (true) {
+			Cell *cell = &m_cells[pos & m_mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+			if (diff == 0) {
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return cell;
+			} else if (diff < 0) {
+				return NULL;
+			} else {
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask;
+	/* producers and consumers on separate cache lines (padding rather than alignas: no over-aligned new in C++11) */
+	char m_padding0[64];
+	std::atomic<size_t> m_enqueuePos;
+	char m_padding1[64];
+	std::atomic<size_t> m_dequeuePos;
+	char m_padding2[64];
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SHARED_FRAME_H
+#define SHARED_FRAME_H
+
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Shared memory frame ring (POSIX shm_open "/name", Windows "Local\name"). One writer, any number of readers
+ *   header       : SharedFrameHeader (64 bytes)
+ *   slot headers : SharedFrameSlot (64 bytes) x slotNum
+ *   slot data    : from dataOffset, slotSize bytes each (aligned to SHARED_FRAME_ALIGNMENT)
+ * Frame n (1, 2, ...) goes to a free slot under a per slot seqlock: lock is 2n + 1 while the slot is written
+ * and 2n + 2 once it is published, then latestSequence becomes n. Readers find it by scanning the slot locks.
+ * The writer never waits for readers. Readers either:
+ *  - only read: they check the lock again after using the pixels to know they were not overwritten meanwhile
+ *  - hold the slot (zero copy): count the hold in the slot's holder entry of its process, then the lock must still be 2n + 2.
+ *    The writer makes the lock odd, then checks the holder entries and gives a held slot up (lock restored).
+ *    Both sides are sequentially consistent, so one always sees the other
+ * The writer skips held slots and the latest one. With all of them held, the new frame is dropped: the latest frame wins,
+ * so a holding reader needs more slots than the frames it keeps at once.
+ * Holder entries carry the reader's pid, so the writer takes back the holds of a reader that died (pids of the same namespace)
+ */
+#define SHARED_FRAME_MAGIC      "SFRM"
+#define SHARED_FRAME_VERSION    3
+#define SHARED_FRAME_ALIGNMENT  64
+#define SHARED_FRAME_MAX_HOLDERS 3   /* processes holding one slot at once */
+
+typedef enum {
+	SHARED_FRAME_FORMAT_BGRA = 1,   /* 8 bit, top row first */
+	SHARED_FRAME_FORMAT_BGR  = 2,
+	SHARED_FRAME_FORMAT_YUYV = 3,   /* Y0 U Y1 V, even width */
+	SHARED_FRAME_FORMAT_NV12 = 4,   /* Y plane, then the interleaved UV plane (same stride). Even width and height */
+	SHARED_FRAME_FORMAT_I420 = 5,   /* Y plane, then the U and V planes (stride / 2). Even width, height and stride */
+} SharedFrameFormat;
+
+typedef struct {
+	char magic[4];                          /* written last by the writer: the ring is ready */
+	uint32_t version;
+	uint32_t slotNum;
+	uint32_t maxWidth;
+	uint32_t maxHeight;
+	uint32_t writerPid;
+	uint64_t dataOffset;
+	uint64_t slotSize;
+	std::atomic<uint64_t> latestSequence;   /* 0: nothing published yet */
+	std::atomic<uint32_t> isClosed;         /* the writer has stopped (a restarted writer makes a new ring) */
+	uint32_t reserved[3];
+} SharedFrameHeader;
+
+typedef struct {
+	std::atomic<uint64_t> lock;
+	uint64_t frameId;                       /* of the renderer (first stream's capture frame, 0 if none) */
+	uint64_t timestampNs;                   /* steady clock (CLOCK_MONOTONIC on Linux), comparable across processes */
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;                        /* in bytes */
+	uint32_t format;                        /* SharedFrameFormat */
+	/* readers using the pixels in place (the writer leaves the slot alone): pid << 32 | holds of that process, 0 if free */
+	std::atomic<uint64_t> holders[SHARED_FRAME_MAX_HOLDERS];
+} SharedFrameSlot;
+
+static_assert(sizeof(SharedFrameHeader) == 64 && sizeof(SharedFrameSlot) == 64, "shared frame headers must be 64 bytes");
+
+/* Bytes of pixels in one row (of the Y plane for planar formats), 0 for an unknown format */
+static inline int SharedFrameFormat_getRowSize(uint32_t format, int width)
+{
+	switch (format) {
+	case SHARED_FRAME_FORMAT_BGRA: return width * 4;
+	case SHARED_FRAME_FORMAT_BGR:  return width * 3;
+	case SHARED_FRAME_FORMAT_YUYV: return width * 2;
+	case SHARED_FRAME_FORMAT_NV12:
+	case SHARED_FRAME_FORMAT_I420: return width;
+	default: return 0;
+	}
+}
+
+/* Bytes a frame takes in a slot (chroma planes included) */
+static inline uint64_t SharedFrameFormat_getDataSize(uint32_t format, int stride, int height)
+{
+	if (format == SHARED_FRAME_FORMAT_NV12 || format == SHARED_FRAME_FORMAT_I420) return (uint64_t)stride * height * 3 / 2;
+	return (uint64_t)stride * height;
+}
+
+#endif
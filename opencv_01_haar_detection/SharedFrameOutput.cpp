@@ -0,0 +1,224 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <atomic>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+#include "SharedFrame.h"
+#include "SharedFrameOutput.h"
+
+/*** Functions ***/
+/* Only a process known to be gone counts as dead (one of another user is alive) */
+static bool isProcessAlive(uint32_t pid)
+{
+#ifdef _WIN32
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+	if (process == NULL) return GetLastError() == ERROR_ACCESS_DENIED;
+	bool isAlive = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+	CloseHandle(process);
+	return isAlive;
+#else
+	return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+#endif
+}
+
+SharedFrameOutput::SharedFrameOutput()
+	: m_base(NULL), m_size(0), m_header(NULL), m_slots(NULL), m_sequence(0), m_droppedNum(0), m_nextIndex(0), m_latestIndex(-1)
+#ifdef _WIN32
+	, m_mappingHandle(NULL)
+#endif
+{
+}
+
+SharedFrameOutput::~SharedFrameOutput()
+{
+	Close();
+}
+
+bool SharedFrameOutput::Open(const char *name, int maxWidth, int maxHeight, int slotNum, size_t slotSize)
+{
+	Close();
+	if (maxWidth <= 0 || maxHeight <= 0 || slotNum < 2) return false;
+	if (slotSize == 0) slotSize = (size_t)maxWidth * maxHeight * 4;
+	slotSize = (slotSize + SHARED_FRAME_ALIGNMENT - 1) & ~(size_t)(SHARED_FRAME_ALIGNMENT - 1);
+	uint64_t dataOffset = sizeof(SharedFrameHeader) + (uint64_t)slotNum * sizeof(SharedFrameSlot);
+	dataOffset = (dataOffset + SHARED_FRAME_ALIGNMENT - 1) & ~(uint64_t)(SHARED_FRAME_ALIGNMENT - 1);
+	size_t size = (size_t)(dataOffset + slotSize * slotNum);
+
+#ifdef _WIN32
+	m_name = std::string("Local\\") + name;
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, m_name.c_str());
+	if (mapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS) {
+		printf("Impossible to create the shared memory %s\n", m_name.c_str());
+		if (mapping) CloseHandle(mapping);
+		return false;
+	}
+	void *view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+	if (view == NULL) {
+		printf("Impossible to map the shared memory %s\n", m_name.c_str());
+		CloseHandle(mapping);
+		return false;
+	}
+	m_mappingHandle = mapping;
+	uint32_t pid = (uint32_t)GetCurrentProcessId();
+#else
+	/* a ring left by a writer that died is replaced (its readers keep the old one until they attach again) */
+	m_name = (name[0] == '/') ? name : std::string("/") + name;
+	shm_unlink(m_name.c_str());
+	int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) {
+		printf("Impossible to create the shared memory %s\n", m_name.c_str());
+		return false;
+	}
+	void *view = MAP_FAILED;
+	if (ftruncate(fd, (off_t)size) == 0) view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) {
+		printf("Impossible to map the shared memory %s\n", m_name.c_str());
+		shm_unlink(m_name.c_str());
+		return false;
+	}
+	uint32_t pid = (uint32_t)getpid();
+#endif
+
+	/* New memory is zero: every lock is 0 (nothing published) and nothing is held */
+	m_base = static_cast<uint8_t*>(view);
+	m_size = size;
+	m_header = reinterpret_cast<SharedFrameHeader*>(m_base);
+	m_slots = reinterpret_cast<SharedFrameSlot*>(m_base + sizeof(SharedFrameHeader));
+	m_header->version = SHARED_FRAME_VERSION;
+	m_header->slotNum = (uint32_t)slotNum;
+	m_header->maxWidth = (uint32_t)maxWidth;
+	m_header->maxHeight = (uint32_t)maxHeight;
+	m_header->writerPid = pid;
+	m_header->dataOffset = dataOffset;
+	m_header->slotSize = slotSize;
+	m_header->latestSequence.store(0, std::memory_order_relaxed);
+	m_header->isClosed.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(m_header->magic, SHARED_FRAME_MAGIC, 4);
+	m_sequence = 0;
+	m_droppedNum = 0;
+	m_nextIndex = 0;
+	m_latestIndex = -1;
+	return true;
+}
+
+void SharedFrameOutput::Close()
+{
+	if (m_header) m_header->isClosed.store(1, std::memory_order_release);
+#ifdef _WIN32
+	if (m_base) UnmapViewOfFile(m_base);
+	if (m_mappingHandle) CloseHandle(m_mappingHandle);
+	m_mappingHandle = NULL;
+#else
+	if (m_base) {
+		munmap(m_base, m_size);
+		shm_unlink(m_name.c_str());
+	}
+#endif
+	m_base = NULL;
+	m_size = 0;
+	m_header = NULL;
+	m_slots = NULL;
+}
+
+int SharedFrameOutput::BeginWrite(uint64_t sequence)
+{
+	int slotNum = (int)m_header->slotNum;
+	for (int i = 0; i < slotNum; i++) {
+		/* the latest frame stays readable until a newer one is published */
+		int index = (m_nextIndex + i) % slotNum;
+		if (index == m_latestIndex) continue;
+		SharedFrameSlot &slot = m_slots[index];
+		/* seqlock: odd while written, so a reader still on this slot's previous frame sees it is gone.
+		 * Then the hold check: a reader holding it has either already counted itself (seen here), or will see the odd lock */
+		uint64_t previousLock = slot.lock.load(std::memory_order_relaxed);
+		slot.lock.store(2 * sequence + 1, std::memory_order_seq_cst);
+		if (IsHeld(slot)) {
+			slot.lock.store(previousLock, std::memory_order_seq_cst);
+			continue;
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		m_nextIndex = (index + 1) % slotNum;
+		return index;
+	}
+	m_droppedNum++;
+	return -1;
+}
+
+bool SharedFrameOutput::IsHeld(SharedFrameSlot &slot)
+{
+	bool isHeld = false;
+	for (int i = 0; i < SHARED_FRAME_MAX_HOLDERS; i++) {
+		uint64_t holder = slot.holders[i].load(std::memory_order_seq_cst);
+		if (holder == 0) continue;
+		uint32_t pid = (uint32_t)(holder >> 32);
+		/* a dead process can't change its entry any more, so the swap only fails if it was not dead after all */
+		if (!isProcessAlive(pid) && slot.holders[i].compare_exchange_strong(holder, 0, std::memory_order_seq_cst)) {
+			printf("took back %d holds of reader %u (exited)\n", (int)(uint32_t)holder, pid);
+			continue;
+		}
+		isHeld = true;
+	}
+	return isHeld;
+}
+
+void SharedFrameOutput::EndWrite(int index, uint64_t sequence, int width, int height, int stride, SharedFrameFormat format, uint64_t frameId, uint64_t timestampNs)
+{
+	SharedFrameSlot &slot = m_slots[index];
+	slot.frameId = frameId;
+	slot.timestampNs = timestampNs;
+	slot.width = (uint32_t)width;
+	slot.height = (uint32_t)height;
+	slot.stride = (uint32_t)stride;
+	slot.format = format;
+	slot.lock.store(2 * sequence + 2, std::memory_order_release);
+	m_header->latestSequence.store(sequence, std::memory_order_release);
+	m_latestIndex = index;
+	m_sequence = sequence;
+}
+
+bool SharedFrameOutput::Publish(const uint8_t *data, int width, int height, int stride, uint64_t frameId, uint64_t timestampNs)
+{
+	if (m_header == NULL || width > (int)m_header->maxWidth || height > (int)m_header->maxHeight) return false;
+	size_t rowSize = (size_t)width * 4;
+	if ((uint64_t)rowSize * height > m_header->slotSize) return false;
+	uint64_t sequence = m_sequence + 1;
+	int index = BeginWrite(sequence);
+	if (index < 0) return false;
+	uint8_t *dst = m_base + m_header->dataOffset + index * m_header->slotSize;
+	for (int y = 0; y < height; y++) memcpy(dst + rowSize * y, data + (size_t)stride * (height - 1 - y), rowSize);
+	EndWrite(index, sequence, width, height, (int)rowSize, SHARED_FRAME_FORMAT_BGRA, frameId, timestampNs);
+	return true;
+}
+
+bool SharedFrameOutput::Write(const uint8_t *data, int width, int height, int stride, SharedFrameFormat format, uint64_t frameId, uint64_t timestampNs)
+{
+	if (m_header == NULL || width > (int)m_header->maxWidth || height > (int)m_header->maxHeight) return false;
+	int rowSize = SharedFrameFormat_getRowSize(format, width);
+	uint64_t dataSize = SharedFrameFormat_getDataSize(format, stride, height);
+	if (rowSize <= 0 || stride < rowSize || dataSize > m_header->slotSize) return false;
+	if (format != SHARED_FRAME_FORMAT_BGRA && format != SHARED_FRAME_FORMAT_BGR && (width % 2 != 0)) return false;
+	if ((format == SHARED_FRAME_FORMAT_NV12 || format == SHARED_FRAME_FORMAT_I420) && height % 2 != 0) return false;
+	if (format == SHARED_FRAME_FORMAT_I420 && stride % 2 != 0) return false;
+	uint64_t sequence = m_sequence + 1;
+	int index = BeginWrite(sequence);
+	if (index < 0) return false;
+	/* the whole block at once: the slot has the same layout as the source */
+	memcpy(m_base + m_header->dataOffset + index * m_header->slotSize, data, (size_t)dataSize);
+	EndWrite(index, sequence, width, height, stride, format, frameId, timestampNs);
+	return true;
+}
@@ -0,0 +1,57 @@
+#ifndef SHARED_FRAME_OUTPUT_H
+#define SHARED_FRAME_OUTPUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "SharedFrame.h"
+
+/*
+ * Writer side of the shared memory frame ring (see SharedFrame.h): every read back frame is copied once, straight from the
+ * mapped pack buffer into a free slot (rows flipped to top first). Other producers write frames of any SharedFrameFormat.
+ * Consumers attach with SharedFrameReader. The ring is recreated by Open, and removed by Close
+ * (readers still attached keep their mapping and see isClosed)
+ */
+class SharedFrameOutput
+{
+public:
+	SharedFrameOutput();
+	~SharedFrameOutput();
+	/* Frames up to maxWidth x maxHeight, slotSize bytes each (0: BGRA without row padding) */
+	bool Open(const char *name, int maxWidth, int maxHeight, int slotNum, size_t slotSize = 0);
+	void Close();
+	bool IsOpen() const { return m_header != NULL; }
+	/* BGRA bottom row first, as read back (FrameReadback), written top row first. false if larger than the slots, or dropped */
+	bool Publish(const uint8_t *data, int width, int height, int stride, uint64_t frameId, uint64_t timestampNs);
+	/* Frame top row first, SharedFrameFormat_getDataSize bytes copied as they are (row padding kept, see SharedFrameFormat for the planes).
+	 * false if it doesn't fit in a slot, or if every slot is held by readers (dropped) */
+	bool Write(const uint8_t *data, int width, int height, int stride, SharedFrameFormat format, uint64_t frameId, uint64_t timestampNs);
+	uint64_t GetPublishedNum() const { return m_sequence; }
+	uint64_t GetDroppedNum() const { return m_droppedNum; }
+
+private:
+	SharedFrameOutput(const SharedFrameOutput&);
+	SharedFrameOutput& operator=(const SharedFrameOutput&);
+	/* Slot for frame sequence, made odd (being written). -1 if all are held */
+	int BeginWrite(uint64_t sequence);
+	void EndWrite(int index, uint64_t sequence, int width, int height, int stride, SharedFrameFormat format, uint64_t frameId, uint64_t timestampNs);
+	/* Some live reader holds the slot. Holds of readers that died are taken back */
+	bool IsHeld(SharedFrameSlot &slot);
+
+private:
+	std::string m_name;
+	uint8_t *m_base;
+	size_t m_size;
+	SharedFrameHeader *m_header;
+	SharedFrameSlot *m_slots;
+	uint64_t m_sequence;
+	uint64_t m_droppedNum;
+	int m_nextIndex;
+	int m_latestIndex;
+#ifdef _WIN32
+	void *m_mappingHandle;
+#endif
+};
+
+#endif
@@ -0,0 +1,229 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "FrameSource.h"
+#include "SharedFrameOutput.h"
+
+/*** Macro ***/
+#define DEFAULT_WIDTH 1280
+#define DEFAULT_HEIGHT 720
+#define DEFAULT_SLOT_NUM 8
+#define DEFAULT_OFFLINE_FPS 30.0
+#define REPORT_INTERVAL_SEC 1.0
+
+/*** Global variables ***/
+static volatile sig_atomic_t s_isStopped = 0;
+
+/*** Function ***/
+static void onSignal(int)
+{
+	s_isStopped = 1;
+}
+
+static uint64_t getSteadyTimeNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void printUsage(const char *name)
+{
+	printf("usage: %s <name> <source> [options]\n", name);
+	printf("  source                as the renderer's --source (camera[:index], video:<path>, images:<dir>, synthetic[:WxH[:frames]])\n");
+	printf("  --format FORMAT       bgr (default), bgra, yuyv, nv12 or i420\n");
+	printf("  --stride-align N      pad rows to a multiple of N bytes (default 1: no padding)\n");
+	printf("  --fps FPS             frame rate (default: as captured for cameras, %.0f otherwise. 0: as fast as possible)\n", DEFAULT_OFFLINE_FPS);
+	printf("  --slots N             ring slots (default %d). A zero copy consumer holds several at once\n", DEFAULT_SLOT_NUM);
+	printf("  --frames N            stop after N frames (default: end of the source)\n");
+}
+
+static bool parseFormat(const std::string &name, SharedFrameFormat *format)
+{
+	static const char *NAMES[] = { "bgra", "bgr", "yuyv", "nv12", "i420" };
+	static const SharedFrameFormat FORMATS[] = { SHARED_FRAME_FORMAT_BGRA, SHARED_FRAME_FORMAT_BGR, SHARED_FRAME_FORMAT_YUYV, SHARED_FRAME_FORMAT_NV12, SHARED_FRAME_FORMAT_I420 };
+	for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+		if (name == NAMES[i]) {
+			*format = FORMATS[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Rows of src into dst at dstStride */
+static void copyRows(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride, size_t rowSize, int rowNum)
+{
+	for (int y = 0; y < rowNum; y++) memcpy(dst + dstStride * y, src + srcStride * y, rowSize);
+}
+
+/* BGR frame into buffer in the ring layout of format (see SharedFrameFormat), rows stride bytes apart */
+static void convertFrame(const cv::Mat &bgr, SharedFrameFormat format, int stride, std::vector<uint8_t> &buffer, cv::Mat &work)
+{
+	int width = bgr.cols;
+	int height = bgr.rows;
+	buffer.resize((size_t)SharedFrameFormat_getDataSize(format, stride, height));
+	uint8_t *dst = &buffer[0];
+	if (format == SHARED_FRAME_FORMAT_BGR) {
+		copyRows(bgr.data, bgr.step, dst, stride, (size_t)width * 3, height);
+		return;
+	}
+	if (format == SHARED_FRAME_FORMAT_BGRA) {
+		cv::cvtColor(bgr, work, cv::COLOR_BGR2BGRA);
+		copyRows(work.data, work.step, dst, stride, (size_t)width * 4, height);
+		return;
+	}
+
+	/* the YUV formats are made from I420: Y plane, then U and V planes of (width / 2) x (height / 2) */
+	cv::cvtColor(bgr, work, cv::COLOR_BGR2YUV_I420);
+	const uint8_t *y = work.data;
+	const uint8_t *u = y + (size_t)width * height;
+	const uint8_t *v = u + (size_t)width / 2 * height / 2;
+	size_t chromaWidth = (size_t)width / 2;
+	if (format == SHARED_FRAME_FORMAT_I420) {
+		copyRows(y, width, dst, stride, width, height);
+		copyRows(u, chromaWidth, dst + (size_t)stride * height, stride / 2, chromaWidth, height / 2);
+		copyRows(v, chromaWidth, dst + (size_t)stride * height + (size_t)stride / 2 * height / 2, stride / 2, chromaWidth, height / 2);
+	} else if (format == SHARED_FRAME_FORMAT_NV12) {
+		copyRows(y, width, dst, stride, width, height);
+		for (int row = 0; row < height / 2; row++) {
+			uint8_t *uv = dst + (size_t)stride * (height + row);
+			for (size_t x = 0; x < chromaWidth; x++) {
+				uv[2 * x + 0] = u[chromaWidth * row + x];
+				uv[2 * x + 1] = v[chromaWidth * row + x];
+			}
+		}
+	} else {
+		/* YUYV: 4:2:2, each chroma row of the 4:2:0 planes is used for two rows */
+		for (int row = 0; row < height; row++) {
+			uint8_t *p = dst + (size_t)stride * row;
+			const uint8_t *yRow = y + (size_t)width * row;
+			const uint8_t *uRow = u + chromaWidth * (row / 2);
+			const uint8_t *vRow = v + chromaWidth * (row / 2);
+			for (size_t x = 0; x < chromaWidth; x++) {
+				p[4 * x + 0] = yRow[2 * x + 0];
+				p[4 * x + 1] = uRow[x];
+				p[4 * x + 2] = yRow[2 * x + 1];
+				p[4 * x + 3] = vRow[x];
+			}
+		}
+	}
+}
+
+/* Example producer: writes the frames of any frame source into a shared memory ring, in the given layout,
+ * for the renderer's "shm:<name>" source (or shm_frame_reader). The newest frame wins: a frame is dropped, never waited for,
+ * when every slot is held by consumers */
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	const char *name = argv[1];
+	std::string sourceSpec = argv[2];
+	SharedFrameFormat format = SHARED_FRAME_FORMAT_BGR;
+	int strideAlign = 1;
+	double fps = -1;
+	int slotNum = DEFAULT_SLOT_NUM;
+	int frameNum = 0;
+	for (int i = 3; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc) {
+			if (!parseFormat(argv[++i], &format)) {
+				printf("Unknown format %s\n", argv[i]);
+				return 1;
+			}
+		} else if (arg == "--stride-align" && i + 1 < argc) {
+			strideAlign = (std::max)(1, atoi(argv[++i]));
+		} else if (arg == "--fps" && i + 1 < argc) {
+			fps = atof(argv[++i]);
+		} else if (arg == "--slots" && i + 1 < argc) {
+			slotNum = atoi(argv[++i]);
+		} else if (arg == "--frames" && i + 1 < argc) {
+			frameNum = atoi(argv[++i]);
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::unique_ptr<FrameSource> source = FrameSource_create(sourceSpec, DEFAULT_WIDTH, DEFAULT_HEIGHT);
+	if (!source) return 1;
+	if (fps < 0) fps = source->IsLive() ? 0 : DEFAULT_OFFLINE_FPS;
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	SharedFrameOutput output;
+	cv::Mat image;
+	cv::Mat bgr;
+	cv::Mat work;
+	std::vector<uint8_t> buffer;
+	int width = 0;
+	int height = 0;
+	int stride = 0;
+	uint64_t frameId = 0;
+	uint64_t reportedNum = 0;
+	std::chrono::steady_clock::time_point nextTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point reportTime = nextTime;
+	while (!s_isStopped && (frameNum == 0 || (int)frameId < frameNum)) {
+		if (!source->Read(image) || image.empty()) {
+			if (source->IsLive()) continue;
+			break;
+		}
+		switch (source->GetFormat()) {
+		case FRAME_FORMAT_BGR:  bgr = image; break;
+		case FRAME_FORMAT_YUYV: cv::cvtColor(image, bgr, cv::COLOR_YUV2BGR_YUYV); break;
+		case FRAME_FORMAT_NV12: cv::cvtColor(image, bgr, cv::COLOR_YUV2BGR_NV12); break;
+		case FRAME_FORMAT_I420: cv::cvtColor(image, bgr, cv::COLOR_YUV2BGR_I420); break;
+		}
+		/* the YUV layouts subsample by 2 */
+		if (format != SHARED_FRAME_FORMAT_BGRA && format != SHARED_FRAME_FORMAT_BGR) bgr = bgr(cv::Rect(0, 0, bgr.cols & ~1, bgr.rows & ~1));
+
+		if (!output.IsOpen()) {
+			/* the ring is sized by the first frame */
+			int rowSize = SharedFrameFormat_getRowSize(format, bgr.cols);
+			stride = (rowSize + strideAlign - 1) / strideAlign * strideAlign;
+			if (format == SHARED_FRAME_FORMAT_I420) stride = (stride + 1) & ~1;
+			size_t slotSize = (size_t)SharedFrameFormat_getDataSize(format, stride, bgr.rows);
+			if (!output.Open(name, bgr.cols, bgr.rows, slotNum, slotSize)) return 1;
+			width = bgr.cols;
+			height = bgr.rows;
+			printf("writing %s to %s: %dx%d, stride %d, %d slots\n", source->GetName().c_str(), name, bgr.cols, bgr.rows, stride, slotNum);
+		}
+		if (bgr.cols != width || bgr.rows != height) {
+			printf("The frame size changed. Stop\n");
+			break;
+		}
+		convertFrame(bgr, format, stride, buffer, work);
+
+		if (fps > 0) {
+			/* paced on a fixed clock. Behind it (a slow source), no burst to catch up */
+			std::this_thread::sleep_until(nextTime);
+			nextTime += std::chrono::microseconds((int64_t)(1e6 / fps));
+			if (nextTime < std::chrono::steady_clock::now()) nextTime = std::chrono::steady_clock::now();
+		}
+		output.Write(&buffer[0], bgr.cols, bgr.rows, stride, format, ++frameId, getSteadyTimeNs());
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - reportTime).count();
+		if (elapsed >= REPORT_INTERVAL_SEC) {
+			printf("frame %llu: %.1f fps, written %llu, dropped %llu (every slot held)\n", (unsigned long long)frameId,
+				(frameId - reportedNum) / elapsed, (unsigned long long)output.GetPublishedNum(), (unsigned long long)output.GetDroppedNum());
+			reportedNum = frameId;
+			reportTime = std::chrono::steady_clock::now();
+		}
+	}
+	printf("written %llu frames, dropped %llu\n", (unsigned long long)output.GetPublishedNum(), (unsigned long long)output.GetDroppedNum());
+	output.Close();
+	return 0;
+}
@@ -0,0 +1,284 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "SharedFrame.h"
+#include "SharedFrameReader.h"
+
+/*** Macro ***/
+#define COPY_RETRY_NUM 4   /* the writer would have to go around the ring that often during one copy */
+
+/*** Functions ***/
+SharedFrameReader::SharedFrameReader()
+	: m_base(NULL), m_size(0), m_header(NULL), m_isHolding(false), m_pid(0)
+#ifdef _WIN32
+	, m_mappingHandle(NULL)
+#endif
+{
+}
+
+SharedFrameReader::~SharedFrameReader()
+{
+	Detach();
+}
+
+bool SharedFrameReader::Attach(const char *name, bool isHolding)
+{
+	Detach();
+	/* holding writes the slots' holder entries */
+#ifdef _WIN32
+	DWORD access = isHolding ? (FILE_MAP_READ | FILE_MAP_WRITE) : FILE_MAP_READ;
+	std::string mappingName = std::string("Local\\") + name;
+	HANDLE mapping = OpenFileMappingA(access, FALSE, mappingName.c_str());
+	if (mapping == NULL) return false;
+	void *view = MapViewOfFile(mapping, access, 0, 0, 0);
+	MEMORY_BASIC_INFORMATION info;
+	if (view == NULL || VirtualQuery(view, &info, sizeof(info)) == 0 || info.RegionSize < sizeof(SharedFrameHeader)) {
+		if (view) UnmapViewOfFile(view);
+		CloseHandle(mapping);
+		return false;
+	}
+	m_mappingHandle = mapping;
+	m_base = static_cast<const uint8_t*>(view);
+	m_size = info.RegionSize;
+#else
+	std::string shmName = (name[0] == '/') ? name : std::string("/") + name;
+	int fd = shm_open(shmName.c_str(), isHolding ? O_RDWR : O_RDONLY, 0);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SharedFrameHeader)) {
+		close(fd);
+		return false;
+	}
+	void *view = mmap(NULL, (size_t)st.st_size, isHolding ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) return false;
+	m_base = static_cast<const uint8_t*>(view);
+	m_size = (size_t)st.st_size;
+#endif
+
+	/* the magic is written last, after everything else in the header */
+	const SharedFrameHeader *header = reinterpret_cast<const SharedFrameHeader*>(m_base);
+	bool isReady = (memcmp(header->magic, SHARED_FRAME_MAGIC, 4) == 0);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t slotHeaderEnd = sizeof(SharedFrameHeader) + (uint64_t)header->slotNum * sizeof(SharedFrameSlot);
+	if (!isReady || header->version != SHARED_FRAME_VERSION || header->slotNum == 0 || header->dataOffset < slotHeaderEnd
+		|| header->dataOffset > m_size || header->slotSize > (m_size - header->dataOffset) / header->slotNum) {
+		printf("%s is not a shared frame ring (or not ready yet)\n", name);
+		Detach();
+		return false;
+	}
+	m_header = header;
+	m_isHolding = isHolding;
+#ifdef _WIN32
+	m_pid = (uint32_t)GetCurrentProcessId();
+#else
+	m_pid = (uint32_t)getpid();
+#endif
+	if (isHolding) {
+		m_holdNums.reset(new std::atomic<uint32_t>[header->slotNum]);
+		for (uint32_t i = 0; i < header->slotNum; i++) m_holdNums[i] = 0;
+	}
+	return true;
+}
+
+void SharedFrameReader::Detach()
+{
+	if (m_header && m_isHolding) {
+		for (uint32_t i = 0; i < m_header->slotNum; i++) {
+			uint32_t holdNum = m_holdNums[i].exchange(0);
+			for (uint32_t j = 0; j < holdNum; j++) RemoveHold((int)i);
+		}
+	}
+	m_isHolding = false;
+	m_holdNums.reset();
+#ifdef _WIN32
+	if (m_base) UnmapViewOfFile(m_base);
+	if (m_mappingHandle) CloseHandle(m_mappingHandle);
+	m_mappingHandle = NULL;
+#else
+	if (m_base) munmap((void*)m_base, m_size);
+#endif
+	m_base = NULL;
+	m_size = 0;
+	m_header = NULL;
+}
+
+bool SharedFrameReader::IsWriterClosed() const
+{
+	return m_header == NULL || m_header->isClosed.load(std::memory_order_acquire) != 0;
+}
+
+uint64_t SharedFrameReader::GetLatestSequence() const
+{
+	return m_header ? m_header->latestSequence.load(std::memory_order_acquire) : 0;
+}
+
+SharedFrameSlot *SharedFrameReader::GetSlot(int index) const
+{
+	/* only a holding reader (writable mapping) writes through it */
+	return reinterpret_cast<SharedFrameSlot*>(const_cast<uint8_t*>(m_base) + sizeof(SharedFrameHeader)) + index;
+}
+
+int SharedFrameReader::FindSlot(uint64_t sequence) const
+{
+	if (m_header == NULL || sequence == 0) return -1;
+	for (int i = 0; i < (int)m_header->slotNum; i++) {
+		if (GetSlot(i)->lock.load(std::memory_order_relaxed) == 2 * sequence + 2) return i;
+	}
+	return -1;
+}
+
+bool SharedFrameReader::ReadSlot(int index, uint64_t sequence, SharedFrameView *view) const
+{
+	const SharedFrameSlot &slot = *GetSlot(index);
+	view->width = (int)slot.width;
+	view->height = (int)slot.height;
+	view->stride = (int)slot.stride;
+	view->format = (SharedFrameFormat)slot.format;
+	view->frameId = slot.frameId;
+	view->timestampNs = slot.timestampNs;
+	view->data = m_base + m_header->dataOffset + index * m_header->slotSize;
+	view->sequence = sequence;
+	view->slotIndex = index;
+	int rowSize = SharedFrameFormat_getRowSize(view->format, view->width);
+	return view->height > 0 && rowSize > 0 && view->stride >= rowSize
+		&& SharedFrameFormat_getDataSize(view->format, view->stride, view->height) <= m_header->slotSize;
+}
+
+bool SharedFrameReader::Acquire(uint64_t sequence, SharedFrameView *view) const
+{
+	int index = FindSlot(sequence);
+	if (index < 0) return false;
+	const SharedFrameSlot &slot = *GetSlot(index);
+	uint64_t lock = slot.lock.load(std::memory_order_acquire);
+	if (lock != 2 * sequence + 2) return false;
+	bool isValid = ReadSlot(index, sequence, view);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (slot.lock.load(std::memory_order_relaxed) != lock) return false;
+	return isValid;
+}
+
+bool SharedFrameReader::AcquireLatest(uint64_t lastSequence, SharedFrameView *view) const
+{
+	uint64_t sequence = GetLatestSequence();
+	if (sequence <= lastSequence) return false;
+	return Acquire(sequence, view);
+}
+
+bool SharedFrameReader::IsValid(const SharedFrameView &view) const
+{
+	if (m_header == NULL) return false;
+	const SharedFrameSlot &slot = *GetSlot(view.slotIndex);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return slot.lock.load(std::memory_order_relaxed) == 2 * view.sequence + 2;
+}
+
+bool SharedFrameReader::CopyLatest(uint64_t lastSequence, std::vector<uint8_t> &buffer, SharedFrameView *view) const
+{
+	for (int i = 0; i < COPY_RETRY_NUM; i++) {
+		if (!AcquireLatest(lastSequence, view)) return false;
+		SharedFrameView_copy(*view, buffer);
+		if (IsValid(*view)) {
+			view->data = buffer.empty() ? NULL : &buffer[0];
+			view->stride = SharedFrameFormat_getRowSize(view->format, view->width);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SharedFrameReader::Hold(uint64_t sequence, SharedFrameView *view)
+{
+	if (!m_isHolding) return false;
+	int index = FindSlot(sequence);
+	if (index < 0) return false;
+	/* counted first, then the lock checked again: see SharedFrameOutput::BeginWrite for the other side */
+	if (!AddHold(index)) return false;
+	if (GetSlot(index)->lock.load(std::memory_order_seq_cst) != 2 * sequence + 2) {
+		RemoveHold(index);
+		return false;
+	}
+	m_holdNums[index]++;
+	if (!ReadSlot(index, sequence, view)) {
+		Release(*view);
+		return false;
+	}
+	return true;
+}
+
+bool SharedFrameReader::HoldLatest(uint64_t lastSequence, SharedFrameView *view)
+{
+	uint64_t sequence = GetLatestSequence();
+	if (sequence <= lastSequence) return false;
+	return Hold(sequence, view);
+}
+
+void SharedFrameReader::Release(const SharedFrameView &view)
+{
+	if (!m_isHolding || view.slotIndex < 0 || view.slotIndex >= (int)m_header->slotNum) return;
+	m_holdNums[view.slotIndex]--;
+	RemoveHold(view.slotIndex);
+}
+
+bool SharedFrameReader::AddHold(int index)
+{
+	/* every change is a compare and swap, so an entry is never counted after it was freed (or taken by the writer) */
+	SharedFrameSlot &slot = *GetSlot(index);
+	uint64_t owner = (uint64_t)m_pid << 32;
+	/* the entry this process already has (several holds share it), else a free one */
+	for (int i = 0; i < SHARED_FRAME_MAX_HOLDERS; i++) {
+		uint64_t holder = slot.holders[i].load(std::memory_order_seq_cst);
+		while ((holder >> 32) == m_pid) {
+			if (slot.holders[i].compare_exchange_weak(holder, holder + 1, std::memory_order_seq_cst)) return true;
+		}
+	}
+	for (int i = 0; i < SHARED_FRAME_MAX_HOLDERS; i++) {
+		uint64_t holder = 0;
+		if (slot.holders[i].compare_exchange_strong(holder, owner + 1, std::memory_order_seq_cst)) return true;
+	}
+	return false;
+}
+
+void SharedFrameReader::RemoveHold(int index)
+{
+	SharedFrameSlot &slot = *GetSlot(index);
+	for (int i = 0; i < SHARED_FRAME_MAX_HOLDERS; i++) {
+		uint64_t holder = slot.holders[i].load(std::memory_order_relaxed);
+		while ((holder >> 32) == m_pid && (uint32_t)holder != 0) {
+			/* the last hold frees the entry */
+			uint64_t next = ((uint32_t)holder == 1) ? 0 : holder - 1;
+			if (slot.holders[i].compare_exchange_weak(holder, next, std::memory_order_release, std::memory_order_relaxed)) return;
+		}
+	}
+}
+
+void SharedFrameView_copy(const SharedFrameView &view, std::vector<uint8_t> &buffer)
+{
+	size_t rowSize = (size_t)SharedFrameFormat_getRowSize(view.format, view.width);
+	size_t stride = (size_t)view.stride;
+	buffer.resize((size_t)SharedFrameFormat_getDataSize(view.format, (int)rowSize, view.height));
+	if (buffer.empty()) return;
+	uint8_t *dst = &buffer[0];
+	int rowNum = (view.format == SHARED_FRAME_FORMAT_NV12) ? view.height * 3 / 2 : view.height;
+	for (int y = 0; y < rowNum; y++) memcpy(dst + rowSize * y, view.data + stride * y, rowSize);
+	if (view.format == SHARED_FRAME_FORMAT_I420) {
+		/* U then V, height / 2 rows each, at half the stride */
+		dst += rowSize * view.height;
+		const uint8_t *src = view.data + stride * view.height;
+		for (int y = 0; y < view.height; y++) memcpy(dst + rowSize / 2 * y, src + stride / 2 * y, rowSize / 2);
+	}
+}
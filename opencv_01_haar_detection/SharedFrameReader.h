@@ -0,0 +1,87 @@
+#ifndef SHARED_FRAME_READER_H
+#define SHARED_FRAME_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+#include "SharedFrame.h"
+
+/* A published frame, in place in the shared memory */
+typedef struct {
+	const uint8_t *data;
+	int width;
+	int height;
+	int stride;              /* in bytes */
+	SharedFrameFormat format;
+	uint64_t sequence;       /* 1, 2, ... in publishing order */
+	uint64_t frameId;
+	uint64_t timestampNs;
+	int slotIndex;
+} SharedFrameView;
+
+/* The view's pixels copied tightly packed (stride = row size, I420 chroma rows half of it) */
+void SharedFrameView_copy(const SharedFrameView &view, std::vector<uint8_t> &buffer);
+
+/*
+ * Reader side of the shared memory frame ring (see SharedFrame.h). Never blocks the writer.
+ * Views point into the ring: read the pixels, then IsValid tells whether the writer overwrote the slot meanwhile
+ * (it has to go around the whole ring for that). A holding reader instead keeps slots away from the writer until Release,
+ * to use frames in place for as long as it needs. Depends on nothing but the OS, to be linked into any consumer
+ */
+class SharedFrameReader
+{
+public:
+	SharedFrameReader();
+	~SharedFrameReader();
+	/* false if the ring does not exist (yet). Read only mapping unless isHolding */
+	bool Attach(const char *name, bool isHolding = false);
+	void Detach();
+	bool IsAttached() const { return m_header != NULL; }
+	/* The writer has stopped. Attach again to follow a restarted writer */
+	bool IsWriterClosed() const;
+	int GetSlotNum() const { return m_header ? (int)m_header->slotNum : 0; }
+	uint64_t GetLatestSequence() const;
+
+	/* Frame number sequence, false if it isn't published yet or was already overwritten */
+	bool Acquire(uint64_t sequence, SharedFrameView *view) const;
+	/* Newest frame, false if nothing is newer than lastSequence */
+	bool AcquireLatest(uint64_t lastSequence, SharedFrameView *view) const;
+	/* The view's pixels were not overwritten up to now */
+	bool IsValid(const SharedFrameView &view) const;
+	/* Newest frame newer than lastSequence copied out (top row first, tightly packed), retried if it is overwritten while copying */
+	bool CopyLatest(uint64_t lastSequence, std::vector<uint8_t> &buffer, SharedFrameView *view) const;
+
+	/* Holding reader only. The view stays valid until Release, which may come from another thread. Detach releases what is left.
+	 * Fails if SHARED_FRAME_MAX_HOLDERS other processes hold the slot already. A reader that dies gets its holds taken back */
+	bool Hold(uint64_t sequence, SharedFrameView *view);
+	bool HoldLatest(uint64_t lastSequence, SharedFrameView *view);
+	void Release(const SharedFrameView &view);
+
+private:
+	SharedFrameReader(const SharedFrameReader&);
+	SharedFrameReader& operator=(const SharedFrameReader&);
+	SharedFrameSlot *GetSlot(int index) const;
+	/* Slot published with frame sequence, -1 if none (not yet, or already overwritten) */
+	int FindSlot(uint64_t sequence) const;
+	/* The slot header into view, false if it doesn't describe a frame that fits in the slot */
+	bool ReadSlot(int index, uint64_t sequence, SharedFrameView *view) const;
+	/* One hold more / less in this process' holder entry of the slot. AddHold fails if every entry is another process' */
+	bool AddHold(int index);
+	void RemoveHold(int index);
+
+private:
+	const uint8_t *m_base;
+	size_t m_size;
+	const SharedFrameHeader *m_header;
+	bool m_isHolding;
+	uint32_t m_pid;
+	std::unique_ptr<std::atomic<uint32_t>[]> m_holdNums;   /* this reader's holds per slot */
+#ifdef _WIN32
+	void *m_mappingHandle;
+#endif
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "SharedFrameReader.h"
+
+/*** Macro ***/
+#define POLL_INTERVAL_US 1000
+#define REPORT_INTERVAL_SEC 1.0
+
+/*** Function ***/
+static uint64_t getSteadyTimeNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Example consumer: shm_frame_reader <name> [frames] [output.png]
+ * Follows the newest frame, reports the rate, age (publish -> read) and frames skipped, and saves the last one if asked */
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		printf("usage: %s <name> [frames] [output.png]\n", argv[0]);
+		return 1;
+	}
+	const char *name = argv[1];
+	int frameNum = (argc > 2) ? atoi(argv[2]) : 0;
+	const char *outputPath = (argc > 3) ? argv[3] : NULL;
+
+	SharedFrameReader reader;
+	while (!reader.Attach(name)) {
+		printf("waiting for %s\n", name);
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+	printf("attached to %s (%d slots)\n", name, reader.GetSlotNum());
+
+	uint64_t lastSequence = reader.GetLatestSequence();
+	int readNum = 0;
+	int intervalNum = 0;
+	uint64_t skippedNum = 0;
+	uint64_t tornNum = 0;
+	double ageSum = 0;
+	auto reportTime = std::chrono::steady_clock::now();
+	std::vector<uint8_t> buffer;
+	std::vector<uint8_t> scratch;
+	int savedWidth = 0;
+	int savedHeight = 0;
+	SharedFrameFormat savedFormat = SHARED_FRAME_FORMAT_BGRA;
+	while (frameNum == 0 || readNum < frameNum) {
+		if (reader.IsWriterClosed()) {
+			printf("the writer has stopped\n");
+			break;
+		}
+		SharedFrameView view;
+		if (!reader.AcquireLatest(lastSequence, &view)) {
+			std::this_thread::sleep_for(std::chrono::microseconds(POLL_INTERVAL_US));
+			continue;
+		}
+		/* A real consumer works on view.data in place here. Keeping only the last frame is enough for the example */
+		if (outputPath) SharedFrameView_copy(view, scratch);
+		if (!reader.IsValid(view)) {
+			tornNum++;
+			continue;
+		}
+		if (outputPath) {
+			buffer.swap(scratch);
+			savedWidth = view.width;
+			savedHeight = view.height;
+			savedFormat = view.format;
+		}
+		if (lastSequence != 0) skippedNum += view.sequence - lastSequence - 1;
+		lastSequence = view.sequence;
+		ageSum += (getSteadyTimeNs() - view.timestampNs) * 1e-6;
+		readNum++;
+		intervalNum++;
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - reportTime).count();
+		if (elapsed >= REPORT_INTERVAL_SEC) {
+			printf("frame %llu (%dx%d): %.1f fps, age %.2f ms, skipped %llu, overwritten while reading %llu\n", (unsigned long long)view.sequence,
+				view.width, view.height, intervalNum / elapsed, ageSum / intervalNum, (unsigned long long)skippedNum, (unsigned long long)tornNum);
+			intervalNum = 0;
+			ageSum = 0;
+			reportTime = std::chrono::steady_clock::now();
+		}
+	}
+
+	if (outputPath && savedWidth > 0) {
+		cv::Mat bgr;
+		switch (savedFormat) {
+		case SHARED_FRAME_FORMAT_BGRA: cv::cvtColor(cv::Mat(savedHeight, savedWidth, CV_8UC4, &buffer[0]), bgr, cv::COLOR_BGRA2BGR); break;
+		case SHARED_FRAME_FORMAT_BGR:  bgr = cv::Mat(savedHeight, savedWidth, CV_8UC3, &buffer[0]); break;
+		case SHARED_FRAME_FORMAT_YUYV: cv::cvtColor(cv::Mat(savedHeight, savedWidth, CV_8UC2, &buffer[0]), bgr, cv::COLOR_YUV2BGR_YUYV); break;
+		case SHARED_FRAME_FORMAT_NV12: cv::cvtColor(cv::Mat(savedHeight * 3 / 2, savedWidth, CV_8UC1, &buffer[0]), bgr, cv::COLOR_YUV2BGR_NV12); break;
+		case SHARED_FRAME_FORMAT_I420: cv::cvtColor(cv::Mat(savedHeight * 3 / 2, savedWidth, CV_8UC1, &buffer[0]), bgr, cv::COLOR_YUV2BGR_I420); break;
+		}
+		if (bgr.empty() || !cv::imwrite(outputPath, bgr)) printf("Impossible to write %s\n", outputPath);
+	}
+	return 0;
+}
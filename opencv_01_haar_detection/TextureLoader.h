@@ -0,0 +1,11 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <GL/glew.h>
+
+#include "ImageDecoder.h"
+
+/* Create a mipmapped RGBA8 texture from a decoded image (direct upload from client memory) */
+GLuint TextureLoader_createTexture(const Image &image);
+
+#endif
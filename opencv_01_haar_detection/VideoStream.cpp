@@ -0,0 +1,237 @@
+/*** Include ***/
+/* for general */
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+#include "Profiler.h"
+#include "DnnDetector.h"
+#include "VideoStream.h"
+
+/*** Macro ***/
+
+/*** Global variables ***/
+
+/*** Functions ***/
+void VideoStream_getDefaultConfig(VideoStreamConfig *config)
+{
+	config->backend = DETECTOR_BACKEND_HAAR;
+	config->cascadePath = "resource/rpalm.xml";
+	config->dnnModelPath = NULL;
+	config->useTracking = true;
+	config->useMotionGate = true;
+	config->detectorNum = 2;
+	config->detectBatchSize = 1;
+	config->detectInFlight = 2;
+	config->isLossless = false;
+	config->colorSpace = BACKGROUND_COLOR_SPACE_BT601;
+	config->isFullRange = false;
+}
+
+static BackgroundFormat toBackgroundFormat(FrameFormat format)
+{
+	switch (format) {
+	case FRAME_FORMAT_YUYV: return BACKGROUND_FORMAT_YUYV;
+	case FRAME_FORMAT_NV12: return BACKGROUND_FORMAT_NV12;
+	case FRAME_FORMAT_I420: return BACKGROUND_FORMAT_I420;
+	default: return BACKGROUND_FORMAT_BGR;
+	}
+}
+
+/* Debug boxes drawn into the frame before upload (into the Y plane for YUV frames) */
+static void drawBoxes(cv::Mat &image, FrameFormat format, const std::vector<cv::Rect> &listDet)
+{
+	cv::Mat luma = FrameFormat_getLumaPlane(image, format);
+	for (size_t i = 0; i < listDet.size(); i++) {
+		if (format == FRAME_FORMAT_BGR) {
+			cv::rectangle(image, listDet[i], cv::Scalar(255, 0, 0));
+		} else if (format == FRAME_FORMAT_YUYV) {
+			cv::rectangle(image, listDet[i], cv::Scalar(255, 128));
+		} else {
+			cv::rectangle(luma, listDet[i], cv::Scalar(255));
+		}
+	}
+}
+
+VideoStream::VideoStream()
+	: m_haarDetector(NULL)
+	, m_multiDetector(NULL)
+	, m_uploadScale(1.0f)
+	, m_backgroundScale(1.0f)
+{
+	VideoStream_getDefaultConfig(&m_config);
+	m_detection.frameId = 0;
+}
+
+VideoStream::~VideoStream()
+{
+	Stop();
+}
+
+bool VideoStream::Start(const std::string &sourceSpec, int width, int height, const VideoStreamConfig &config)
+{
+	m_config = config;
+	m_source = FrameSource_create(sourceSpec, width, height);
+	if (!m_source) return false;
+
+	/* Detectors. The closures point into the members, so they are not replaced after this */
+	MotionGateConfig motionGateConfig;
+	MotionGate_getDefaultConfig(&motionGateConfig);
+	m_motionGate.reset();
+	m_detectFuncs.clear();
+	std::vector<MotionGate::Detector> detectors;
+	if (m_config.useTracking && m_config.backend == DETECTOR_BACKEND_HAAR) {
+		if (!HaarDetector_loadCascade(m_trackerCascade, m_config.cascadePath)) {
+			printf("failed to load %s\n", m_config.cascadePath);
+			return false;
+		}
+		/* the same cascade settings as the Haar backend without tracking */
+		HaarDetectorConfig haarConfig;
+		HaarDetector_getDefaultConfig(&haarConfig);
+		DetectTrackerConfig trackerConfig;
+		DetectTracker_getDefaultConfig(&trackerConfig);
+		trackerConfig.minNeighbors = haarConfig.minNeighbors;
+		trackerConfig.minSize = haarConfig.minSize;
+		m_tracker.reset(new DetectTracker(&m_trackerCascade, trackerConfig));
+		/* the tracker follows boxes over whole frames: the gate only skips static frames */
+		motionGateConfig.isRegionDetection = false;
+		DetectTracker *tracker = m_tracker.get();
+		detectors.push_back([tracker](const cv::Mat &gray, std::vector<cv::Rect> &listDet) {
+			tracker->Process(gray, listDet);
+		});
+	} else {
+		DetectorConfig detectorConfig;
+		Detector_getDefaultConfig(&detectorConfig);
+		detectorConfig.workerNum = m_config.detectorNum;
+		detectorConfig.maxBatchSize = m_config.detectBatchSize;
+		detectorConfig.maxInFlight = m_config.detectInFlight;
+		if (m_config.backend == DETECTOR_BACKEND_DNN) {
+			DnnDetectorConfig dnnConfig;
+			DnnDetector_getDefaultConfig(&dnnConfig);
+			dnnConfig.modelPath = m_config.dnnModelPath;
+			m_detector.reset(new DnnDetector(dnnConfig, detectorConfig));
+		} else if (m_config.backend == DETECTOR_BACKEND_MULTI_HAAR) {
+			MultiCascadeConfig multiConfig;
+			MultiCascadeConfig_getDefaultConfig(&multiConfig);
+			std::vector<std::string> cascadePaths = m_config.cascadePaths;
+			if (cascadePaths.empty()) cascadePaths.push_back(m_config.cascadePath);
+			m_multiDetector = new MultiCascadeDetector(cascadePaths, multiConfig, detectorConfig);
+			m_detector.reset(m_multiDetector);
+		} else {
+			HaarDetectorConfig haarConfig;
+			HaarDetector_getDefaultConfig(&haarConfig);
+			haarConfig.cascadePath = m_config.cascadePath;
+			m_haarDetector = new HaarDetector(haarConfig, detectorConfig);
+			m_detector.reset(m_haarDetector);
+		}
+		if (!m_detector->Start()) return false;
+		/* Deliberately maxInFlight blocking callers: one pipeline worker per frame in flight, each waiting for its own future.
+		 * Their requests queue up together and are batched by the detector, and results keep the pipeline's per worker order
+		 * and lossless back pressure, with no future polling in the capture or render thread */
+		Detector *asyncDetector = m_detector.get();
+		for (int i = 0; i < detectorConfig.maxInFlight; i++) {
+			detectors.push_back([asyncDetector](const cv::Mat &gray, std::vector<cv::Rect> &listDet) {
+				Detector_detect(asyncDetector, gray, listDet);
+			});
+		}
+	}
+	/* One motion gate for the stream: it decides on every frame in the capture thread, the workers detect what it left */
+	if (m_config.useMotionGate) m_motionGate.reset(new MotionGate(motionGateConfig));
+	MotionGate *motionGate = m_motionGate.get();
+	RegionFunc regionFunc;
+	if (motionGate) {
+		regionFunc = [motionGate](const cv::Mat &detectImage) {
+			return motionGate->Decide(detectImage);
+		};
+	}
+	for (size_t i = 0; i < detectors.size(); i++) {
+		MotionGate::Detector detector = detectors[i];
+		m_detectFuncs.push_back([detector, motionGate](const Frame &frame, std::vector<cv::Rect> &listDet) {
+			if (motionGate) {
+				motionGate->Detect(frame.detectImage, frame.frameId, frame.detectRegion, listDet, detector);
+			} else {
+				detector(frame.detectImage, listDet);
+			}
+		});
+	}
+
+	if (!m_background.Initialize(width, height)) return false;
+	m_background.SetColorSpace(m_config.colorSpace, m_config.isFullRange);
+
+	/* Capture and detection run in their own threads from here */
+	DetectionFrontEndConfig frontEndConfig;
+	DetectionFrontEnd_getDefaultConfig(&frontEndConfig);
+	return m_pipeline.Start(m_source.get(), m_detectFuncs, frontEndConfig, m_config.isLossless, regionFunc);
+}
+
+void VideoStream::Stop()
+{
+	/* the pipeline workers may be waiting for the detector: stop them first */
+	m_pipeline.Stop();
+	m_detector.reset();
+	m_haarDetector = NULL;
+	m_multiDetector = NULL;
+	m_background.Finalize();
+}
+
+bool VideoStream::UpdateDetection(std::vector<DetectionResult> *received)
+{
+	return m_pipeline.GetLatestDetection(&m_detection, received);
+}
+
+bool VideoStream::Draw(uint64_t *frameId, double *captureTime)
+{
+	/* Scaled to the viewport and converted to RGB on the GPU */
+	Frame *frame = m_pipeline.AcquireDisplayFrame();
+	if (frame == NULL) {
+		m_background.Draw(0, 0, 0, BACKGROUND_FORMAT_BGR, NULL);
+		return false;
+	}
+	*frameId = frame->frameId;
+	*captureTime = frame->captureTime;
+	/* a zero copy source's frames are not ours to draw into */
+	if (!m_source->IsZeroCopy()) drawBoxes(frame->image, frame->format, m_detection.listDet);
+	{
+		/* YUV frames go up as they are (planes, converted in the shader). They are not downscaled: already 1.5 - 2 bytes per pixel */
+		ScopedTimer timer("upload", frame->frameId);
+		const cv::Mat *background = &frame->image;
+		cv::Size backgroundSize = FrameFormat_getSize(frame->image, frame->format);
+		if (m_uploadScale < 1.0f && frame->format == FRAME_FORMAT_BGR) {
+			cv::resize(frame->image, m_uploadImage, cv::Size(), m_uploadScale, m_uploadScale, cv::INTER_LINEAR);
+			background = &m_uploadImage;
+			backgroundSize = cv::Size(m_uploadImage.cols, m_uploadImage.rows);
+		}
+		m_backgroundScale = (float)backgroundSize.width / frame->image.cols;
+		m_background.Draw(backgroundSize.width, backgroundSize.height, (int)background->step, toBackgroundFormat(frame->format), background->data);
+	}
+	m_pipeline.ReleaseFrame(frame);
+	return true;
+}
+
+void VideoStream::BoxToNdc(const cv::Rect &box, float *x0, float *y0, float *x1, float *y1) const
+{
+	m_background.ImageToNdc(box.x * m_backgroundScale, box.y * m_backgroundScale, x0, y0);
+	m_background.ImageToNdc((box.x + box.width) * m_backgroundScale, (box.y + box.height) * m_backgroundScale, x1, y1);
+}
+
+void VideoStream::SetQuality(const QualityLevel &level)
+{
+	m_pipeline.SetDetectWidth(level.detectWidth);
+	m_pipeline.SetDetectInterval(level.detectInterval);
+	if (m_haarDetector) m_haarDetector->SetScaleFactor(level.scaleFactor);
+	if (m_multiDetector) m_multiDetector->SetScaleFactor(level.scaleFactor);
+	if (m_tracker) m_tracker->SetScaleFactor(level.scaleFactor);
+	m_uploadScale = level.uploadScale;
+}
+
+void VideoStream::PrintStats() const
+{
+	printf("%s: dropped frames %d, detection skipped on %d\n", GetName().c_str(), (int)m_pipeline.GetDroppedNum(), (int)m_pipeline.GetDetectSkippedNum());
+	if (m_tracker) printf("  cascade ran on %d / %d frames\n", m_tracker->GetDetectNum(), m_tracker->GetFrameNum());
+	if (m_motionGate) printf("  no motion, detection skipped on %d / %d frames\n", m_motionGate->GetSkipNum(), m_motionGate->GetFrameNum());
+}
@@ -0,0 +1,102 @@
+#ifndef VIDEO_STREAM_H
+#define VIDEO_STREAM_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include <opencv2/opencv.hpp>
+
+#include "Background.h"
+#include "FramePipeline.h"
+#include "FrameSource.h"
+#include "DetectTracker.h"
+#include "Detector.h"
+#include "HaarDetector.h"
+#include "MultiCascadeDetector.h"
+#include "MotionGate.h"
+#include "QualityController.h"
+
+typedef enum {
+	DETECTOR_BACKEND_HAAR,
+	DETECTOR_BACKEND_DNN,
+	DETECTOR_BACKEND_MULTI_HAAR,   /* several cascades on one shared pyramid (no tracking) */
+} DetectorBackend;
+
+typedef struct {
+	DetectorBackend backend;
+	const char *cascadePath;
+	std::vector<std::string> cascadePaths;   /* multi Haar (cascadePath alone if empty) */
+	const char *dnnModelPath; /* ONNX, required for the DNN backend */
+	bool useTracking;        /* detect-then-track with one stateful worker (Haar only) */
+	bool useMotionGate;      /* skip detection on static frames */
+	int detectorNum;         /* detector workers when not tracking */
+	int detectBatchSize;     /* queued frames taken into one inference call */
+	int detectInFlight;      /* frames submitted to the detector at once */
+	bool isLossless;         /* every frame is detected and shown (benchmarking offline sources) */
+	BackgroundColorSpace colorSpace;   /* of YUV sources (YUYV, NV12, I420) */
+	bool isFullRange;
+} VideoStreamConfig;
+
+void VideoStream_getDefaultConfig(VideoStreamConfig *config);
+
+/*
+ * One input feed: its source, capture / detection threads (FramePipeline), detector state and streaming background texture.
+ * Streams are independent of each other; the render thread draws each into its own viewport (tile)
+ */
+class VideoStream
+{
+public:
+	VideoStream();
+	~VideoStream();
+	/* width / height: requested capture size and initial viewport size. Call from the GL context thread */
+	bool Start(const std::string &sourceSpec, int width, int height, const VideoStreamConfig &config);
+	void Stop();
+	bool IsFinished() const { return m_pipeline.IsFinished(); }
+	std::string GetName() const { return m_source ? m_source->GetName() : ""; }
+	/* threads running the detector */
+	int GetDetectorNum() const { return m_detector ? m_detector->GetConfig().workerNum : (int)m_detectFuncs.size(); }
+
+	/* Render thread, once per frame: take the most recent completed detection (never waits).
+	 * Returns true if it is newer than the last one. received (optional) gets every result since the last call */
+	bool UpdateDetection(std::vector<DetectionResult> *received = NULL);
+	const std::vector<cv::Rect> &GetDetections() const { return m_detection.listDet; }
+	/* frame the detections are of (0: none yet) */
+	uint64_t GetDetectionFrameId() const { return m_detection.frameId; }
+	/* Draw the newest captured frame into the current viewport (one draw), the last one again if there is no new frame.
+	 * Returns true for a new frame, with its id and capture time */
+	bool Draw(uint64_t *frameId, double *captureTime);
+	void SetViewportSize(int width, int height) { m_background.SetViewportSize(width, height); }
+	/* Map a box of the frame to normalized device coordinates of the viewport (top left, bottom right) */
+	void BoxToNdc(const cv::Rect &box, float *x0, float *y0, float *x1, float *y1) const;
+
+	void SetQuality(const QualityLevel &level);
+	uint64_t GetDroppedNum() const { return m_pipeline.GetDroppedNum(); }
+	/* tracker / motion gate counters */
+	void PrintStats() const;
+
+private:
+	VideoStream(const VideoStream&);
+	VideoStream& operator=(const VideoStream&);
+
+private:
+	VideoStreamConfig m_config;
+	std::unique_ptr<FrameSource> m_source;
+	/* detect-then-track: the tracker runs its cascade itself. Otherwise every frame goes through the asynchronous detector */
+	cv::CascadeClassifier m_trackerCascade;
+	std::unique_ptr<DetectTracker> m_tracker;
+	std::unique_ptr<Detector> m_detector;
+	HaarDetector *m_haarDetector;    /* m_detector if it is the Haar backend */
+	MultiCascadeDetector *m_multiDetector;   /* m_detector if it is the multi Haar backend */
+	std::unique_ptr<MotionGate> m_motionGate;
+	std::vector<DetectFunc> m_detectFuncs;
+	FramePipeline m_pipeline;
+	BackgroundDrawer m_background;
+	DetectionResult m_detection;
+	float m_uploadScale;
+	float m_backgroundScale;     /* background texture size / frame size */
+	cv::Mat m_uploadImage;
+};
+
+#endif
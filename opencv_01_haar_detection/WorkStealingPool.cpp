@@ -0,0 +1,114 @@
+/*** Include ***/
+/* for general */
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "WorkStealingPool.h"
+
+/*** Macro ***/
+
+/*** Global variables ***/
+
+/*** Functions ***/
+WorkStealingPool::WorkStealingPool(int threadNum)
+	: m_queuedNum(0), m_nextQueue(0), m_stop(false)
+{
+	if (threadNum <= 0) threadNum = (int)std::thread::hardware_concurrency() - 1;
+	if (threadNum <= 0) threadNum = 1;
+	for (int i = 0; i < threadNum; i++) m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+	for (int i = 0; i < threadNum; i++) {
+		m_threads.push_back(std::thread(&WorkStealingPool::WorkerLoop, this, i));
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stop = true;
+	}
+	m_sleepCond.notify_all();
+	for (size_t i = 0; i < m_threads.size(); i++) m_threads[i].join();
+}
+
+void WorkStealingPool::ParallelFor(int taskNum, const std::function<void(int taskIndex)> &func)
+{
+	if (taskNum <= 0) return;
+	std::atomic<int> remainingNum(taskNum);
+	int queueNum = (int)m_queues.size();
+	/* concurrent callers start dealing at different queues */
+	int first = m_nextQueue.fetch_add(1) % queueNum;
+	for (int i = 0; i < taskNum; i++) {
+		Queue &queue = *m_queues[(first + i) % queueNum];
+		Task task = { &func, i, &remainingNum };
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_queuedNum += taskNum;
+	}
+	m_sleepCond.notify_all();
+
+	/* help until every task of this call is done (possibly running tasks of another caller meanwhile) */
+	Task task;
+	while (remainingNum > 0) {
+		if (TrySteal(-1, task)) {
+			Execute(task);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool WorkStealingPool::TryPop(int queueIndex, Task &task)
+{
+	Queue &queue = *m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) return false;
+	task = queue.tasks.back();
+	queue.tasks.pop_back();
+	m_queuedNum--;
+	return true;
+}
+
+bool WorkStealingPool::TrySteal(int thiefIndex, Task &task)
+{
+	int queueNum = (int)m_queues.size();
+	int start = (thiefIndex < 0) ? 0 : thiefIndex + 1;
+	for (int i = 0; i < queueNum; i++) {
+		int victim = (start + i) % queueNum;
+		if (victim == thiefIndex) continue;
+		Queue &queue = *m_queues[victim];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) continue;
+		task = queue.tasks.front();
+		queue.tasks.pop_front();
+		m_queuedNum--;
+		return true;
+	}
+	return false;
+}
+
+void WorkStealingPool::Execute(const Task &task)
+{
+	(*task.func)(task.taskIndex);
+	/* the caller's counter may go out of scope right after this */
+	task.remainingNum->fetch_sub(1);
+}
+
+void WorkStealingPool::WorkerLoop(int queueIndex)
+{
+	Task task;
+	while (true) {
+		if (TryPop(queueIndex, task) || TrySteal(queueIndex, task)) {
+			Execute(task);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepCond.wait(lock, [this]() { return m_stop || m_queuedNum > 0; });
+		if (m_stop) return;
+	}
+}
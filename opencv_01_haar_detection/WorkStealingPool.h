@@ -0,0 +1,57 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/*
+ * Fixed size pool with one task deque per worker. Tasks of a ParallelFor are dealt round robin; a worker takes from the back
+ * of its own deque and, when it runs dry, steals from the front of the others, so uneven tasks (e.g. early rejected image regions
+ * vs. busy ones) still balance. ParallelFor may be called from several threads at once
+ */
+class WorkStealingPool
+{
+public:
+	explicit WorkStealingPool(int threadNum = 0);    /* 0: number of cores - 1 (the caller of ParallelFor works too) */
+	~WorkStealingPool();
+	int GetThreadNum() const { return (int)m_threads.size(); }
+	/* func(taskIndex) for every 0 <= taskIndex < taskNum. Returns when all are done; the calling thread runs tasks meanwhile */
+	void ParallelFor(int taskNum, const std::function<void(int taskIndex)> &func);
+
+private:
+	WorkStealingPool(const WorkStealingPool&);
+	WorkStealingPool& operator=(const WorkStealingPool&);
+
+	typedef struct {
+		const std::function<void(int)> *func;
+		int taskIndex;
+		std::atomic<int> *remainingNum;
+	} Task;
+
+	typedef struct {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	} Queue;
+
+	bool TryPop(int queueIndex, Task &task);
+	bool TrySteal(int thiefIndex, Task &task);
+	void Execute(const Task &task);
+	void WorkerLoop(int queueIndex);
+
+private:
+	std::vector<std::unique_ptr<Queue> > m_queues;   /* one per worker */
+	std::vector<std::thread> m_threads;
+	std::atomic<int> m_queuedNum;
+	std::atomic<int> m_nextQueue;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCond;
+	bool m_stop;
+};
+
+#endif
@@ -2,10 +2,17 @@
 /* for general */
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <fstream> 
 #include <vector>
 #include <string>
 #include <chrono>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cmath>
 
 /* for OpenCV */
 #include <opencv2/opencv.hpp>
@@ -20,7 +27,20 @@
 #include "texture.h"
 #include "objloader.h"
 #include "CameraControls.h"
-#include "Background.h"
+#include "AssetManager.h"
+#include "MeshPack.h"
+#include "InstancedOverlay.h"
+#include "ResourcePack.h"
+#include "FramePipeline.h"
+#include "VideoStream.h"
+#include "QualityController.h"
+#include "LatencyStats.h"
+#include "Profiler.h"
+#include "PresentTimer.h"
+#include "FrameReadback.h"
+#include "FrameRecorder.h"
+#include "SharedFrameOutput.h"
+#include "AppSettings.h"
 
 /*** Macro ***/
 /* macro functions */
@@ -33,59 +53,97 @@
 /* Settings */
 #define WINDOW_WIDTH  1280
 #define WINDOW_HEIGHT  720
-#define OBJECT_NUM 2
-//#define HAAR_FILENAME "resource/haarcascade_frontalface_alt.xml"
-#define HAAR_FILENAME "resource/rpalm.xml"
+#define DETECTOR_NUM 2		// detector worker threads per stream (without tracking)
+#define USE_QUALITY_CONTROL 1	// lower detection / background quality to hold the target frame rate (not in --max-throughput)
+#define DEFAULT_TARGET_FPS 30
+#define STATS_INTERVAL 300	// frames between rolling latency reports
+#define STATS_WINDOW 300	// samples per stage in the rolling report
+#define DEFAULT_SOURCE "camera:0"
+#define MAX_STREAM_NUM 16
+#define READBACK_DEPTH 3	// frames being read back at once (pack buffers)
+#define RECORD_QUEUE_SIZE 8	// read back frames waiting for the encoder
+#define SHARED_OUTPUT_SLOT_NUM 4	// frames kept in the shared memory ring for consumers
 
 /*** Global variables ***/
 
-
 /*** Function ***/
-int generateObjectFromFile(const char *filename, GLuint *vertexBuffer, GLuint *uvBuffer, float *sizeY)
+static void printUsage(const char *name)
 {
-	/* Read .obj file */
-	std::vector<unsigned short> indices;
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec2> uvs;
-	std::vector<glm::vec3> normals;
-	RUN_CHECK(loadAssImp(filename, indices, vertices, uvs, normals));
-
-	/* Create Vertex Buffer Object and copy data */
-	glGenBuffers(1, vertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, *vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-
-	if (uvs.size() > 0) {
-		glGenBuffers(1, uvBuffer);
-		glBindBuffer(GL_ARRAY_BUFFER, *uvBuffer);
-		glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-	}
-
-	/* Calculate object size (Y only) */
-	float objectMinY = 999999;
-	float objectMaxY = -999999;
-	for (int i = 0; i < vertices.size(); i++) {
-		if (vertices[i].y > objectMaxY) objectMaxY = vertices[i].y;
-		if (vertices[i].y < objectMinY) objectMinY = vertices[i].y;
-	}
-	*sizeY = objectMaxY - objectMinY;
-	return vertices.size();
+	printf("usage: %s [--source SPEC]... [--max-throughput] [--offscreen] [--trace FILE] [--target-fps FPS] [--detector haar|multi|dnn:MODEL] [--record FILE] [--shm-output NAME] [--model PATH]... [--color-space bt601|bt709[:full]]\n", name);
+	printf("  --source SPEC     camera[:index[:yuyv|nv12|i420]], video:<path>, images:<directory>, synthetic[:WxH[:frames]], shm:<name> (default %s)\n", DEFAULT_SOURCE);
+	printf("                    repeat for up to %d streams, shown as tiles of one window\n", MAX_STREAM_NUM);
+	printf("  --max-throughput  process every frame as fast as possible (no vsync, no drop) and report at the end\n");
+	printf("  --offscreen       render into a framebuffer object of a hidden window\n");
+	printf("  --trace FILE      write per stage timings as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)\n");
+	printf("  --target-fps FPS  frame rate the quality controller holds (default %d)\n", DEFAULT_TARGET_FPS);
+	printf("  --detector        haar: %s (default), dnn:MODEL: ONNX model file on OpenCV DNN, required (none is shipped; no tracking)\n", HAAR_FILENAME);
+	printf("                    multi: %s and %s on one shared image pyramid (no tracking)\n", HAAR_FILENAME, SECOND_HAAR_FILENAME);
+	printf("  --record FILE     record the rendered output at the target fps: video (.avi, .mp4), .y4m or .png (numbered images)\n");
+	printf("  --shm-output NAME publish the rendered output to the shared memory ring NAME (read it with SharedFrameReader)\n");
+	printf("  --model PATH      overlay model, repeat to rotate through several (default: %d built-in models)\n", (int)(sizeof(MODEL_FILENAMES) / sizeof(MODEL_FILENAMES[0])));
+	printf("  --color-space CS  YUV -> RGB of yuyv / nv12 / i420 sources: bt601 (SD, default) or bt709 (HD), limited range unless :full\n");
 }
 
 int main(int argc, char *argv[])
 {
 	/*** Initialize ***/
-	/* Initialize camera (OpenCV) */
-	static cv::VideoCapture cap;
-	cap = cv::VideoCapture(0);
-	cap.set(cv::CAP_PROP_FRAME_WIDTH, WINDOW_WIDTH);
-	cap.set(cv::CAP_PROP_FRAME_HEIGHT, WINDOW_HEIGHT);
-	// cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('B', 'G', 'R', '3'));
-	cap.set(cv::CAP_PROP_BUFFERSIZE, 1);
-	
-	/* Initialize cascade (OpenCV) */
-	cv::CascadeClassifier cascade;
-	cascade.load(HAAR_FILENAME);
+	/* Resources are read from the pack if it exists, otherwise from the resource directory */
+	if (!Resource_openPack(RESOURCE_PACK_FILENAME)) printf("%s is not found. Use the resource directory\n", RESOURCE_PACK_FILENAME);
+
+	/* Parse arguments */
+	std::vector<std::string> sourceSpecs;
+	bool isMaxThroughput = false;
+	bool isOffscreen = false;
+	const char *tracePath = NULL;
+	double targetFps = DEFAULT_TARGET_FPS;
+	DetectorBackend detectorBackend = DETECTOR_BACKEND_HAAR;
+	const char *dnnModelPath = NULL;
+	const char *recordPath = NULL;
+	const char *sharedOutputName = NULL;
+	std::vector<std::string> modelPaths;
+	BackgroundColorSpace colorSpace = BACKGROUND_COLOR_SPACE_BT601;
+	bool isFullRange = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--source") == 0 && i + 1 < argc) {
+			sourceSpecs.push_back(argv[++i]);
+		} else if (strcmp(argv[i], "--max-throughput") == 0) {
+			isMaxThroughput = true;
+		} else if (strcmp(argv[i], "--offscreen") == 0) {
+			isOffscreen = true;
+		} else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			tracePath = argv[++i];
+		} else if (strcmp(argv[i], "--target-fps") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+			targetFps = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--detector") == 0 && i + 1 < argc && strncmp(argv[i + 1], "dnn:", 4) == 0 && argv[i + 1][4] != '\0') {
+			detectorBackend = DETECTOR_BACKEND_DNN;
+			dnnModelPath = argv[++i] + 4;
+		} else if (strcmp(argv[i], "--detector") == 0 && i + 1 < argc && strcmp(argv[i + 1], "haar") == 0) {
+			detectorBackend = DETECTOR_BACKEND_HAAR;
+			i++;
+		} else if (strcmp(argv[i], "--detector") == 0 && i + 1 < argc && strcmp(argv[i + 1], "multi") == 0) {
+			detectorBackend = DETECTOR_BACKEND_MULTI_HAAR;
+			i++;
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (strcmp(argv[i], "--shm-output") == 0 && i + 1 < argc) {
+			sharedOutputName = argv[++i];
+		} else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+			modelPaths.push_back(argv[++i]);
+		} else if (strcmp(argv[i], "--color-space") == 0 && i + 1 < argc && (strncmp(argv[i + 1], "bt601", 5) == 0 || strncmp(argv[i + 1], "bt709", 5) == 0)) {
+			i++;
+			colorSpace = (strncmp(argv[i], "bt709", 5) == 0) ? BACKGROUND_COLOR_SPACE_BT709 : BACKGROUND_COLOR_SPACE_BT601;
+			isFullRange = strcmp(argv[i] + 5, ":full") == 0;
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (sourceSpecs.empty()) sourceSpecs.push_back(DEFAULT_SOURCE);
+	if (modelPaths.empty()) modelPaths.assign(MODEL_FILENAMES, MODEL_FILENAMES + sizeof(MODEL_FILENAMES) / sizeof(MODEL_FILENAMES[0]));
+	if (sourceSpecs.size() > MAX_STREAM_NUM) {
+		printUsage(argv[0]);
+		return 1;
+	}
 
 	/* Initialize GLFW */
 	GLFWwindow* window;
@@ -96,13 +154,33 @@ int main(int argc, char *argv[])
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (isOffscreen) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 	RUN_CHECK(window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "main", NULL, NULL));
 	glfwMakeContextCurrent(window);
+	/* Don't wait for vsync when measuring throughput */
+	if (isMaxThroughput) glfwSwapInterval(0);
 
 	/* Initialize GLEW */
 	glewExperimental = true;
 	RUN_CHECK(glewInit() == GLEW_OK);
 
+	/* Offscreen target: color + depth renderbuffers of the window size */
+	GLuint offscreenFbo = 0;
+	GLuint offscreenRenderbuffer[2] = { 0, 0 };
+	if (isOffscreen) {
+		glGenFramebuffers(1, &offscreenFbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, offscreenFbo);
+		glGenRenderbuffers(2, offscreenRenderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, offscreenRenderbuffer[0]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WINDOW_WIDTH, WINDOW_HEIGHT);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenRenderbuffer[0]);
+		glBindRenderbuffer(GL_RENDERBUFFER, offscreenRenderbuffer[1]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WINDOW_WIDTH, WINDOW_HEIGHT);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreenRenderbuffer[1]);
+		RUN_CHECK(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+		glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	}
+
 	/* Ensure not to miss input */
 	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
 	glfwSetInputMode(window, GLFW_STICKY_MOUSE_BUTTONS, GL_TRUE);
@@ -117,126 +195,244 @@ int main(int argc, char *argv[])
 	/* Cull triangles which normal is not towards the camera */
 	glEnable(GL_CULL_FACE);
 
-	/* Load shader and get handle */
-	GLuint programId = LoadShaders("resource/TransformVertexShader.vertexshader", "resource/TextureFragmentShader.fragmentshader");
-	GLuint matrixId = glGetUniformLocation(programId, "MVP");
-	GLuint textureId = glGetUniformLocation(programId, "myTextureSampler");
+	/* Assets are shared and released by reference counting */
+	AssetManager assetManager;
+
+	/* Load shader and get handle (transform per instance) */
+	ProgramHandle program = assetManager.LoadProgram("resource/InstancedVertexShader.vertexshader", "resource/TextureFragmentShader.fragmentshader");
+	RUN_CHECK(program);
 
 	/* Read the texture */
-	GLuint texture = loadDDS("resource/uvmap.DDS");
+	TextureHandle texture = assetManager.LoadTexture("resource/uvmap.DDS");
+	RUN_CHECK(texture);
 
-	/* Create Vertex Array Object */
+	/* Create Vertex Array Object (for the background. The overlay has its own) */
 	GLuint vao;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	/* Initialize for background */
-	BackgroundDrawer_init(WINDOW_WIDTH, WINDOW_HEIGHT);
-
-	/* Load object file and geneerate VBO  */
-	int indexObject = 0;
-	int partCount[OBJECT_NUM];
-	GLuint vertexBuffer[OBJECT_NUM];
-	GLuint uvBuffer[OBJECT_NUM];
-	float objectSize[OBJECT_NUM];
-	float objectDefaultScale[OBJECT_NUM];
-	partCount[0] = generateObjectFromFile("resource/miku_Ver17.02.pmx", &vertexBuffer[0], &uvBuffer[0], &objectSize[0]);
-	partCount[1] = generateObjectFromFile("resource/nendomiku_ver3_00.pmx", &vertexBuffer[1], &uvBuffer[1], &objectSize[1]);
+	/* Load every object file into one VBO, switched by draw range */
+	MeshPack meshPack;
+	RUN_CHECK(meshPack.Load(modelPaths));
+	int modelNum = meshPack.GetModelNum();
+	InstancedOverlay overlay;
+	RUN_CHECK(overlay.Initialize(program->id, &meshPack));
 	/* Calculate scale to fit the object to -1.0 ~ 1.0 window (Orthogonal coordinates)  */
-	for (int i = 0; i < OBJECT_NUM; i++) {
-		objectDefaultScale[i] = 2.0f / objectSize[i];
-	}
+	std::vector<float> objectDefaultScale(modelNum);
+	for (int i = 0; i < modelNum; i++) objectDefaultScale[i] = 2.0f / meshPack.GetModel(i).sizeY;
+	assetManager.PrintReport();
+	printf("%d overlay models in one buffer (%.1f MB)\n", modelNum, meshPack.GetBytes() / 1024.0 / 1024.0);
 
 	/* Initialize camera matrix controls (Initial position : on +Z, toward -Z) */
 	CameraControls_initialize(window, glm::vec3(0, 0, 5), 3.14f, 0.0f);
 
+	/* Stage timers of every thread are collected here. Capture-to-photon is estimated from GPU timestamps after swap.
+	 * Before any stream starts: the ring must exist before the first capture / detection thread records into it */
+	Profiler_initialize();
+	Profiler_setThreadName("render");
+	if (tracePath) RUN_CHECK(Profiler_openTrace(tracePath));
+
+	/* Capture and detection of every stream run in their own threads from here */
+	int streamNum = (int)sourceSpecs.size();
+	VideoStreamConfig streamConfig;
+	VideoStream_getDefaultConfig(&streamConfig);
+	streamConfig.backend = detectorBackend;
+	streamConfig.cascadePath = HAAR_FILENAME;
+	streamConfig.cascadePaths.push_back(HAAR_FILENAME);
+	streamConfig.cascadePaths.push_back(SECOND_HAAR_FILENAME);
+	streamConfig.dnnModelPath = dnnModelPath;
+	streamConfig.useTracking = USE_TRACKING;
+	streamConfig.useMotionGate = USE_MOTION_GATE;
+	streamConfig.detectorNum = DETECTOR_NUM;
+	streamConfig.detectBatchSize = DETECT_BATCH_SIZE;
+	streamConfig.detectInFlight = DETECT_IN_FLIGHT;
+	streamConfig.isLossless = isMaxThroughput;
+	streamConfig.colorSpace = colorSpace;
+	streamConfig.isFullRange = isFullRange;
+	/* Tiles of a grid as square as possible, the same size for every stream */
+	int tileCols = (int)std::ceil(std::sqrt((double)streamNum));
+	int tileRows = (streamNum + tileCols - 1) / tileCols;
+	int tileWidth = WINDOW_WIDTH / tileCols;
+	int tileHeight = WINDOW_HEIGHT / tileRows;
+	std::vector<std::unique_ptr<VideoStream> > streams;
+	for (int i = 0; i < streamNum; i++) {
+		streams.push_back(std::unique_ptr<VideoStream>(new VideoStream()));
+		RUN_CHECK(streams[i]->Start(sourceSpecs[i], WINDOW_WIDTH, WINDOW_HEIGHT, streamConfig));
+		streams[i]->SetViewportSize(tileWidth, tileHeight);
+	}
+
+	PresentTimer presentTimer(4 * streamNum);	// one query per new frame of each stream
+	if (!isOffscreen) {
+		const GLFWvidmode *videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		double refreshPeriod = 1.0 / ((videoMode && videoMode->refreshRate > 0) ? videoMode->refreshRate : 60);
+		/* vsync: wait for the next vblank (half a period on average), then scan out to the middle of the screen */
+		RUN_CHECK(presentTimer.Initialize(isMaxThroughput ? refreshPeriod / 2 : refreshPeriod));
+	}
+
+	/* One controller for all streams, the level applies to each. Streams detect in parallel, so the detection cost is per stream */
+	QualityControllerConfig qualityConfig;
+	QualityController_getDefaultConfig(&qualityConfig);
+	qualityConfig.targetFrameTime = 1.0 / targetFps;
+	qualityConfig.detectorNum = streams[0]->GetDetectorNum();
+	QualityController qualityController(qualityConfig);
+	bool isQualityControlled = USE_QUALITY_CONTROL && !isMaxThroughput;
+	std::vector<DetectionResult> receivedDetections;
+	std::vector<double> lastDetTime(streamNum, glfwGetTime());
+	std::vector<int> indexObject(streamNum, 0);
+	std::vector<uint64_t> frameIds(streamNum);
+	std::vector<double> captureTimes(streamNum);
+	LatencyStats latencyStats(isMaxThroughput ? 0 : STATS_WINDOW);
+
+	/* Recording / shared memory output: the frame is copied into a pack buffer before the swap and taken from there
+	 * a frame or two later, then encoded on the recorder thread and / or published to the consumers of the ring */
+	FrameReadback readback(READBACK_DEPTH);
+	FrameRecorder recorder;
+	SharedFrameOutput sharedOutput;
+	int framebufferWidth = WINDOW_WIDTH;
+	int framebufferHeight = WINDOW_HEIGHT;
+	if (!isOffscreen) glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	if (recordPath || sharedOutputName) RUN_CHECK(readback.Initialize(framebufferWidth, framebufferHeight));
+	if (sharedOutputName) RUN_CHECK(sharedOutput.Open(sharedOutputName, framebufferWidth, framebufferHeight, SHARED_OUTPUT_SLOT_NUM));
+	if (recordPath) {
+		FrameRecorderConfig recorderConfig;
+		FrameRecorderConfig_getDefaultConfig(&recorderConfig);
+		recorderConfig.fps = targetFps;
+		recorderConfig.queueSize = RECORD_QUEUE_SIZE;
+		RUN_CHECK(recorder.Start(recordPath, framebufferWidth, framebufferHeight, recorderConfig));
+	}
+	int displayedFrameNum = 0;
+	double startTime = FramePipeline_getTime();
+	double lastFrameTime = startTime;
+
 	/*** Start loop ***/
 	while (1) {
-		/* Clear the screen */
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		/* Capture camera image */
-		cv::Mat capImage;
-		cap.read(capImage);
-
-		/* Detect objects */
-		cv::Mat imageGray;
-		//cvtColor(capImage, imageGray, cv::COLOR_BGR2GRAY);
-		//cv::equalizeHist(imageGray, imageGray);
-		std::vector<cv::Rect> listDet;
-		cascade.detectMultiScale(capImage, listDet, 1.1, 8, cv::CASCADE_SCALE_IMAGE , cv::Size(30, 30));
-		static double s_lastDetTime = glfwGetTime();
-		for (size_t i = 0; i < listDet.size(); i++) {
-			cv::rectangle(capImage, listDet[i], cv::Scalar(255, 0, 0));
-			s_lastDetTime = glfwGetTime();
+		/* Use the most recent completed detection of each stream (never wait for the detection workers) */
+		for (int i = 0; i < streamNum; i++) {
+			if (streams[i]->UpdateDetection(&receivedDetections)) {
+				if (streams[i]->GetDetections().size() > 0) lastDetTime[i] = glfwGetTime();
+			}
+			for (size_t j = 0; j < receivedDetections.size(); j++) {
+				latencyStats.Add("capture->detection", receivedDetections[j].detectEndTime - receivedDetections[j].captureTime);
+				qualityController.AddDetectTime(receivedDetections[j].detectEndTime - receivedDetections[j].detectStartTime);
+			}
 		}
-		if (glfwGetTime() - s_lastDetTime > 2 && s_lastDetTime != -1) {
-			/* switch object */
-			indexObject = (indexObject + 1) % OBJECT_NUM;
-			s_lastDetTime = -1;	// -1 means already switched, but not displayed yet
+		Profiler_collect(&latencyStats);
+		uint64_t presentedFrameId;
+		double presentedCaptureTime, presentTime;
+		while (presentTimer.Poll(&presentedFrameId, &presentedCaptureTime, &presentTime)) {
+			latencyStats.Add("capture->photon", presentTime - presentedCaptureTime);
 		}
 
-		/* Draw background */
-		//cv::cvtColor(capImage, capImage, cv::COLOR_BGR2RGB);
-		cv::resize(capImage, capImage, cv::Size(WINDOW_WIDTH, WINDOW_HEIGHT));
-		BackgroundDrawer_draw(WINDOW_WIDTH, WINDOW_HEIGHT, capImage.data);
+		/* Draw background of each stream into its tile (one draw each). Streams without a new frame redraw the last one */
+		double renderStartTime = FramePipeline_getTime();
+		glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		int newFrameNum = 0;
+		for (int i = 0; i < streamNum; i++) {
+			/* tiles from the top left, row by row */
+			glViewport((i % tileCols) * tileWidth, (tileRows - 1 - i / tileCols) * tileHeight, tileWidth, tileHeight);
+			frameIds[i] = 0;
+			captureTimes[i] = 0;
+			if (streams[i]->Draw(&frameIds[i], &captureTimes[i])) newFrameNum++;
+		}
+		/* In throughput mode only new frames are rendered, until every source is exhausted */
+		if (newFrameNum == 0 && isMaxThroughput) {
+			bool isFinished = true;
+			for (int i = 0; i < streamNum; i++) isFinished = isFinished && streams[i]->IsFinished();
+			if (isFinished) break;
+			std::this_thread::yield();
+			continue;
+		}
+		if (newFrameNum > 0) displayedFrameNum++;
+		if (newFrameNum > 0 && displayedFrameNum % STATS_INTERVAL == 0 && !isMaxThroughput) {
+			latencyStats.Print();
+			printf("dropped profile events %d\n", (int)Profiler_getDroppedNum());
+			for (int i = 0; i < streamNum; i++) streams[i]->PrintStats();
+			if (recorder.IsRecording()) {
+				printf("recorded %d frames, dropped %d (readback) %d (encoder)\n", (int)recorder.GetRecordedNum(), (int)readback.GetDroppedNum(), (int)recorder.GetDroppedNum());
+			}
+			if (sharedOutput.IsOpen()) printf("published %d frames, dropped %d (readback) %d (held by readers)\n", (int)sharedOutput.GetPublishedNum(), (int)readback.GetDroppedNum(), (int)sharedOutput.GetDroppedNum());
+		}
+		double drawStartTime = FramePipeline_getTime();
+		glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 		glClear(GL_DEPTH_BUFFER_BIT);		// draw background as back
 
-		glUseProgram(programId);
 		/* Camera matrix */
 		CameraControls_update(window);
 		glm::mat4 Projection = CameraControls_getProjectionMatrix();
 		glm::mat4 View = CameraControls_getViewMatrix();
 
-		/* Model matrix (move and resize using detection result, and always rotation) */
-		glm::mat4 Model = glm::mat4(1.0f);
+		/* One instance per detection of every stream (move to the center of bounding box, resize to the same size as bbox.height,
+		 * and always rotation), drawn over the whole window with one instanced call per model */
 		static float rotY = 0.0f;
 		rotY += 0.8f;
-		glm::mat4 matModelRot = glm::rotate(rotY / (2 * 3.14f), glm::vec3(0, 1, 0));
-		glm::mat4 matModelScaling = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-		glm::mat4 matModelTranslate = glm::translate(glm::vec3(0.0f, 0.0f, 0.0f));
-		if (listDet.size() > 0) {
-			/* mode to the center of bounding box, and resize to the same size as bbox.height */
-			float x = (listDet[0].x + listDet[0].width / 2 - WINDOW_WIDTH / 2.0f) / (WINDOW_WIDTH / 2);
-			float y = (listDet[0].y + listDet[0].height / 2 - WINDOW_HEIGHT / 2.0f) / (WINDOW_HEIGHT / 2);
-			matModelTranslate = glm::translate(glm::vec3(x, -y, 0.0f));
-			float scale = (float)listDet[0].height / WINDOW_HEIGHT;	// scale against to window size
-			scale *= 0.75;	// adjustment
-			scale *= objectDefaultScale[indexObject];
-			matModelScaling = glm::scale(glm::vec3(scale, scale, scale));
+		overlay.Clear();
+		for (int i = 0; i < streamNum; i++) {
+			const std::vector<cv::Rect> &listDet = streams[i]->GetDetections();
+			if (glfwGetTime() - lastDetTime[i] > 2 && lastDetTime[i] != -1) {
+				/* switch object */
+				indexObject[i] = (indexObject[i] + 1) % modelNum;
+				lastDetTime[i] = -1;	// -1 means already switched, but not displayed yet
+			}
+			/* tile NDC -> window NDC */
+			float tileScaleX = (float)tileWidth / WINDOW_WIDTH;
+			float tileScaleY = (float)tileHeight / WINDOW_HEIGHT;
+			float tileOffsetX = (float)((i % tileCols) * tileWidth * 2) / WINDOW_WIDTH - 1.0f + tileScaleX;
+			float tileOffsetY = (float)((tileRows - 1 - i / tileCols) * tileHeight * 2) / WINDOW_HEIGHT - 1.0f + tileScaleY;
+			for (size_t j = 0; j < listDet.size(); j++) {
+				float x0, y0, x1, y1;
+				streams[i]->BoxToNdc(listDet[j], &x0, &y0, &x1, &y1);
+				OverlayInstance instance;
+				instance.x = tileOffsetX + (x0 + x1) / 2 * tileScaleX;
+				instance.y = tileOffsetY + (y0 + y1) / 2 * tileScaleY;
+				instance.scale = (y0 - y1) / 2 * tileScaleY;	// scale against to window size
+				instance.scale *= 0.75f;	// adjustment
+				instance.scale *= objectDefaultScale[indexObject[i]];
+				instance.rotation = rotY / (2 * 3.14f);
+				overlay.Add(indexObject[i], instance);
+			}
+		}
+		overlay.Draw(Projection * View, texture.get());
+		uint64_t frameId = 0;	// trace events of the render thread carry the frame of the first stream
+		for (int i = 0; i < streamNum && frameId == 0; i++) frameId = frameIds[i];
+
+		/* Hand over the frames whose readback has completed, then start reading this one (never waits for the GPU) */
+		double readbackStartTime = FramePipeline_getTime();
+		if (readback.IsInitialized()) {
+			ReadbackFrame readbackFrame;
+			while (readback.Acquire(&readbackFrame)) {
+				if (recorder.IsRecording()) recorder.Push(readbackFrame);
+				if (sharedOutput.IsOpen()) sharedOutput.Publish(readbackFrame.data, readbackFrame.width, readbackFrame.height, readbackFrame.stride, readbackFrame.frameId, (uint64_t)(readbackFrame.time * 1e9));
+				readback.Release();
+			}
+			readback.Read(frameId, readbackStartTime);
+		}
+
+		/* Swap buffers (offscreen: just submit) */
+		double swapStartTime = FramePipeline_getTime();
+		if (isOffscreen) {
+			glFlush();
 		} else {
-			/* don't display */
-			matModelScaling = glm::scale(glm::vec3(0.0, 0.0, 0.0));
+			glfwSwapBuffers(window);
+			for (int i = 0; i < streamNum; i++) {
+				if (frameIds[i] != 0) presentTimer.MarkPresent(frameIds[i], captureTimes[i]);
+			}
 		}
-		Model = matModelTranslate * matModelRot * matModelScaling * Model;
-
-		/* Calculate ModelViewProjection matrix and send it to shader */
-		glm::mat4 MVP = Projection * View * Model;
-		glUniformMatrix4fv(matrixId, 1, GL_FALSE, &MVP[0][0]);
-
-		/* Bind Texture */
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glUniform1i(textureId, 0);
-
-		/* Set attribute buffer */
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[indexObject]);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBuffer[indexObject]);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-		
-		/* Draw the triangle */
-		glDrawArrays(GL_LINE_LOOP, 0, partCount[indexObject]);
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glUseProgram(0);
-
-		/* Swap buffers */
-		glfwSwapBuffers(window);
 		glfwPollEvents();
+		double frameEndTime = FramePipeline_getTime();
+		Profiler_record("draw", frameId, drawStartTime, readbackStartTime);
+		if (readback.IsInitialized()) Profiler_record("readback", frameId, readbackStartTime, swapStartTime);
+		Profiler_record("swap", frameId, swapStartTime, frameEndTime);
+		Profiler_record("render", frameId, renderStartTime, frameEndTime);
+		for (int i = 0; i < streamNum; i++) {
+			if (frameIds[i] != 0) latencyStats.Add("capture->display", frameEndTime - captureTimes[i]);
+		}
+		if (newFrameNum > 0 && isQualityControlled && qualityController.AddRenderTime(swapStartTime - renderStartTime)) {
+			QualityLevel level = qualityController.GetLevel();
+			for (int i = 0; i < streamNum; i++) streams[i]->SetQuality(level);
+		}
+		latencyStats.Add("frame interval", frameEndTime - lastFrameTime);
+		lastFrameTime = frameEndTime;
 
 		/* Check if the ESC key was pressed or the window was closed */
 		if (glfwWindowShouldClose(window) != 0 || glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
@@ -245,13 +441,51 @@ int main(int argc, char *argv[])
 	}
 
 	/*** Finalize ***/
-	BackgroundDrawer_finalize();
-	/* Cleanup VBO and shader */
-	glDeleteBuffers(OBJECT_NUM, &vertexBuffer[0]);
-	glDeleteBuffers(OBJECT_NUM, &uvBuffer[0]);
-	glDeleteTextures(1, &textureId);
+	/* Frames still being read back are waited for and recorded / published */
+	if (readback.IsInitialized()) {
+		ReadbackFrame readbackFrame;
+		while (readback.Acquire(&readbackFrame, true)) {
+			if (recorder.IsRecording()) recorder.Push(readbackFrame);
+			if (sharedOutput.IsOpen()) sharedOutput.Publish(readbackFrame.data, readbackFrame.width, readbackFrame.height, readbackFrame.stride, readbackFrame.frameId, (uint64_t)(readbackFrame.time * 1e9));
+			readback.Release();
+		}
+	}
+	if (sharedOutput.IsOpen()) {
+		printf("published %d frames to %s\n", (int)sharedOutput.GetPublishedNum(), sharedOutputName);
+		sharedOutput.Close();
+	}
+	if (recorder.IsRecording()) {
+		recorder.Stop();
+		printf("recorded %d frames to %s, dropped %d (readback) %d (encoder)\n", (int)recorder.GetRecordedNum(), recordPath,
+			(int)readback.GetDroppedNum(), (int)recorder.GetDroppedNum());
+	}
+	readback.Finalize();
+	glFinish();
+	double elapsedTime = FramePipeline_getTime() - startTime;
+	uint64_t droppedNum = 0;
+	for (int i = 0; i < streamNum; i++) {
+		streams[i]->Stop();
+		droppedNum += streams[i]->GetDroppedNum();
+	}
+	Profiler_collect(&latencyStats);
+	printf("%d streams: %d frames in %.2f sec, %.1f fps, dropped %d\n", streamNum, displayedFrameNum, elapsedTime,
+		displayedFrameNum / elapsedTime, (int)droppedNum);
+	for (int i = 0; i < streamNum; i++) streams[i]->PrintStats();
+	latencyStats.Print();
+	Profiler_finalize();
+	presentTimer.Finalize();
+	if (isOffscreen) {
+		glDeleteRenderbuffers(2, offscreenRenderbuffer);
+		glDeleteFramebuffers(1, &offscreenFbo);
+	}
+	streams.clear();
+	/* Release VBO, texture and shader (deleted when the last handle is gone) */
+	overlay.Finalize();
+	meshPack.Finalize();
+	texture.reset();
+	program.reset();
 	glDeleteVertexArrays(1, &vao);
-	glDeleteProgram(programId);
+	Resource_closePack();
 
 	/* Close OpenGL window and terminate GLFW */
 	glfwTerminate();
@@ -15,6 +15,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp> 
 
+#include "ResourcePack.h"
 #include "objloader.h"
 
 
@@ -132,13 +133,29 @@ bool loadAssImp(
 	std::vector<glm::vec2> & uvs,
 	std::vector<glm::vec3> & normals
 ){
+	// Parse straight from the resource pack (or the file mapping) instead of letting AssImp reopen the file
+	ResourceView file;
+	if (!Resource_read(path, &file)) return false;
+	return loadAssImpFromMemory(file.data, file.size, path, indices, vertices, uvs, normals);
+}
+
+bool loadAssImpFromMemory(
+	const void * data,
+	size_t size,
+	const char * name,
+	std::vector<unsigned short> & indices,
+	std::vector<glm::vec3> & vertices,
+	std::vector<glm::vec2> & uvs,
+	std::vector<glm::vec3> & normals
+){
 
 	Assimp::Importer importer;
 
-	const aiScene* scene = importer.ReadFile(path, 0/*aiProcess_JoinIdenticalVertices | aiProcess_SortByPType*/);
+	// The extension tells AssImp which importer to use
+	const char * extension = strrchr(name, '.');
+	const aiScene* scene = importer.ReadFileFromMemory(data, size, 0/*aiProcess_JoinIdenticalVertices | aiProcess_SortByPType*/, extension ? extension + 1 : "");
 	if( !scene) {
-		fprintf( stderr, importer.GetErrorString());
-		getchar();
+		fprintf(stderr, "%s: %s\n", name, importer.GetErrorString());
 		return false;
 	}
 
@@ -18,4 +18,14 @@ bool loadAssImp(
 	std::vector<glm::vec3> & normals
 );
 
+bool loadAssImpFromMemory(
+	const void * data,
+	size_t size,
+	const char * name,
+	std::vector<unsigned short> & indices,
+	std::vector<glm::vec3> & vertices,
+	std::vector<glm::vec2> & uvs,
+	std::vector<glm::vec3> & normals
+);
+
 #endif
\ No newline at end of file
@@ -5,7 +5,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <string>
-#include <fstream> 
 #include <vector>
 #include <chrono>
 
@@ -13,49 +12,36 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "ResourcePack.h"
 #include "shader.h"
 
 GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path) {
 
+	// Read the shader code from the resource pack (or the file). Resource_read reports the file it could not open
+	ResourceView VertexShaderCode, FragmentShaderCode;
+	if (!Resource_read(vertex_file_path, &VertexShaderCode) || !Resource_read(fragment_file_path, &FragmentShaderCode)) return 0;
+	return LoadShadersFromMemory(
+		vertex_file_path, (const char *)VertexShaderCode.data, VertexShaderCode.size,
+		fragment_file_path, (const char *)FragmentShaderCode.data, FragmentShaderCode.size);
+}
+
+GLuint LoadShadersFromMemory(
+	const char * vertex_name, const char * vertex_code, size_t vertex_size,
+	const char * fragment_name, const char * fragment_code, size_t fragment_size) {
+
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
 	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if (VertexShaderStream.is_open()) {
-		std::string Line = "";
-		while (getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	} else {
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-		getchar();
-		return 0;
-	}
-
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if (FragmentShaderStream.is_open()) {
-		std::string Line = "";
-		while (getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
-	}
-
-
-
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
 
 
 	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
+	printf("Compiling shader : %s\n", vertex_name);
+	GLint VertexSourceLength = (GLint)vertex_size;
+	glShaderSource(VertexShaderID, 1, &vertex_code, &VertexSourceLength);
 	glCompileShader(VertexShaderID);
 
 	// Check Vertex Shader
@@ -70,9 +56,9 @@ GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_pat
 
 
 	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, NULL);
+	printf("Compiling shader : %s\n", fragment_name);
+	GLint FragmentSourceLength = (GLint)fragment_size;
+	glShaderSource(FragmentShaderID, 1, &fragment_code, &FragmentSourceLength);
 	glCompileShader(FragmentShaderID);
 
 	// Check Fragment Shader
@@ -2,5 +2,8 @@
 #define SHADER_H
 
 GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path);
+GLuint LoadShadersFromMemory(
+	const char * vertex_name, const char * vertex_code, size_t vertex_size,
+	const char * fragment_name, const char * fragment_code, size_t fragment_size);
 
 #endif
@@ -1,5 +1,6 @@
 /*** Include ***/
 /* for general */
+#include <sys/stat.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,85 +16,23 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp> 
 
+#include "ResourcePack.h"
+#include "ImageDecoder.h"
+#include "BcEncoder.h"
+#include "TextureLoader.h"
 #include "texture.h"
 
 GLuint loadBMP_custom(const char * imagepath) {
 
-	printf("Reading image %s\n", imagepath);
-
-	// Data read from the header of the BMP file
-	unsigned char header[54];
-	unsigned int dataPos;
-	unsigned int imageSize;
-	unsigned int width, height;
-	// Actual RGB data
-	unsigned char * data;
-
-	// Open the file
-	FILE * file = fopen(imagepath, "rb");
-	if (!file) { printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar(); return 0; }
-
-	// Read the header, i.e. the 54 first bytes
-
-	// If less than 54 bytes are read, problem
-	if (fread(header, 1, 54, file) != 54) {
-		printf("Not a correct BMP file\n");
-		return 0;
-	}
-	// A BMP files always begins with "BM"
-	if (header[0] != 'B' || header[1] != 'M') {
-		printf("Not a correct BMP file\n");
+	// Decode the whole file (BMP of any common layout, PNG or JPEG) into RGBA
+	Image image;
+	if (!ImageDecoder_load(imagepath, &image)) {
+		printf("%s could not be loaded\n", imagepath);
 		return 0;
 	}
-	// Make sure this is a 24bpp file
-	if (*(int*)&(header[0x1E]) != 0) { printf("Not a correct BMP file\n");    return 0; }
-	if (*(int*)&(header[0x1C]) != 24) { printf("Not a correct BMP file\n");    return 0; }
 
-	// Read the information about the image
-	dataPos = *(int*)&(header[0x0A]);
-	imageSize = *(int*)&(header[0x22]);
-	width = *(int*)&(header[0x12]);
-	height = *(int*)&(header[0x16]);
-
-	// Some BMP files are misformatted, guess missing information
-	if (imageSize == 0)    imageSize = width * height * 3; // 3 : one byte for each Red, Green and Blue component
-	if (dataPos == 0)      dataPos = 54; // The BMP header is done that way
-
-	// Create a buffer
-	data = new unsigned char[imageSize];
-
-	// Read the actual data from the file into the buffer
-	fread(data, 1, imageSize, file);
-
-	// Everything is in memory now, the file wan be closed
-	fclose(file);
-
-	// Create one OpenGL texture
-	GLuint textureID;
-	glGenTextures(1, &textureID);
-
-	// "Bind" the newly created texture : all future texture functions will modify this texture
-	glBindTexture(GL_TEXTURE_2D, textureID);
-
-	// Give the image to OpenGL
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
-
-	// OpenGL has now copied the data. Free our own version
-	delete[] data;
-
-	// Poor filtering, or ...
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); 
-
-	// ... nice trilinear filtering.
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	// Return the ID of the texture we just created
-	return textureID;
+	// Give the image to OpenGL, with nice trilinear filtering
+	return TextureLoader_createTexture(image);
 }
 
 // Since GLFW 3, glfwLoadTexture2D() has been removed. You have to use another texture loading library, 
@@ -123,99 +62,547 @@ GLuint loadBMP_custom(const char * imagepath) {
 
 
 
-#define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
-#define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
-#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
+/*** Compressed texture (DDS / KTX2) ***/
+#define MAKE_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define FOURCC_DXT1 MAKE_FOURCC('D', 'X', 'T', '1')
+#define FOURCC_DXT2 MAKE_FOURCC('D', 'X', 'T', '2')
+#define FOURCC_DXT3 MAKE_FOURCC('D', 'X', 'T', '3')
+#define FOURCC_DXT4 MAKE_FOURCC('D', 'X', 'T', '4')
+#define FOURCC_DXT5 MAKE_FOURCC('D', 'X', 'T', '5')
+#define FOURCC_ATI1 MAKE_FOURCC('A', 'T', 'I', '1')
+#define FOURCC_BC4U MAKE_FOURCC('B', 'C', '4', 'U')
+#define FOURCC_BC4S MAKE_FOURCC('B', 'C', '4', 'S')
+#define FOURCC_ATI2 MAKE_FOURCC('A', 'T', 'I', '2')
+#define FOURCC_BC5U MAKE_FOURCC('B', 'C', '5', 'U')
+#define FOURCC_BC5S MAKE_FOURCC('B', 'C', '5', 'S')
+#define FOURCC_DX10 MAKE_FOURCC('D', 'X', '1', '0')
+
+/* DDS_HEADER (offsets are from the beginning of the file, including the "DDS " magic) */
+#define DDS_MAGIC_SIZE        4
+#define DDS_HEADER_SIZE       124
+#define DDS_HEADER_DX10_SIZE  20
+#define DDSD_MIPMAPCOUNT      0x20000
+#define DDSD_DEPTH            0x800000
+#define DDPF_ALPHAPIXELS      0x1
+#define DDPF_FOURCC           0x4
+#define DDPF_RGB              0x40
+#define DDSCAPS2_CUBEMAP      0x200
+#define DDSCAPS2_CUBEMAP_ALLFACES 0xFC00
+#define DDSCAPS2_VOLUME       0x200000
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_DIMENSION_TEXTURE3D 4
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+
+/* KTX2 header */
+#define KTX2_HEADER_SIZE      80
+#define KTX2_LEVEL_INDEX_SIZE 24
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+typedef struct {
+	GLenum internalFormat;
+	GLenum format;            /* uncompressed only */
+	GLenum type;              /* uncompressed only */
+	unsigned int blockBytes;  /* bytes per 4x4 block if compressed, bytes per pixel otherwise */
+	bool compressed;
+} TextureFormat;
+
+typedef struct {
+	GLenum target;
+	TextureFormat format;
+	unsigned int width;
+	unsigned int height;
+	unsigned int depth;
+	unsigned int layers;      /* number of array elements (1 if not an array texture) */
+	unsigned int faces;       /* 6 for cube maps, 1 otherwise */
+	unsigned int levels;
+	bool isArray;
+} TextureDesc;
+
+/* Header fields are read with memcpy, since the mapping gives no alignment guarantee for them */
+static inline uint32_t readU32(const uint8_t *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
 
-GLuint loadDDS(const char * imagepath) {
+static inline uint64_t readU64(const uint8_t *p)
+{
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
 
-	unsigned char header[124];
+static TextureFormat makeCompressed(GLenum internalFormat, unsigned int blockBytes)
+{
+	TextureFormat f = { internalFormat, 0, 0, blockBytes, true };
+	return f;
+}
 
-	FILE *fp;
+static TextureFormat makeUncompressed(GLenum internalFormat, GLenum format, unsigned int bytesPerPixel)
+{
+	TextureFormat f = { internalFormat, format, GL_UNSIGNED_BYTE, bytesPerPixel, false };
+	return f;
+}
 
-	/* try to open the file */
-	fp = fopen(imagepath, "rb");
-	if (fp == NULL) {
-		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar();
-		return 0;
+static inline unsigned int mipDimension(unsigned int size, unsigned int level)
+{
+	size >>= level;
+	return size ? size : 1;
+}
+
+/* Exact byte size of one image (all depth slices) of the given mip dimensions */
+static size_t imageSize(const TextureFormat &format, unsigned int width, unsigned int height, unsigned int depth)
+{
+	if (format.compressed) {
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * format.blockBytes * depth;
 	}
+	return (size_t)width * height * format.blockBytes * depth;
+}
 
-	/* verify the type of file */
-	char filecode[4];
-	fread(filecode, 1, 4, fp);
-	if (strncmp(filecode, "DDS ", 4) != 0) {
-		fclose(fp);
-		return 0;
+static bool getDxgiFormat(uint32_t dxgiFormat, TextureFormat *format)
+{
+	switch (dxgiFormat) {
+	case 28: *format = makeUncompressed(GL_RGBA8, GL_RGBA, 4); return true;         /* R8G8B8A8_UNORM */
+	case 29: *format = makeUncompressed(GL_SRGB8_ALPHA8, GL_RGBA, 4); return true;  /* R8G8B8A8_UNORM_SRGB */
+	case 87: *format = makeUncompressed(GL_RGBA8, GL_BGRA, 4); return true;         /* B8G8R8A8_UNORM */
+	case 91: *format = makeUncompressed(GL_SRGB8_ALPHA8, GL_BGRA, 4); return true;  /* B8G8R8A8_UNORM_SRGB */
+	case 70: case 71: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8); return true;  /* BC1 */
+	case 72: *format = makeCompressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8); return true;
+	case 73: case 74: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 16); return true; /* BC2 */
+	case 75: *format = makeCompressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 16); return true;
+	case 76: case 77: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16); return true; /* BC3 */
+	case 78: *format = makeCompressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16); return true;
+	case 79: case 80: *format = makeCompressed(GL_COMPRESSED_RED_RGTC1, 8); return true;           /* BC4 */
+	case 81: *format = makeCompressed(GL_COMPRESSED_SIGNED_RED_RGTC1, 8); return true;
+	case 82: case 83: *format = makeCompressed(GL_COMPRESSED_RG_RGTC2, 16); return true;           /* BC5 */
+	case 84: *format = makeCompressed(GL_COMPRESSED_SIGNED_RG_RGTC2, 16); return true;
+	case 94: case 95: *format = makeCompressed(GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 16); return true; /* BC6H */
+	case 96: *format = makeCompressed(GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 16); return true;
+	case 97: case 98: *format = makeCompressed(GL_COMPRESSED_RGBA_BPTC_UNORM, 16); return true;    /* BC7 */
+	case 99: *format = makeCompressed(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 16); return true;
+	default: return false;
 	}
+}
+
+static bool getVkFormat(uint32_t vkFormat, TextureFormat *format)
+{
+	switch (vkFormat) {
+	case 37: *format = makeUncompressed(GL_RGBA8, GL_RGBA, 4); return true;         /* R8G8B8A8_UNORM */
+	case 43: *format = makeUncompressed(GL_SRGB8_ALPHA8, GL_RGBA, 4); return true;  /* R8G8B8A8_SRGB */
+	case 44: *format = makeUncompressed(GL_RGBA8, GL_BGRA, 4); return true;         /* B8G8R8A8_UNORM */
+	case 50: *format = makeUncompressed(GL_SRGB8_ALPHA8, GL_BGRA, 4); return true;  /* B8G8R8A8_SRGB */
+	case 131: *format = makeCompressed(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8); return true;  /* BC1_RGB */
+	case 132: *format = makeCompressed(GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 8); return true;
+	case 133: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8); return true; /* BC1_RGBA */
+	case 134: *format = makeCompressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8); return true;
+	case 135: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 16); return true; /* BC2 */
+	case 136: *format = makeCompressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 16); return true;
+	case 137: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16); return true; /* BC3 */
+	case 138: *format = makeCompressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16); return true;
+	case 139: *format = makeCompressed(GL_COMPRESSED_RED_RGTC1, 8); return true;          /* BC4 */
+	case 140: *format = makeCompressed(GL_COMPRESSED_SIGNED_RED_RGTC1, 8); return true;
+	case 141: *format = makeCompressed(GL_COMPRESSED_RG_RGTC2, 16); return true;          /* BC5 */
+	case 142: *format = makeCompressed(GL_COMPRESSED_SIGNED_RG_RGTC2, 16); return true;
+	case 143: *format = makeCompressed(GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 16); return true; /* BC6H */
+	case 144: *format = makeCompressed(GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 16); return true;
+	case 145: *format = makeCompressed(GL_COMPRESSED_RGBA_BPTC_UNORM, 16); return true;    /* BC7 */
+	case 146: *format = makeCompressed(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 16); return true;
+	default: return false;
+	}
+}
 
-	/* get the surface desc */
-	fread(&header, 124, 1, fp);
-
-	unsigned int height = *(unsigned int*)&(header[8]);
-	unsigned int width = *(unsigned int*)&(header[12]);
-	unsigned int linearSize = *(unsigned int*)&(header[16]);
-	unsigned int mipMapCount = *(unsigned int*)&(header[24]);
-	unsigned int fourCC = *(unsigned int*)&(header[80]);
-
-
-	unsigned char * buffer;
-	unsigned int bufsize;
-	/* how big is it going to be including all mipmaps? */
-	bufsize = mipMapCount > 1 ? linearSize * 2 : linearSize;
-	buffer = (unsigned char*)malloc(bufsize * sizeof(unsigned char));
-	fread(buffer, 1, bufsize, fp);
-	/* close the file pointer */
-	fclose(fp);
-
-	unsigned int components = (fourCC == FOURCC_DXT1) ? 3 : 4;
-	unsigned int format;
-	switch (fourCC)
-	{
-	case FOURCC_DXT1:
-		format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
-		break;
-	case FOURCC_DXT3:
-		format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
-		break;
-	case FOURCC_DXT5:
-		format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
-		break;
+static bool getLegacyDdsFormat(const uint8_t *header, TextureFormat *format)
+{
+	uint32_t pfFlags = readU32(header + 76);
+	uint32_t fourCC = readU32(header + 80);
+	uint32_t bitCount = readU32(header + 84);
+	uint32_t rMask = readU32(header + 88);
+	if (pfFlags & DDPF_FOURCC) {
+		switch (fourCC) {
+		case FOURCC_DXT1: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8); return true;
+		case FOURCC_DXT2:
+		case FOURCC_DXT3: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 16); return true;
+		case FOURCC_DXT4:
+		case FOURCC_DXT5: *format = makeCompressed(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16); return true;
+		case FOURCC_ATI1:
+		case FOURCC_BC4U: *format = makeCompressed(GL_COMPRESSED_RED_RGTC1, 8); return true;
+		case FOURCC_BC4S: *format = makeCompressed(GL_COMPRESSED_SIGNED_RED_RGTC1, 8); return true;
+		case FOURCC_ATI2:
+		case FOURCC_BC5U: *format = makeCompressed(GL_COMPRESSED_RG_RGTC2, 16); return true;
+		case FOURCC_BC5S: *format = makeCompressed(GL_COMPRESSED_SIGNED_RG_RGTC2, 16); return true;
+		default: return false;
+		}
+	}
+	if (pfFlags & DDPF_RGB) {
+		bool hasAlpha = (pfFlags & DDPF_ALPHAPIXELS) != 0;
+		if (bitCount == 32 && rMask == 0x00ff0000) { *format = makeUncompressed(hasAlpha ? GL_RGBA8 : GL_RGB8, GL_BGRA, 4); return true; }
+		if (bitCount == 32 && rMask == 0x000000ff) { *format = makeUncompressed(hasAlpha ? GL_RGBA8 : GL_RGB8, GL_RGBA, 4); return true; }
+		if (bitCount == 24 && rMask == 0x00ff0000) { *format = makeUncompressed(GL_RGB8, GL_BGR, 3); return true; }
+		if (bitCount == 24 && rMask == 0x000000ff) { *format = makeUncompressed(GL_RGB8, GL_RGB, 3); return true; }
+	}
+	return false;
+}
+
+static bool isTextureSupported(const TextureDesc &desc)
+{
+	if (desc.target == GL_TEXTURE_CUBE_MAP_ARRAY && !(GLEW_VERSION_4_0 || GLEW_ARB_texture_cube_map_array)) return false;
+	switch (desc.format.internalFormat) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return GLEW_EXT_texture_compression_s3tc;
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+		return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+	case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+	case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+	case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+		return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
 	default:
-		free(buffer);
-		return 0;
+		/* RGTC and 8-bit formats are core since OpenGL 3.0 */
+		return true;
+	}
+}
+
+static GLenum getTarget(bool isCube, bool isArray, bool isVolume)
+{
+	if (isVolume) return GL_TEXTURE_3D;
+	if (isCube) return isArray ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP;
+	return isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+}
+
+static bool isLayeredTarget(GLenum target)
+{
+	return target == GL_TEXTURE_3D || target == GL_TEXTURE_2D_ARRAY || target == GL_TEXTURE_CUBE_MAP_ARRAY;
+}
+
+/* Specify a whole mip level. For layered targets, depth is the number of slices (layer-faces for arrays). data may be NULL to only allocate */
+static void specifyLevel(const TextureFormat &format, GLenum target, unsigned int level, unsigned int width, unsigned int height, unsigned int depth, size_t size, const uint8_t *data)
+{
+	if (isLayeredTarget(target)) {
+		if (format.compressed) {
+			glCompressedTexImage3D(target, level, format.internalFormat, width, height, depth, 0, (GLsizei)size, data);
+		} else {
+			glTexImage3D(target, level, format.internalFormat, width, height, depth, 0, format.format, format.type, data);
+		}
+	} else {
+		if (format.compressed) {
+			glCompressedTexImage2D(target, level, format.internalFormat, width, height, 0, (GLsizei)size, data);
+		} else {
+			glTexImage2D(target, level, format.internalFormat, width, height, 0, format.format, format.type, data);
+		}
 	}
+}
+
+/* Fill one layer-face slice of an array texture level allocated by specifyLevel */
+static void specifySlice(const TextureFormat &format, GLenum target, unsigned int level, unsigned int width, unsigned int height, unsigned int slice, size_t size, const uint8_t *data)
+{
+	if (format.compressed) {
+		glCompressedTexSubImage3D(target, level, 0, 0, slice, width, height, 1, format.internalFormat, (GLsizei)size, data);
+	} else {
+		glTexSubImage3D(target, level, 0, 0, slice, width, height, 1, format.format, format.type, data);
+	}
+}
+
+static GLuint beginTexture(const TextureDesc &desc)
+{
+	/* Clear stale errors so that endTexture only reports errors of this upload */
+	while (glGetError() != GL_NO_ERROR) {}
 
-	// Create one OpenGL texture
 	GLuint textureID;
 	glGenTextures(1, &textureID);
-
-	// "Bind" the newly created texture : all future texture functions will modify this texture
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	glBindTexture(desc.target, textureID);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
-	unsigned int offset = 0;
+	/* Files may contain a partial mip chain, so tell GL how many levels are really there */
+	glTexParameteri(desc.target, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(desc.target, GL_TEXTURE_MAX_LEVEL, desc.levels - 1);
+	glTexParameteri(desc.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(desc.target, GL_TEXTURE_MIN_FILTER, desc.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	return textureID;
+}
 
-	/* load the mipmaps */
-	for (unsigned int level = 0; level < mipMapCount && (width || height); ++level)
-	{
-		unsigned int size = ((width + 3) / 4)*((height + 3) / 4)*blockSize;
-		glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height,
-			0, size, buffer + offset);
+static GLuint endTexture(GLuint textureID, const char *name)
+{
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		printf("%s: texture upload failed (GL error 0x%04X)\n", name, error);
+		glDeleteTextures(1, &textureID);
+		return 0;
+	}
+	return textureID;
+}
+
+GLuint loadDDSFromMemory(const unsigned char * data, size_t size, GLenum * target)
+{
+	const char *name = "DDS";
+	if (size < DDS_MAGIC_SIZE + DDS_HEADER_SIZE || memcmp(data, "DDS ", 4) != 0) {
+		printf("%s: not a DDS file\n", name);
+		return 0;
+	}
+	const uint8_t *header = data + DDS_MAGIC_SIZE;
+	uint32_t flags = readU32(header + 4);
+	uint32_t caps2 = readU32(header + 108);
+	size_t offset = DDS_MAGIC_SIZE + DDS_HEADER_SIZE;
+
+	TextureDesc desc;
+	desc.height = readU32(header + 8);
+	desc.width = readU32(header + 12);
+	desc.depth = (flags & DDSD_DEPTH) ? readU32(header + 20) : 1;
+	desc.levels = (flags & DDSD_MIPMAPCOUNT) ? readU32(header + 24) : 1;
+	desc.layers = 1;
+	desc.faces = 1;
+	desc.isArray = false;
+	bool isCube = false;
+	bool isVolume = false;
+
+	if ((readU32(header + 76) & DDPF_FOURCC) && readU32(header + 80) == FOURCC_DX10) {
+		if (size < offset + DDS_HEADER_DX10_SIZE) {
+			printf("%s: truncated DX10 header\n", name);
+			return 0;
+		}
+		const uint8_t *dx10 = data + offset;
+		uint32_t dxgiFormat = readU32(dx10 + 0);
+		uint32_t dimension = readU32(dx10 + 4);
+		uint32_t miscFlag = readU32(dx10 + 8);
+		offset += DDS_HEADER_DX10_SIZE;
+		if (!getDxgiFormat(dxgiFormat, &desc.format)) {
+			printf("%s: unsupported DXGI format %u\n", name, dxgiFormat);
+			return 0;
+		}
+		if (dimension != DDS_DIMENSION_TEXTURE2D && dimension != DDS_DIMENSION_TEXTURE3D) {
+			printf("%s: unsupported resource dimension %u\n", name, dimension);
+			return 0;
+		}
+		isVolume = (dimension == DDS_DIMENSION_TEXTURE3D);
+		isCube = (miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) != 0;
+		desc.layers = readU32(dx10 + 12);
+		if (desc.layers == 0) desc.layers = 1;
+		desc.isArray = desc.layers > 1;
+	} else {
+		if (!getLegacyDdsFormat(header, &desc.format)) {
+			printf("%s: unsupported pixel format\n", name);
+			return 0;
+		}
+		isVolume = (caps2 & DDSCAPS2_VOLUME) != 0;
+		isCube = (caps2 & DDSCAPS2_CUBEMAP) != 0;
+		if (isCube && (caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES) {
+			printf("%s: partial cube maps are not supported\n", name);
+			return 0;
+		}
+	}
+	if (isVolume && (isCube || desc.isArray)) {
+		printf("%s: invalid volume texture\n", name);
+		return 0;
+	}
+	if (!isVolume) desc.depth = 1;
+	if (desc.depth == 0) desc.depth = 1;
+	if (desc.levels == 0) desc.levels = 1;
+	if (desc.width == 0 || desc.height == 0) {
+		printf("%s: invalid size\n", name);
+		return 0;
+	}
+	desc.faces = isCube ? 6 : 1;
+	desc.target = getTarget(isCube, desc.isArray, isVolume);
+	if (target) *target = desc.target;
+	if (!isTextureSupported(desc)) {
+		printf("%s: format 0x%04X is not supported by this GL context\n", name, desc.format.internalFormat);
+		return 0;
+	}
 
-		offset += size;
-		width /= 2;
-		height /= 2;
+	GLuint textureID = beginTexture(desc);
 
-		// Deal with Non-Power-Of-Two textures. This code is not included in the webpage to reduce clutter.
-		if (width < 1) width = 1;
-		if (height < 1) height = 1;
+	/* Array textures store whole mip chains per element, so allocate every level first and fill slices afterwards */
+	unsigned int slices = desc.layers * desc.faces;
+	if (desc.isArray) {
+		for (unsigned int level = 0; level < desc.levels; level++) {
+			unsigned int w = mipDimension(desc.width, level);
+			unsigned int h = mipDimension(desc.height, level);
+			specifyLevel(desc.format, desc.target, level, w, h, slices, imageSize(desc.format, w, h, 1) * slices, NULL);
+		}
+	}
 
+	/* DDS layout: for each element, for each face, the whole mip chain */
+	for (unsigned int layer = 0; layer < desc.layers; layer++) {
+		for (unsigned int face = 0; face < desc.faces; face++) {
+			for (unsigned int level = 0; level < desc.levels; level++) {
+				unsigned int w = mipDimension(desc.width, level);
+				unsigned int h = mipDimension(desc.height, level);
+				unsigned int d = mipDimension(desc.depth, level);
+				size_t levelSize = imageSize(desc.format, w, h, d);
+				if (offset + levelSize > size) {
+					printf("%s: file is truncated (level %u needs %zu bytes at offset %zu)\n", name, level, levelSize, offset);
+					glDeleteTextures(1, &textureID);
+					glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+					return 0;
+				}
+				if (desc.isArray) {
+					specifySlice(desc.format, desc.target, level, w, h, layer * desc.faces + face, levelSize, data + offset);
+				} else if (isCube) {
+					specifyLevel(desc.format, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, w, h, 1, levelSize, data + offset);
+				} else {
+					specifyLevel(desc.format, desc.target, level, w, h, d, levelSize, data + offset);
+				}
+				offset += levelSize;
+			}
+		}
 	}
 
-	free(buffer);
+	return endTexture(textureID, name);
+}
 
-	return textureID;
+GLuint loadKTX2FromMemory(const unsigned char * data, size_t size, GLenum * target)
+{
+	const char *name = "KTX2";
+	if (size < KTX2_HEADER_SIZE || memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+		printf("%s: not a KTX2 file\n", name);
+		return 0;
+	}
+	uint32_t vkFormat = readU32(data + 12);
+	uint32_t supercompression = readU32(data + 44);
+	TextureDesc desc;
+	desc.width = readU32(data + 20);
+	desc.height = readU32(data + 24);
+	desc.depth = readU32(data + 28);
+	desc.layers = readU32(data + 32);
+	desc.faces = readU32(data + 36);
+	desc.levels = readU32(data + 40);
+
+	if (supercompression != 0) {
+		printf("%s: supercompression scheme %u is not supported\n", name, supercompression);
+		return 0;
+	}
+	if (!getVkFormat(vkFormat, &desc.format)) {
+		printf("%s: unsupported VkFormat %u\n", name, vkFormat);
+		return 0;
+	}
+	if (desc.width == 0 || desc.height == 0 || (desc.faces != 1 && desc.faces != 6) || (desc.depth > 0 && (desc.faces != 1 || desc.layers > 0))) {
+		printf("%s: unsupported dimensions\n", name);
+		return 0;
+	}
+	/* levelCount 0 asks the loader to generate mipmaps, which is not possible for block compressed data */
+	unsigned int levelCount = desc.levels ? desc.levels : 1;
+	bool isVolume = desc.depth > 0;
+	desc.isArray = desc.layers > 0;
+	desc.levels = levelCount;
+	if (desc.depth == 0) desc.depth = 1;
+	if (desc.layers == 0) desc.layers = 1;
+	if (size < KTX2_HEADER_SIZE + (size_t)levelCount * KTX2_LEVEL_INDEX_SIZE) {
+		printf("%s: truncated level index\n", name);
+		return 0;
+	}
+	desc.target = getTarget(desc.faces == 6, desc.isArray, isVolume);
+	if (target) *target = desc.target;
+	if (!isTextureSupported(desc)) {
+		printf("%s: format 0x%04X is not supported by this GL context\n", name, desc.format.internalFormat);
+		return 0;
+	}
+
+	GLuint textureID = beginTexture(desc);
+
+	/* KTX2 layout: each level holds every layer, face and z slice contiguously, which is exactly what glCompressedTexImage3D wants */
+	unsigned int slices = desc.layers * desc.faces;
+	for (unsigned int level = 0; level < levelCount; level++) {
+		const uint8_t *index = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_SIZE;
+		uint64_t levelOffset = readU64(index + 0);
+		uint64_t levelLength = readU64(index + 8);
+		unsigned int w = mipDimension(desc.width, level);
+		unsigned int h = mipDimension(desc.height, level);
+		unsigned int d = mipDimension(desc.depth, level);
+		size_t faceSize = imageSize(desc.format, w, h, d);
+		if (levelLength != (uint64_t)faceSize * slices || levelOffset > size || levelLength > size - levelOffset) {
+			printf("%s: level %u has an invalid size or offset\n", name, level);
+			glDeleteTextures(1, &textureID);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			return 0;
+		}
+		const uint8_t *levelData = data + levelOffset;
+		if (desc.isArray) {
+			specifyLevel(desc.format, desc.target, level, w, h, slices, (size_t)levelLength, levelData);
+		} else if (desc.faces == 6) {
+			for (unsigned int face = 0; face < 6; face++) {
+				specifyLevel(desc.format, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, w, h, 1, faceSize, levelData + face * faceSize);
+			}
+		} else {
+			specifyLevel(desc.format, desc.target, level, w, h, d, faceSize, levelData);
+		}
+	}
+
+	return endTexture(textureID, name);
+}
+
+GLuint loadDDS(const char * imagepath, GLenum * target)
+{
+	/* Upload straight from the pack / file mapping: the driver copies the data exactly once */
+	ResourceView file;
+	if (!Resource_read(imagepath, &file)) return 0;
+	printf("Reading image %s\n", imagepath);
+	return loadDDSFromMemory(file.data, file.size, target);
+}
+
+GLuint loadKTX2(const char * imagepath, GLenum * target)
+{
+	ResourceView file;
+	if (!Resource_read(imagepath, &file)) return 0;
+	printf("Reading image %s\n", imagepath);
+	return loadKTX2FromMemory(file.data, file.size, target);
+}
 
+GLuint loadCompressedTexture(const char * imagepath, GLenum * target)
+{
+	ResourceView file;
+	if (!Resource_read(imagepath, &file)) return 0;
+	printf("Reading image %s\n", imagepath);
+	if (file.size >= sizeof(KTX2_IDENTIFIER) && memcmp(file.data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+		return loadKTX2FromMemory(file.data, file.size, target);
+	}
+	return loadDDSFromMemory(file.data, file.size, target);
+}
+
+
+/* True if the file at path exists and is not older than the file at sourcePath */
+static bool isUpToDate(const char *path, const char *sourcePath)
+{
+	struct stat st, stSource;
+	if (stat(path, &st) != 0) return false;
+	if (stat(sourcePath, &stSource) != 0) return true;
+	return st.st_mtime >= stSource.st_mtime;
+}
 
-}
\ No newline at end of file
+GLuint loadBMP_compressed(const char * imagepath, BcFormat format, const char * cachepath)
+{
+	/* Reuse the compressed cache made at the first load */
+	if (cachepath && isUpToDate(cachepath, imagepath)) {
+		GLuint textureID = loadDDS(cachepath);
+		if (textureID) return textureID;
+	}
+
+	Image image;
+	if (!ImageDecoder_load(imagepath, &image)) return 0;
+
+	if (format == BC_FORMAT_BC7 && !(GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc)) {
+		printf("%s: BC7 is not supported by this GL context. Use BC3 instead\n", imagepath);
+		format = BC_FORMAT_BC3;
+	}
+	std::vector<BcLevel> levels;
+	BcEncoder_compressMipChain(&image.rgba[0], image.width, image.height, format, levels);
+
+	std::vector<uint8_t> dds;
+	BcEncoder_buildDDS(format, levels, dds);
+	if (cachepath) {
+		FILE *fp = fopen(cachepath, "wb");
+		if (fp) {
+			fwrite(&dds[0], 1, dds.size(), fp);
+			fclose(fp);
+		} else {
+			printf("%s could not be opened for writing\n", cachepath);
+		}
+	}
+	return loadDDSFromMemory(&dds[0], dds.size());
+}
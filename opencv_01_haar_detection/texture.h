@@ -1,7 +1,9 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
-// Load a .BMP file using our custom loader
+#include "BcEncoder.h"
+
+// Load a .BMP (1-32bpp, RLE, top-down), .PNG or .JPG file using our custom loader
 GLuint loadBMP_custom(const char * imagepath);
 
 //// Since GLFW 3, glfwLoadTexture2D() has been removed. You have to use another texture loading library, 
@@ -9,8 +11,22 @@ GLuint loadBMP_custom(const char * imagepath);
 //// Load a .TGA file using GLFW's own loader
 //GLuint loadTGA_glfw(const char * imagepath);
 
-// Load a .DDS file using GLFW's own loader
-GLuint loadDDS(const char * imagepath);
+// Load a .DDS file (BC1-BC7, DX10 header, cube/array/volume textures).
+// The file is memory mapped and every mip level is uploaded straight from the mapping.
+// target (optional) receives GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP_ARRAY or GL_TEXTURE_3D
+GLuint loadDDS(const char * imagepath, GLenum * target = NULL);
+GLuint loadDDSFromMemory(const unsigned char * data, size_t size, GLenum * target = NULL);
+
+// Load a .KTX2 file (same formats and texture types as DDS, no supercompression)
+GLuint loadKTX2(const char * imagepath, GLenum * target = NULL);
+GLuint loadKTX2FromMemory(const unsigned char * data, size_t size, GLenum * target = NULL);
+
+// Load a .DDS or .KTX2 file depending on the file signature
+GLuint loadCompressedTexture(const char * imagepath, GLenum * target = NULL);
+
+// Load an uncompressed image, block compress it with its whole mip chain on the CPU and upload it.
+// If cachepath is given, the result is stored there as DDS and reused while it is newer than the image
+GLuint loadBMP_compressed(const char * imagepath, BcFormat format = BC_FORMAT_BC1, const char * cachepath = NULL);
 
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file